@@ -0,0 +1,58 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class Arena
+ * @brief Memory for the intermediate results of a query, allocated by moving a pointer and freed all at once.
+ *
+ * The memory is taken from blocks of blockSize bytes; a request bigger than a block gets a block of its own.
+ * Nothing is freed until reset, that keeps the first block for the next allocations, or until the arena is destroyed.
+ */
+class Arena {
+    struct Block {
+        unique_ptr<char[]> memory;
+        size_t size;
+    };
+
+    size_t blockSize;
+    vector<Block> blocks;
+    // byte occupati nell'ultimo blocco
+    size_t used;
+    size_t allocated;
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+    Arena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @return bytes aligned to alignment, at most alignof(max_align_t), valid until reset
+     */
+    char* allocate(size_t bytes, size_t alignment = alignof(max_align_t));
+
+    /**
+     * @return a copy of some bytes in the arena
+     */
+    string_view copy(string_view bytes);
+
+    /**
+     * @brief free everything allocated, the views and pointers returned are not valid anymore
+     */
+    void reset();
+
+    /**
+     * @return number of bytes allocated since the last reset
+     */
+    size_t size() const;
+};
+
+#endif // ARENA_HPP
\ No newline at end of file
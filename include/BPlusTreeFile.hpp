@@ -0,0 +1,114 @@
+#ifndef BPLUSTREEFILE_HPP
+#define BPLUSTREEFILE_HPP
+
+#include <functional>
+
+#include "File.hpp"
+
+/**
+ * @class BPlusTreeFile
+ * @brief Store raw records clustered by key in a B+-tree.
+ *
+ * Every page of the file is a node of the tree. The leaves contain the whole records sorted by
+ * the raw bytes of their key (the first keySize bytes) and are linked to allow range scans,
+ * the internal nodes contain only the separator keys and the page numbers of the children.
+ * The page 0 is the header of the file.
+ *
+ * Lookup, insertion, deletion and the positioning of a range scan cost O(log n) page reads.
+ *
+ * @note the keys are compared with memcmp, so the order of a range scan is the order of the raw bytes
+ * @note the nodes are not merged when they become underfull, a deleted record leaves its space free in the leaf
+ */
+class BPlusTreeFile: public File {
+
+size_t keySize;
+size_t recordSize;
+uint32_t rootPage;
+uint32_t pageCount;
+uint32_t firstLeaf;
+uint64_t recordCount;
+
+public:
+    BPlusTreeFile(string fileName, size_t keySize, size_t recordSize, BufferPool& pool = BufferPool::shared());
+
+    ~BPlusTreeFile() override;
+
+    iterator<input_iterator_tag,string> begin() override;
+    iterator<input_iterator_tag,string> end() override;
+    /**
+     * @throw invalid_argument if the key of one of the records is already in the file
+     */
+    void pushData(string_view data) override;
+    /**
+     * @brief sort the records and, if they all follow the last key of the file, build the tree bottom-up
+     *
+     * The records fill the leaves from left to right and the separators are appended to the rightmost
+     * internal nodes, so every page is written once and left full. Otherwise the records are inserted
+     * in key order with pushData.
+     */
+    void bulkLoad(string_view data) override;
+    optional<string> deleteData(string_view key) override;
+    optional<string> getData(string_view key) override;
+    optional<RecordId> findRecord(string_view key) override;
+    string getByRid(RecordId rid) override;
+    void updateInPlace(RecordId rid, string_view data, size_t offset = 0) override;
+    /**
+     * @brief compact the records of every leaf, following the chain of the leaves
+     */
+    size_t deleteWhere(const function<bool(string_view)>& predicate) override;
+    size_t updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) override;
+    bool nextBatch(size_t& cursor, RecordBatch& batch) override;
+    size_t size() const override;
+    bool indexedLookup() const override;
+
+    /**
+     * @brief visit in key order the records with a key between low and high (both included)
+     *
+     * @param low the lowest key, an empty view means no lower bound
+     * @param high the highest key, an empty view means no upper bound
+     * @param consumer called for every record, the scan stops when it returns false
+     */
+    void scan(string_view low, string_view high, const function<bool(string_view)>& consumer);
+
+private:
+
+    friend class LeafIterator;
+
+    /**
+     * @return the maximum number of records in a leaf
+     */
+    size_t leafCapacity() const;
+
+    /**
+     * @return the maximum number of keys in an internal node
+     */
+    size_t internalCapacity() const;
+
+    /**
+     * @brief insert a record in the subtree with root in pageNo
+     *
+     * @return nullopt if the node was not split, otherwise the separator key and the page of the new right sibling
+     */
+    optional<pair<string,uint32_t>> insert(uint32_t pageNo, string_view record);
+
+    /**
+     * @brief append a separator and a child as the last entry of the rightmost node at a height of the tree
+     *
+     * @param path the rightmost nodes of the tree, from the leaf (height 0) to the root, updated when nodes are added
+     */
+    void appendChild(vector<uint32_t>& path, size_t height, string_view key, uint32_t child);
+
+    /**
+     * @return the leaf that could contain a key, the first leaf if the key is empty
+     */
+    uint32_t findLeaf(string_view key);
+
+    uint32_t allocatePage(bool leaf);
+
+    void loadHeader();
+
+    void saveHeader();
+
+};
+
+#endif // BPLUSTREEFILE_HPP
\ No newline at end of file
@@ -0,0 +1,150 @@
+#ifndef BUFFERPOOL_HPP
+#define BUFFERPOOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+class File;
+
+/**
+ * @struct Page
+ * @brief A frame of the buffer pool that holds a copy of one page of a File.
+ *
+ * @note the content of data is valid only while the page is pinned
+ */
+struct Page {
+    File* file;
+    size_t pageNo;
+    char* data;
+    size_t pinCount;
+    bool dirty;
+    bool referenced;
+    // LSN dell'ultimo record del log che ha modificato la pagina, 0 se non è registrata nel log
+    uint64_t lsn;
+};
+
+/**
+ * @class BufferPool
+ * @brief Shared cache of fixed-size pages that sits between the File subclasses and the disk.
+ *
+ * Every File reads and writes whole pages through a BufferPool. The pool keeps a page table
+ * that maps (file, page number) to a frame, tracks pinned and dirty frames and, when it is full,
+ * chooses the victim with the clock algorithm. Dirty pages are written back only when they are
+ * evicted or when the owner of the file flushes it. A page changed by records of a WriteAheadLog
+ * is written back only after those records are durable.
+ */
+class BufferPool {
+public:
+    static constexpr size_t PAGE_SIZE = 4096;
+    static constexpr size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    /**
+     * @param memoryBudget maximum number of bytes used for the frames, at least one page
+     */
+    BufferPool(size_t memoryBudget = DEFAULT_BUDGET);
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /**
+     * @return the pool used by the files that are not given one explicitly
+     */
+    static BufferPool& shared();
+
+    /**
+     * @brief load a page in the pool if it is not already there and pin it
+     *
+     * @return the frame holding the page, it will not be evicted until it is unpinned
+     * @throw runtime_error if every frame is pinned
+     */
+    Page& pin(File& file, size_t pageNo);
+
+    /**
+     * @brief release a page obtained with pin
+     *
+     * @param dirty true if the content of the page was modified
+     * @param lsn LSN of the record of the log that describes the change, 0 if it is not logged
+     */
+    void unpin(Page& page, bool dirty, uint64_t lsn = 0);
+
+    /**
+     * @brief write back every dirty page of a file
+     */
+    void flush(File& file);
+
+    /**
+     * @brief drop every page of a file from the pool without writing them back
+     */
+    void discard(File& file);
+
+    /**
+     * @return number of frames of the pool
+     */
+    size_t capacity() const;
+
+private:
+    struct PageId {
+        const File* file;
+        size_t pageNo;
+
+        bool operator==(const PageId& other) const {
+            return file == other.file && pageNo == other.pageNo;
+        }
+    };
+
+    struct PageIdHash {
+        size_t operator()(const PageId& id) const {
+            return hash<const File*>()(id.file) ^ (hash<size_t>()(id.pageNo) * 0x9E3779B97F4A7C15ULL);
+        }
+    };
+
+    unique_ptr<char[]> memory;
+    vector<Page> frames;
+    unordered_map<PageId, size_t, PageIdHash> pageTable;
+    size_t clockHand;
+    mutex latch;
+
+    /**
+     * @brief choose a frame to reuse with the clock algorithm, writing it back if it is dirty
+     */
+    size_t victim();
+
+    void writeBack(Page& page);
+};
+
+/**
+ * @class PageGuard
+ * @brief Keep a page pinned for the lifetime of the object.
+ */
+class PageGuard {
+    BufferPool& pool;
+    Page& page;
+    bool dirty;
+public:
+    PageGuard(BufferPool& pool, File& file, size_t pageNo)
+    : pool(pool), page(pool.pin(file, pageNo)), dirty(false) {}
+
+    ~PageGuard() { pool.unpin(page, dirty); }
+
+    PageGuard(const PageGuard&) = delete;
+    PageGuard& operator=(const PageGuard&) = delete;
+
+    char* data() { return page.data; }
+
+    const char* data() const { return page.data; }
+
+    size_t pageNo() const { return page.pageNo; }
+
+    /**
+     * @brief the page will be written back before being evicted
+     */
+    void markDirty() { dirty = true; }
+};
+
+#endif // BUFFERPOOL_HPP
\ No newline at end of file
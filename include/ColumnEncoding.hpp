@@ -0,0 +1,72 @@
+#ifndef COLUMNENCODING_HPP
+#define COLUMNENCODING_HPP
+
+#include "RecordBatch.hpp"
+#include "Domains.hpp"
+
+/*
+    Codifiche leggere per una sequenza di valori interi (un frame di una colonna).
+
+    Un frame codificato inizia con un byte che indica la codifica, seguito dal minimo e dal massimo
+    dei valori, così un predicato di intervallo può escludere o accettare il frame senza decodificarlo:
+    - FOR: ogni valore è la differenza dal minimo, impacchettata nel numero di bit della differenza massima
+    - DELTA: il primo valore e le differenze tra valori consecutivi, impacchettate come in FOR
+    - RLE: coppie (valore, fine della sequenza di valori uguali)
+    encodeIntegers sceglie la codifica più piccola per i valori del frame.
+
+    Sui processori x86 lo spacchettamento usa AVX2 quando è disponibile, altrimenti un ciclo scalare.
+*/
+
+/**
+ * @brief how the raw value of a field is read as an integer
+ */
+enum class IntegerKind : uint8_t {
+    None,       // il campo non è un intero
+    Native32,   // int nell'ordine dei byte della macchina (IntegerDomain)
+    Ordered32,  // 4 byte big-endian con il segno invertito (DateDomain)
+    Ordered64,  // 8 byte big-endian con il segno invertito (BigIntDomain, TimestampDomain, DecimalDomain)
+    Prefix      // i primi 8 byte di un campo ordinato da memcmp: valori diversi possono avere lo stesso intero
+};
+
+/**
+ * @return how the values of a domain are read as integers, IntegerKind::None if they are not integers
+ */
+IntegerKind integerKind(const Domain& domain);
+
+/**
+ * @return integerKind of a domain, or IntegerKind::Prefix if its values are ordered by memcmp
+ */
+IntegerKind orderKind(const Domain& domain);
+
+/**
+ * @return the integer that orders a raw value of a kind, for IntegerKind::Prefix its first 8 bytes
+ * (padded with zeros) as in loadInteger
+ */
+int64_t orderKey(IntegerKind kind, string_view value);
+
+/**
+ * @return the number of bytes of a raw value of a kind
+ */
+size_t integerSize(IntegerKind kind);
+
+int64_t loadInteger(IntegerKind kind, const char* value);
+
+void storeInteger(IntegerKind kind, int64_t value, char* out);
+
+/**
+ * @brief encode count values with the smallest of the encodings
+ */
+string encodeIntegers(const int64_t* values, size_t count);
+
+/**
+ * @brief decode the values from first to first + count - 1 of an encoded frame
+ */
+void decodeIntegers(string_view encoded, size_t first, size_t count, int64_t* out);
+
+/**
+ * @brief append to output base + i - first for every value i, from first to first + count - 1,
+ * between low and high (both included), comparing the encoded values when the encoding allows it
+ */
+void selectIntegers(string_view encoded, size_t first, size_t count, int64_t low, int64_t high, uint32_t base, SelectionVector& output);
+
+#endif // COLUMNENCODING_HPP
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
 
 /**
  * @brief The base class for all domains in the miniDBMS.
@@ -25,6 +28,31 @@ public:
      */
     virtual size_t size() const = 0;
     virtual bool operator==(const Domain& other) const = 0;
+    /**
+     * @brief convert the textual representation of a value, as written in a query, into its raw data
+     * 
+     * @return raw data of size() bytes
+     * @throw invalid_argument if the text is not a valid value of the domain
+     */
+    virtual std::string parse(const std::string_view text) const = 0;
+    /**
+     * @brief convert raw data into its textual representation
+     */
+    virtual std::string format(const std::string_view value) const = 0;
+    /**
+     * @brief compare two raw values of the domain
+     * 
+     * @return a negative number, zero or a positive number if a is less, equal or greater than b.
+     * By default the raw data is compared with memcmp
+     */
+    virtual int compare(const std::string_view a, const std::string_view b) const;
+    /**
+     * @brief write in out the normalized key of a raw value: size() bytes that compared with memcmp
+     * have the same order given by compare
+     * 
+     * By default the raw data is copied
+     */
+    virtual void normalize(const std::string_view value, char* out) const;
 
 };
 
@@ -35,16 +63,44 @@ using SharedDomain = std::shared_ptr<Domain>;
  * @brief Represents a domain with a fixed set of valid values.
  * 
  * This class inherits from the Domain class and provides functionality for working with domains that have a fixed set of valid values.
+ * The values are stored as dictionary codes of 1 byte, or 2 bytes if there are more than 255 values.
+ * The codes start from 1 in the alphabetical order of the values and are stored big-endian,
+ * so comparing the raw data with memcmp gives the order of the values. The code 0 is not valid.
  * 
  */
 class EnumDomain : public Domain {
     std::vector<std::string> validValues;
-    size_t max_len;
+    // i valori in ordine alfabetico: il valore con codice c è labels[c - 1]
+    std::vector<std::string> labels;
+    std::unordered_map<std::string, uint16_t> codes;
+    size_t codeSize;
 public:
+    /**
+     * @throw invalid_argument if there are more than 65535 distinct values
+     */
     EnumDomain(const std::vector<std::string>& validValues);
     bool isValid(const std::string_view value) const override;
+    /**
+     * @return the values allowed by the domain
+     */
+    const std::vector<std::string>& values() const;
+    /**
+     * @return the number of codes, the valid codes go from 1 to count()
+     */
+    size_t count() const;
+    /**
+     * @return the code stored in raw data
+     */
+    unsigned code(const std::string_view value) const {
+        unsigned result = (unsigned char)value[0];
+        if(codeSize == 2)
+            result = result << 8 | (unsigned char)value[1];
+        return result;
+    }
     size_t size() const override;
     bool operator==(const Domain& other) const override;
+    std::string parse(const std::string_view text) const override;
+    std::string format(const std::string_view value) const override;
 };
 
 /**
@@ -58,6 +114,10 @@ public:
     bool isValid(const std::string_view value) const override;
     size_t size() const override;
     bool operator==(const Domain& other) const override;
+    std::string parse(const std::string_view text) const override;
+    std::string format(const std::string_view value) const override;
+    int compare(const std::string_view a, const std::string_view b) const override;
+    void normalize(const std::string_view value, char* out) const override;
 };
 
 /**
@@ -66,6 +126,7 @@ public:
  * 
  * The StringDomain class is a subclass of the Domain class and is used to define a domain for string values.
  * It allows specifying a maximum length for the strings in the domain.
+ * The values are stored padded with '\0' up to the maximum length.
  */
 class StringDomain : public Domain {
     size_t max_len;
@@ -74,8 +135,103 @@ public:
     bool isValid(const std::string_view value) const override;
     size_t size() const override;
     bool operator==(const Domain& other) const override;
+    std::string parse(const std::string_view text) const override;
+    std::string format(const std::string_view value) const override;
 };
 
-//TODO: aggiungere domini
+/**
+ * @class BigIntDomain
+ * @brief Represents a domain for 64 bit integer values.
+ * 
+ * The values are stored big-endian with the sign bit flipped, so the raw data compared with memcmp
+ * has the order of the numbers and can be used as a key without decoding.
+ */
+class BigIntDomain : public Domain {
+public:
+    bool isValid(const std::string_view value) const override;
+    size_t size() const override;
+    bool operator==(const Domain& other) const override;
+    std::string parse(const std::string_view text) const override;
+    std::string format(const std::string_view value) const override;
+    /**
+     * @return the raw data of a number
+     */
+    static std::string encode(int64_t value);
+    /**
+     * @return the number stored in raw data
+     */
+    static int64_t decode(const std::string_view value);
+};
+
+/**
+ * @class DoubleDomain
+ * @brief Represents a domain for double precision floating point values.
+ * 
+ * The bits of the values are stored big-endian, with the sign bit flipped for the positive numbers
+ * and all the bits flipped for the negative ones, so memcmp gives the order of the numbers.
+ * NaN is not a valid value and -0 is stored as 0.
+ */
+class DoubleDomain : public Domain {
+public:
+    bool isValid(const std::string_view value) const override;
+    size_t size() const override;
+    bool operator==(const Domain& other) const override;
+    std::string parse(const std::string_view text) const override;
+    std::string format(const std::string_view value) const override;
+    static std::string encode(double value);
+    static double decode(const std::string_view value);
+};
+
+/**
+ * @class DateDomain
+ * @brief Represents a domain for dates, written as YYYY-MM-DD.
+ * 
+ * The values are the days from 1970-01-01, stored in 4 bytes big-endian with the sign bit flipped.
+ */
+class DateDomain : public Domain {
+public:
+    bool isValid(const std::string_view value) const override;
+    size_t size() const override;
+    bool operator==(const Domain& other) const override;
+    std::string parse(const std::string_view text) const override;
+    std::string format(const std::string_view value) const override;
+};
+
+/**
+ * @class TimestampDomain
+ * @brief Represents a domain for instants, written as YYYY-MM-DD HH:MM:SS with up to 6 decimal digits.
+ * 
+ * The values are the microseconds from 1970-01-01 00:00:00, stored like the numbers of BigIntDomain.
+ */
+class TimestampDomain : public Domain {
+public:
+    bool isValid(const std::string_view value) const override;
+    size_t size() const override;
+    bool operator==(const Domain& other) const override;
+    std::string parse(const std::string_view text) const override;
+    std::string format(const std::string_view value) const override;
+};
+
+/**
+ * @class DecimalDomain
+ * @brief Represents a domain for fixed point numbers with a precision and a scale, like DECIMAL(10,2).
+ * 
+ * The values are stored as the number multiplied by 10^scale, like the numbers of BigIntDomain.
+ */
+class DecimalDomain : public Domain {
+    size_t precision;
+    size_t scale;
+public:
+    /**
+     * @param precision the number of digits, at most 18
+     * @param scale the number of digits after the decimal point, at most precision
+     */
+    DecimalDomain(size_t precision, size_t scale);
+    bool isValid(const std::string_view value) const override;
+    size_t size() const override;
+    bool operator==(const Domain& other) const override;
+    std::string parse(const std::string_view text) const override;
+    std::string format(const std::string_view value) const override;
+};
 
 #endif // DOMAINS_HPP
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef EXTENDIBLEHASHFILE_HPP
+#define EXTENDIBLEHASHFILE_HPP
+
+#include <vector>
+
+#include "File.hpp"
+
+/**
+ * @class ExtendibleHashFile
+ * @brief Store raw records in the buckets of an extendible hash table on their key.
+ *
+ * The page 0 is the header of the file, the next DIRECTORY_PAGES pages contain the directory
+ * and all the others are buckets. A bucket that is full is split, doubling the directory when its
+ * local depth reaches the global depth. When the directory cannot grow anymore the full buckets
+ * are extended with a chain of overflow pages.
+ *
+ * Lookup, insertion and deletion cost O(1) expected page reads. The records have no order.
+ */
+class ExtendibleHashFile: public File {
+
+size_t keySize;
+size_t recordSize;
+uint32_t globalDepth;
+uint32_t pageCount;
+uint64_t recordCount;
+vector<uint32_t> directory;
+
+public:
+    static constexpr size_t DIRECTORY_PAGES = 64;
+
+    ExtendibleHashFile(string fileName, size_t keySize, size_t recordSize, BufferPool& pool = BufferPool::shared());
+
+    ~ExtendibleHashFile() override;
+
+    iterator<input_iterator_tag,string> begin() override;
+    iterator<input_iterator_tag,string> end() override;
+    /**
+     * @throw invalid_argument if the key of one of the records is already in the file
+     */
+    void pushData(string_view data) override;
+    optional<string> deleteData(string_view key) override;
+    optional<string> getData(string_view key) override;
+    optional<RecordId> findRecord(string_view key) override;
+    string getByRid(RecordId rid) override;
+    void updateInPlace(RecordId rid, string_view data, size_t offset = 0) override;
+    /**
+     * @brief compact the records of every bucket page
+     */
+    size_t deleteWhere(const function<bool(string_view)>& predicate) override;
+    size_t updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) override;
+    bool nextBatch(size_t& cursor, RecordBatch& batch) override;
+    size_t size() const override;
+    bool indexedLookup() const override;
+
+private:
+
+    friend class BucketIterator;
+
+    /**
+     * @return the maximum number of records in a bucket page
+     */
+    size_t bucketCapacity() const;
+
+    /**
+     * @return the bucket page associated to a key by the directory
+     */
+    uint32_t bucketOf(string_view key) const;
+
+    void insert(string_view record);
+
+    /**
+     * @brief split a bucket in two buckets with local depth increased by one
+     */
+    void splitBucket(uint32_t pageNo);
+
+    uint32_t allocatePage(uint8_t localDepth);
+
+    void loadHeader();
+
+    void saveHeader();
+
+    void saveDirectory();
+
+};
+
+#endif // EXTENDIBLEHASHFILE_HPP
\ No newline at end of file
@@ -3,10 +3,37 @@
 
 #include <string>
 #include <fstream>
+#include <functional>
 #include <optional>
+#include <memory>
+#include <vector>
+
+#include "BufferPool.hpp"
+#include "RecordBatch.hpp"
 
 using namespace std;
 
+class WriteAheadLog;
+
+/**
+ * @brief identifier of a record of a File, valid until the record is deleted or moved by the file
+ *
+ * Its meaning depends on the file: the heaps use the position of the record, the B+-tree and the
+ * hash file the page and the slot.
+ */
+using RecordId = uint64_t;
+
+/**
+ * @struct Morsel
+ * @brief A range of the records of a file that can be read independently of the other ranges.
+ *
+ * begin and end are positions of the file, their meaning depends on the file.
+ */
+struct Morsel {
+    size_t begin;
+    size_t end;
+};
+
 /**
  * @class File
  * @brief Represents a file in the miniDBMS system.
@@ -15,27 +42,43 @@ using namespace std;
  * It allows flushing and syncing of the file, as well as iterating over the records in the file.
  * It also provides methods to insert, delete, and retrieve data from the file.
  * 
+ * The content of the file is read and written in pages of BufferPool::PAGE_SIZE bytes through a BufferPool.
+ * The changes can be recorded in a WriteAheadLog, so that the pages can be written back lazily.
+ * 
  */
 class File {
     string name;
+    WriteAheadLog* log;
+    uint64_t lastLsn;
 protected:
     fstream file;
+    BufferPool& pool;
 public:
-    File(string fileName);
-    virtual ~File() = default;
+    /**
+     * @brief approximate size in bytes of a morsel, a multiple of BufferPool::PAGE_SIZE
+     */
+    static constexpr size_t MORSEL_SIZE = 64 * BufferPool::PAGE_SIZE;
+
+    File(string fileName, BufferPool& pool = BufferPool::shared());
+    virtual ~File();
 
     /**
      * @return file name as a reference
      */
     const string& filename() const;
     /**
-     * @brief flush the main stream of the file
+     * @brief write back the dirty pages of the file and flush the main stream
      */
     void flush();
     /**
-     * @brief sync the main stream of the file
+     * @brief make the content of the file durable on the disk
+     */
+    virtual void sync();
+
+    /**
+     * @brief record the next changes of the file in a log, that must outlive the file
      */
-    void sync();
+    void attachLog(WriteAheadLog& log);
 
     /**
      * @brief Returns an iterator of records without ordering.
@@ -53,6 +96,14 @@ public:
      * @brief push data on the file
      */
     virtual void pushData(string_view data) = 0;
+    /**
+     * @brief append many records at once
+     *
+     * The caller guarantees that the keys of the records are all different and not already in the file,
+     * so the file can skip the checks done by pushData and write the records sequentially.
+     * By default it is pushData.
+     */
+    virtual void bulkLoad(string_view data);
     /**
      * @brief delete data from the file
      */
@@ -64,6 +115,147 @@ public:
      */
     virtual optional<string> getData(string_view key) = 0;
 
+    /**
+     * @brief search a record by key
+     *
+     * @return nullopt if the record don't exists, the id of the record otherwise
+     */
+    virtual optional<RecordId> findRecord(string_view key) = 0;
+    /**
+     * @return the record with an id
+     * @throw out_of_range if there is no record with that id
+     */
+    virtual string getByRid(RecordId rid) = 0;
+    /**
+     * @brief overwrite some bytes of a record without moving it
+     *
+     * @param offset position of the bytes in the record, like Relation::startPointOf
+     * @throw out_of_range if there is no record with that id or the bytes go past the end of the record
+     * @throw invalid_argument if the bytes overlap the key, that decides where the record is stored
+     */
+    virtual void updateInPlace(RecordId rid, string_view data, size_t offset = 0) = 0;
+
+    /**
+     * @brief delete every record that satisfies a predicate with a single pass on the file
+     *
+     * @return number of records deleted
+     */
+    virtual size_t deleteWhere(const function<bool(string_view)>& predicate) = 0;
+    /**
+     * @brief change in place every record that satisfies a predicate with a single pass on the file
+     *
+     * @param update called on a copy of the record, that is then written in its place
+     * @return number of records changed
+     * @throw invalid_argument if update changes the key of a record, the records changed before stay changed
+     */
+    virtual size_t updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) = 0;
+
+    /**
+     * @brief read the next block of records of a scan without ordering
+     *
+     * @param cursor position of the scan, 0 to start from the beginning. It is opaque
+     * for the caller and it is advanced after the records read
+     * @param batch filled with up to RecordBatch::CAPACITY records
+     * @return false if there are no more records
+     */
+    virtual bool nextBatch(size_t& cursor, RecordBatch& batch) = 0;
+
+    /**
+     * @brief like nextBatch, but only some bytes of the records have to be read
+     *
+     * The other bytes of the records in the batch are undefined. The records that do not satisfy
+     * the filters can be left out, so the batch can be empty before the end of the scan.
+     * By default the whole records are read and the filters are ignored.
+     */
+    virtual bool nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters);
+
+    /**
+     * @return number of records in the file
+     */
+    virtual size_t size() const = 0;
+
+    /**
+     * @return true if getData finds a key without reading the whole file
+     */
+    virtual bool indexedLookup() const;
+
+    /**
+     * @brief split the records of the file in morsels for a parallel scan
+     *
+     * By default the whole file is a single morsel read with nextBatch
+     */
+    virtual vector<Morsel> morsels();
+
+    /**
+     * @brief read the next block of records of a morsel
+     *
+     * It can be called at the same time by more threads, on different morsels, while the file is not modified.
+     * @param cursor position in the morsel, 0 to start from the beginning of the morsel
+     * @return false if there are no more records in the morsel
+     */
+    virtual bool readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch);
+
+    /**
+     * @brief like readMorsel, but only some bytes of the records have to be read, see nextColumns
+     */
+    virtual bool readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters);
+
+protected:
+    /**
+     * @brief split the bytes from 0 to end, made of records of recordSize bytes, in morsels of about MORSEL_SIZE bytes
+     *
+     * Every morsel begins with the first record that starts in a new block of MORSEL_SIZE bytes,
+     * so the morsels are aligned to the pages as much as the records allow.
+     */
+    static vector<Morsel> splitRecords(size_t end, size_t recordSize);
+
+    /**
+     * @brief check the arguments of updateInPlace for records of recordSize bytes with a key of keySize bytes
+     */
+    static void checkUpdate(string_view data, size_t offset, size_t keySize, size_t recordSize);
+
+    /**
+     * @brief copy a record in out and apply an update of updateWhere to the copy
+     *
+     * @throw invalid_argument if the update changes the first keySize bytes
+     */
+    static void applyUpdate(const function<void(char*)>& update, string_view record, string& out, size_t keySize);
+
+    /**
+     * @brief copy len bytes of the file starting from pos into dst through the buffer pool
+     */
+    void readAt(size_t pos, char* dst, size_t len);
+
+    /**
+     * @brief copy len bytes from src in the file starting from pos through the buffer pool
+     *
+     * If the file has a log the change is recorded in it, but it is durable only after commit.
+     */
+    void writeAt(size_t pos, const char* src, size_t len);
+
+    /**
+     * @brief record in the log, if the file has one, that the file now ends at end
+     */
+    void logEnd(size_t end);
+
+    /**
+     * @brief wait until the changes recorded in the log are durable
+     */
+    void commit();
+
+private:
+    friend class BufferPool;
+
+    /**
+     * @brief read a whole page from the disk, the part after the end of the file is filled with zeros
+     */
+    void readPage(size_t pageNo, char* dst);
+
+    /**
+     * @brief write a whole page on the disk
+     */
+    void writePage(size_t pageNo, const char* src);
+
 };
 
 using FilePtr = unique_ptr<File>;
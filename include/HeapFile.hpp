@@ -2,30 +2,85 @@
 #define HEAPFILE_HPP
 
 #include "File.hpp"
+#include "ExtendibleHashFile.hpp"
+#include "ZoneMap.hpp"
 
 /**
  * @class HeapFile
  * @brief Store raw records as a heap. The file has no particular sort order or structure.
+ *
+ * Optionally the heap keeps a sidecar ExtendibleHashFile (named as the file with the ".hidx" suffix)
+ * that maps every key to the position of its record, so that the searches by key do not scan the file.
+ * It can also keep a ZoneMap of some fields (in a sidecar with the ".zmap" suffix), that lets the scans
+ * with filters skip the blocks of records that cannot satisfy them.
  */
 class HeapFile: public File {
 
 size_t keySize;
 size_t recordSize;
 long endFilePosition;
+unique_ptr<ExtendibleHashFile> index;
+unique_ptr<ZoneMap> zones;
+// descrittore usato per leggere i morsel con pread, aperto dal primo morsels()
+int readFd;
 
 public:
-    HeapFile(string fileName, size_t keySize, size_t recordSize);
+    /**
+     * @param hashIndex true to maintain the hash index on the keys
+     * @param zoneFields fields summarized by the zone map, empty for no zone map
+     */
+    HeapFile(string fileName, size_t keySize, size_t recordSize, BufferPool& pool = BufferPool::shared(), bool hashIndex = false, vector<ZoneField> zoneFields = {});
 
     ~HeapFile() override;
 
     iterator<input_iterator_tag,string> begin() override;
     iterator<input_iterator_tag,string> end() override;
+    /**
+     * @throw invalid_argument if there is a hash index and the key of one of the records is already in the file
+     */
     void pushData(string_view data) override;
+    /**
+     * @brief append the records with a single write and add their keys to the hash index all together
+     */
+    void bulkLoad(string_view data) override;
+    /**
+     * @brief delete a record moving the last record of the file in its place
+     *
+     * @return the deleted record
+     */
     optional<string> deleteData(string_view key) override;
     optional<string> getData(string_view key) override;
+    optional<RecordId> findRecord(string_view key) override;
+    string getByRid(RecordId rid) override;
+    void updateInPlace(RecordId rid, string_view data, size_t offset = 0) override;
+    /**
+     * @brief compact the records that are kept toward the beginning of the file and truncate it once
+     */
+    size_t deleteWhere(const function<bool(string_view)>& predicate) override;
+    size_t updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) override;
+    bool nextBatch(size_t& cursor, RecordBatch& batch) override;
+    /**
+     * @brief like nextBatch, but skip the blocks of the zone map that cannot satisfy the filters
+     */
+    bool nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) override;
+    size_t size() const override;
+    bool indexedLookup() const override;
+    /**
+     * @brief write back the dirty pages, the morsels are read from the disk with pread
+     */
+    vector<Morsel> morsels() override;
+    bool readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) override;
+    bool readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) override;
 
 private:
 
+    friend class RecordIterator;
+
+    /**
+     * @brief read the record that starts at a position of the file
+     */
+    string readRecord(long position);
+
     /**
      * @brief search the position on the file of a record with a selected key
      * @param key the key of the record to search
@@ -52,6 +107,38 @@ private:
      */
     void truncateFile();
 
+    /**
+     * @brief open the hash index, rebuilding it if it was not closed by closeIndex or does not match the records of the file
+     *
+     * The number of entries is not enough: a crash while records are moved leaves their old positions in the index.
+     */
+    void openIndex();
+
+    /**
+     * @brief close the hash index and, once it is on the disk, mark it as consistent with a ".hidx.clean" sidecar
+     */
+    void closeIndex();
+
+    /**
+     * @brief load the zone map, rebuilding it if it does not match the records of the file
+     */
+    void openZones();
+
+    /**
+     * @brief add to the zone map the records written from a position of the file
+     */
+    void addZones(long position, string_view data);
+
+    /**
+     * @return the first position from cursor whose block of the zone map may satisfy the filters, or end
+     */
+    size_t skipZones(size_t cursor, size_t end, const vector<IntegerFilter>& filters) const;
+
+    /**
+     * @return the entry of the hash index for a record at a position
+     */
+    string indexEntry(string_view key, long position) const;
+
 };
 
 #endif // HEAPFILE_HPP
\ No newline at end of file
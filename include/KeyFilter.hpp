@@ -0,0 +1,87 @@
+#ifndef KEYFILTER_HPP
+#define KEYFILTER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @class KeyFilter
+ * @brief A blocked Bloom filter on the keys of a table, saved in a sidecar file.
+ *
+ * Every key sets BITS_PER_KEY_SET bits in a single block of 512 bits (a cache line), so a lookup
+ * reads one block. mayContain has no false negatives: when it returns false the key is surely not
+ * in the table and the file does not have to be read.
+ *
+ * A Bloom filter cannot remove keys: the removed keys are only counted, and when they are too many,
+ * or the keys are more than the capacity the filter was sized for, stale() asks the owner to rebuild it
+ * with reset and add. Like ZoneMap, the sidecar is removed at the first change after it is saved.
+ */
+class KeyFilter {
+
+string fileName;
+vector<uint64_t> bits;
+uint64_t capacity;
+uint64_t count;
+uint64_t removed;
+bool saved;
+
+public:
+    // circa l'1% di falsi positivi alla capacità
+    static constexpr size_t BITS_PER_KEY = 10;
+    static constexpr size_t BITS_PER_KEY_SET = 7;
+    static constexpr size_t MIN_CAPACITY = 1024;
+
+    explicit KeyFilter(string fileName);
+
+    /**
+     * @brief save the filter, see save
+     */
+    ~KeyFilter();
+
+    /**
+     * @brief load the sidecar file
+     *
+     * @return false if it does not exist or it does not have keyCount keys
+     */
+    bool load(size_t keyCount);
+
+    /**
+     * @brief write the sidecar file, if it cannot be written the filter is rebuilt when it is opened again
+     */
+    void save();
+
+    /**
+     * @brief empty the filter and size it for the keys of a table that has keyCount keys
+     */
+    void reset(size_t keyCount);
+
+    void add(string_view key);
+
+    /**
+     * @brief note that some keys have been removed from the table
+     */
+    void remove(size_t keys = 1);
+
+    /**
+     * @return false if the key is surely not in the table
+     */
+    bool mayContain(string_view key) const;
+
+    /**
+     * @return true if the filter has to be rebuilt to keep its false positives low
+     */
+    bool stale() const;
+
+private:
+    /**
+     * @brief remove the sidecar file, that does not describe the keys anymore
+     */
+    void invalidate();
+
+};
+
+#endif // KEYFILTER_HPP
\ No newline at end of file
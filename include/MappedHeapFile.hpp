@@ -0,0 +1,98 @@
+#ifndef MAPPEDHEAPFILE_HPP
+#define MAPPEDHEAPFILE_HPP
+
+#include "File.hpp"
+
+/**
+ * @class MappedHeapFile
+ * @brief Store raw records as a heap, like HeapFile, accessing them through a memory mapping of the file.
+ *
+ * The records can be read as views on the mapping without copying them. The mapping grows in chunks
+ * of at least GROWTH_CHUNK bytes when data is pushed and is shrunk when the file is truncated.
+ * The format on disk is the same of HeapFile, so the two classes can open the same file.
+ *
+ * @note the buffer pool is not used, the page cache of the kernel takes its place
+ * @note the mapping uses the POSIX mmap and the Linux mremap, so the class is not available on Windows
+ * @note the file is longer than its records while it is open: with a WriteAheadLog attached every change of the
+ * end is logged, so that recovery cuts the file after a crash; without a log the padding stays and reads as records
+ * @note a view returned by this class is invalidated by any change to the file
+ */
+class MappedHeapFile: public File {
+
+size_t keySize;
+size_t recordSize;
+long endFilePosition;
+int fd;
+char* mapping;
+size_t capacity;
+
+public:
+    static constexpr size_t GROWTH_CHUNK = 1024 * 1024;
+
+    MappedHeapFile(string fileName, size_t keySize, size_t recordSize);
+
+    ~MappedHeapFile() override;
+
+    iterator<input_iterator_tag,string> begin() override;
+    iterator<input_iterator_tag,string> end() override;
+    void pushData(string_view data) override;
+    /**
+     * @brief delete a record moving the last record of the file in its place
+     *
+     * @return the deleted record
+     */
+    optional<string> deleteData(string_view key) override;
+    optional<string> getData(string_view key) override;
+    optional<RecordId> findRecord(string_view key) override;
+    string getByRid(RecordId rid) override;
+    void updateInPlace(RecordId rid, string_view data, size_t offset = 0) override;
+    /**
+     * @brief compact the records that are kept toward the beginning of the mapping and truncate it once
+     */
+    size_t deleteWhere(const function<bool(string_view)>& predicate) override;
+    size_t updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) override;
+    bool nextBatch(size_t& cursor, RecordBatch& batch) override;
+    size_t size() const override;
+    vector<Morsel> morsels() override;
+    /**
+     * @brief point the batch to the records of the morsel in the mapping, without copying them
+     */
+    bool readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) override;
+
+    /**
+     * @brief write the modified pages of the mapping on the disk with msync
+     */
+    void sync() override;
+
+    /**
+     * @brief search data starting with a key without copying it
+     *
+     * @return nullopt if the record don't exists, a view on the mapped record otherwise
+     */
+    optional<string_view> viewData(string_view key) const;
+
+    /**
+     * @return a view on the i-th record of the file
+     */
+    string_view recordAt(size_t i) const;
+
+private:
+
+    /**
+     * @return -1 if the record don't exist or the starting position of the record
+     */
+    long searchPosition(string_view key) const;
+
+    /**
+     * @brief resize the file and the mapping to newCapacity bytes
+     */
+    void remap(size_t newCapacity);
+
+    /**
+     * @brief truncate file and mapping where the end pointer points
+     */
+    void truncateFile();
+
+};
+
+#endif // MAPPEDHEAPFILE_HPP
\ No newline at end of file
@@ -0,0 +1,662 @@
+#ifndef OPERATORS_HPP
+#define OPERATORS_HPP
+
+#include "StorageEngine.hpp"
+#include "Predicates.hpp"
+#include "SpillFile.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @struct Column
+ * @brief A column of the rows produced by an Operator: the field, the name of the table
+ * it comes from and the offset of its value in the row.
+ */
+struct Column {
+    string table;
+    Field field;
+    size_t offset;
+};
+
+/**
+ * @return the columns of the records of a relation, named after a table
+ */
+vector<Column> columnsOf(const Relation& rel, const string& table);
+
+/**
+ * @brief search a column by name
+ *
+ * @param table name of the table of the column, empty to search in all the tables
+ * @return the index of the column
+ * @throw invalid_argument if the column does not exist or the name is ambiguous
+ */
+size_t columnIndex(const vector<Column>& columns, string_view table, string_view name);
+
+enum class CompareOp {
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual
+};
+
+/**
+ * @struct Condition
+ * @brief Comparison between a column of a row and a constant raw value of the domain of the column.
+ *
+ * The constant of a prepared statement comes from a parameter: the text of its value is shared with the
+ * statement, that changes it before every execution, and bind parses it again in the domain of the column.
+ */
+struct Condition {
+    Column column;
+    CompareOp op;
+    string value;
+    // il testo del valore di un parametro, nullptr se la costante è nella query
+    shared_ptr<const string> parameter;
+
+    bool matches(string_view row) const;
+
+    /**
+     * @brief set value to the current value of the parameter, if there is one
+     *
+     * @throw invalid_argument if the value is not valid in the domain of the column
+     */
+    void bind();
+};
+
+/**
+ * @class Operator
+ * @brief A node of a pull-based (Volcano) query pipeline.
+ *
+ * The rows flow from the leaves to the root one at a time: every call to next pulls
+ * from the children only the rows needed to produce one row, so a pipeline runs in
+ * bounded memory and stops reading its input as soon as the root stops asking.
+ * A row is the concatenation of the values of its columns.
+ */
+class Operator {
+public:
+    virtual ~Operator() = default;
+
+    /**
+     * @brief prepare the operator, and its children, to produce rows
+     */
+    virtual void open() = 0;
+
+    /**
+     * @return the next row, nullopt when there are no more rows.
+     * The view is valid until the next call to next or close
+     */
+    virtual optional<string_view> next() = 0;
+
+    /**
+     * @brief release the resources of the operator and of its children
+     */
+    virtual void close() = 0;
+
+    /**
+     * @return the layout of the rows produced
+     */
+    virtual const vector<Column>& columns() const = 0;
+
+    /**
+     * @return an upper bound of the number of rows produced, nullopt if it is unknown
+     */
+    virtual optional<size_t> estimatedRows() const { return nullopt; }
+};
+
+/**
+ * @return the length of the rows with some columns
+ */
+size_t rowSize(const vector<Column>& columns);
+
+using OperatorPtr = unique_ptr<Operator>;
+
+/**
+ * @class MorselQueue
+ * @brief The morsels of a table shared by more TableScan that run in parallel: each morsel is given to only one of them.
+ *
+ * The morsels are handed out in order while they last, so a faster scan simply takes more morsels.
+ * @note a queue is consumed once, a new scan needs a new queue
+ */
+class MorselQueue {
+    vector<Morsel> morsels;
+    atomic<size_t> position;
+public:
+    MorselQueue(Table& table);
+
+    /**
+     * @return the next morsel not taken yet, nullopt if they are over
+     */
+    optional<Morsel> take();
+
+    /**
+     * @return number of morsels of the table
+     */
+    size_t size() const;
+};
+
+/**
+ * @class TableScan
+ * @brief Produce all the records of a table that satisfy some conditions.
+ *
+ * The table is read in RecordBatch blocks and the conditions are evaluated on the whole
+ * block with the kernels of Predicates.hpp when the domain of the column allows it.
+ * With a MorselQueue the scan reads only the morsels it takes from the queue.
+ * When the needed columns are given the other bytes of the records may be left unread by the file.
+ * The conditions on integer columns are also given to the file as filters, that it can check
+ * before building the batch (see File::nextColumns): they are evaluated again on the batch anyway.
+ * The conditions are bound, and the filters built, at every open.
+ */
+class TableScan: public Operator {
+    Table& table;
+    vector<Column> cols;
+    vector<Condition> conditions;
+    ColumnRanges needed;
+    vector<IntegerFilter> filters;
+    shared_ptr<MorselQueue> morsels;
+    optional<Morsel> morsel;
+    size_t cursor;
+    RecordBatch batch;
+    SelectionVector selection;
+    SelectionVector scratch;
+    size_t position;
+public:
+    /**
+     * @param needed byte ranges of the records used by the query, all the bytes if it is empty
+     */
+    TableScan(Table& table, const string& alias, vector<Condition> conditions = {}, shared_ptr<MorselQueue> morsels = nullptr, ColumnRanges needed = {});
+
+    void open() override;
+    optional<string_view> next() override;
+    void close() override;
+    const vector<Column>& columns() const override;
+    optional<size_t> estimatedRows() const override;
+
+private:
+    /**
+     * @brief read batches until one has at least a record that satisfies the conditions
+     *
+     * @return false if the table is over
+     */
+    bool nextBatch();
+
+    /**
+     * @brief read the next batch of the table, or of the morsels taken from the queue
+     */
+    bool readBatch();
+
+    /**
+     * @brief build the filters given to the file from the conditions on integer columns
+     */
+    void buildFilters();
+
+    void filter(const Condition& condition, const SelectionVector* input, SelectionVector& output) const;
+};
+
+/**
+ * @class KeyLookup
+ * @brief Produce the record of a table with a given key, if it exists.
+ */
+class KeyLookup: public Operator {
+    Table& table;
+    string key;
+    vector<Condition> keyConditions;
+    vector<Column> cols;
+    string row;
+    bool done;
+public:
+    KeyLookup(Table& table, const string& alias, string key);
+
+    /**
+     * @param keyConditions equalities on the fields of the key, in their order: at every open
+     * they are bound and their values make the key
+     */
+    KeyLookup(Table& table, const string& alias, vector<Condition> keyConditions);
+
+    void open() override;
+    optional<string_view> next() override;
+    void close() override;
+    const vector<Column>& columns() const override;
+    optional<size_t> estimatedRows() const override;
+};
+
+/**
+ * @class Filter
+ * @brief Produce the rows of the child that satisfy all the conditions.
+ */
+class Filter: public Operator {
+    OperatorPtr child;
+    vector<Condition> conditions;
+public:
+    Filter(OperatorPtr child, vector<Condition> conditions);
+
+    void open() override;
+    optional<string_view> next() override;
+    void close() override;
+    const vector<Column>& columns() const override;
+    optional<size_t> estimatedRows() const override;
+};
+
+/**
+ * @class Projection
+ * @brief Produce for every row of the child only some of its columns.
+ */
+class Projection: public Operator {
+    OperatorPtr child;
+    vector<size_t> indexes;
+    vector<Column> cols;
+    string row;
+public:
+    /**
+     * @param indexes the indexes of the columns of the child to keep, in the order of the output
+     */
+    Projection(OperatorPtr child, vector<size_t> indexes);
+
+    void open() override;
+    optional<string_view> next() override;
+    void close() override;
+    const vector<Column>& columns() const override;
+    optional<size_t> estimatedRows() const override;
+};
+
+/**
+ * @class Limit
+ * @brief Skip the first offset rows of the child and produce at most limit rows.
+ *
+ * After the last row the child is not asked for more rows.
+ */
+class Limit: public Operator {
+    OperatorPtr child;
+    size_t limit;
+    size_t offset;
+    size_t skipped;
+    size_t produced;
+public:
+    Limit(OperatorPtr child, size_t limit, size_t offset = 0);
+
+    void open() override;
+    optional<string_view> next() override;
+    void close() override;
+    const vector<Column>& columns() const override;
+    optional<size_t> estimatedRows() const override;
+};
+
+/**
+ * @class HashJoin
+ * @brief Inner equi-join of two inputs. A row produced is a row of the left input followed by a row of the right input.
+ *
+ * The input with fewer rows according to estimatedRows is the build input: its rows are loaded in a hash table
+ * keyed on the raw bytes of the join columns, then every row of the other input probes the table.
+ * When the build input does not fit in memoryBudget bytes the join falls back to grace hash join:
+ * both inputs are split by the hash of their keys in PARTITIONS pairs of temporary HeapFile, then the pairs
+ * are joined one at a time. A partition still too big is split again, with a different hash,
+ * up to MAX_DEPTH times.
+ */
+class HashJoin: public Operator {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+    static constexpr size_t PARTITIONS = 32;
+    static constexpr size_t MAX_DEPTH = 3;
+
+private:
+    class HashTable;
+
+    // partizioni con le righe delle due parti che hanno lo stesso hash della chiave
+    struct Partition {
+        unique_ptr<SpillFile> build;
+        unique_ptr<SpillFile> probe;
+        size_t depth;
+    };
+
+    OperatorPtr left;
+    OperatorPtr right;
+    vector<size_t> leftKeys;
+    vector<size_t> rightKeys;
+    size_t memoryBudget;
+    vector<Column> cols;
+    bool buildLeft;
+
+    unique_ptr<HashTable> table;
+    vector<Partition> partitions;
+    bool spilled;
+    unique_ptr<SpillFile> probeFile;
+    size_t probeCursor;
+    size_t probePosition;
+    RecordBatch probeBatch;
+    string_view probeRow;
+    string key;
+    vector<const char*> matches;
+    size_t matchPosition;
+    string row;
+public:
+    /**
+     * @param leftKeys indexes of the join columns of the left input
+     * @param rightKeys indexes of the join columns of the right input, leftKeys[i] is compared with rightKeys[i]
+     * @throw invalid_argument if the join columns are missing or two compared columns have different domains
+     */
+    HashJoin(OperatorPtr left, OperatorPtr right, vector<size_t> leftKeys, vector<size_t> rightKeys, size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+    ~HashJoin() override;
+
+    void open() override;
+    optional<string_view> next() override;
+    void close() override;
+    const vector<Column>& columns() const override;
+    optional<size_t> estimatedRows() const override;
+
+private:
+    Operator& buildInput() const;
+    Operator& probeInput() const;
+
+    /**
+     * @return the key of a row of the build input (build true) or of the probe input
+     */
+    string_view keyOf(string_view row, bool build);
+
+    /**
+     * @brief load the build input in the hash table, partitioning both inputs if it does not fit
+     */
+    void build();
+
+    /**
+     * @brief move the rows of the hash table and the rest of the inputs in new partitions
+     */
+    void spill();
+
+    /**
+     * @brief split a pair of partitions in PARTITIONS pairs with a new hash
+     */
+    void split(Partition& partition);
+
+    /**
+     * @brief load the next pair of partitions that fits in memory
+     *
+     * @return false if there are no more partitions
+     */
+    bool nextPartition();
+
+    /**
+     * @return the next row of the current probe input
+     */
+    optional<string_view> nextProbeRow();
+};
+
+/**
+ * @struct SortKey
+ * @brief A column of the rows of the input of a Sort and the direction of its order.
+ */
+struct SortKey {
+    size_t column;
+    bool descending;
+};
+
+/**
+ * @class Sort
+ * @brief Produce the rows of the child ordered by some columns, with an external merge sort in bounded memory.
+ *
+ * Every row is stored after its normalized key (see Domain::normalize, the bytes of a descending
+ * column are inverted) so that two rows are compared with a single memcmp. The rows are collected
+ * until they fill memoryBudget bytes, then they are sorted and written as a run in a SpillFile.
+ * The runs are merged with a loser tree, reading from each run one RecordBatch at a time:
+ * when there are too many runs to keep a batch of each in memory, they are merged in more passes.
+ * If all the rows fit in memory no file is written. Rows with equal keys keep the order of the child.
+ */
+class Sort: public Operator {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+
+private:
+    class Merger;
+
+    OperatorPtr child;
+    vector<SortKey> keys;
+    size_t memoryBudget;
+    size_t keySize;
+    size_t rowSize;
+
+    string entries;
+    vector<uint32_t> order;
+    size_t position;
+    vector<unique_ptr<SpillFile>> runs;
+    unique_ptr<Merger> merger;
+public:
+    /**
+     * @throw invalid_argument if there are no keys
+     */
+    Sort(OperatorPtr child, vector<SortKey> keys, size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+    ~Sort() override;
+
+    void open() override;
+    optional<string_view> next() override;
+    void close() override;
+    const vector<Column>& columns() const override;
+    optional<size_t> estimatedRows() const override;
+
+private:
+    /**
+     * @brief append a row of the child, preceded by its normalized key, to the entries in memory
+     */
+    void append(string_view row);
+
+    /**
+     * @brief sort the entries in memory
+     */
+    void sortEntries();
+
+    /**
+     * @brief sort the entries in memory and write them in a new run
+     */
+    void spillRun();
+};
+
+enum class AggregateFunction {
+    Count,
+    Sum,
+    Min,
+    Max,
+    Avg
+};
+
+/**
+ * @struct Aggregate
+ * @brief An aggregate function computed by a HashAggregate on a column of its input.
+ */
+struct Aggregate {
+    AggregateFunction function;
+    // colonna dell'input, nullopt per COUNT(*)
+    optional<size_t> column;
+    // nome della colonna prodotta
+    string name;
+};
+
+/**
+ * @brief the phase of a two-phase aggregation
+ *
+ * Complete aggregates the rows in a single operator. Partial aggregates a part of the rows and produces,
+ * instead of the results, the states of the aggregates; Final merges the states produced by some Partial
+ * operators, so the rows can be aggregated in parallel by more Partial operators.
+ */
+enum class AggregateMode {
+    Complete,
+    Partial,
+    Final
+};
+
+/**
+ * @class HashAggregate
+ * @brief Group the rows of the child by some columns and compute some aggregates for every group.
+ *
+ * The groups are kept in an open-addressing table keyed on the raw bytes of the group columns:
+ * every entry is the key followed by the states of the aggregates, stored inline.
+ * When the entries exceed memoryBudget bytes the groups already in the table keep being updated,
+ * while the rows of new groups are written, split by the hash of the key, in PARTITIONS SpillFile;
+ * after the groups in memory every partition is aggregated on its own, partitioning again
+ * with a different hash up to MAX_DEPTH times.
+ *
+ * A row produced has the group columns followed by a column for each aggregate. COUNT and SUM are
+ * BigIntDomain columns, AVG is a DoubleDomain column and MIN and MAX have the domain of their column;
+ * in Partial mode COUNT, SUM and AVG produce their states as StringDomain columns. SUM and AVG need
+ * IntegerDomain or BigIntDomain columns: DOUBLE and DECIMAL columns are rejected.
+ * In Final mode the child must produce the rows of a Partial HashAggregate with the same aggregates and
+ * the columns of groupColumns and Aggregate::column are the ones of the rows with the states.
+ * Without group columns a Complete or Final aggregation produces a row also for an empty input.
+ */
+class HashAggregate: public Operator {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024;
+    static constexpr size_t PARTITIONS = 32;
+    static constexpr size_t MAX_DEPTH = 3;
+
+private:
+    // ogni partizione contiene righe dell'input di gruppi che non erano nella tabella
+    struct Partition {
+        unique_ptr<SpillFile> rows;
+        size_t depth;
+    };
+
+    OperatorPtr child;
+    vector<size_t> groupColumns;
+    vector<Aggregate> aggregates;
+    AggregateMode mode;
+    size_t memoryBudget;
+    vector<Column> cols;
+    size_t keySize;
+    // offset dello stato di ogni aggregato dall'inizio di un elemento, e dimensione di un elemento
+    vector<size_t> stateOffsets;
+    size_t entrySize;
+
+    string entries;
+    size_t entryCount;
+    vector<uint32_t> slots;
+    vector<uint32_t> slotHashes;
+    vector<Partition> partitions;
+    vector<unique_ptr<SpillFile>> spill;
+    size_t depth;
+    size_t position;
+    string key;
+    string row;
+public:
+    /**
+     * @param groupColumns indexes of the columns of the child that define the groups
+     * @throw invalid_argument if SUM or AVG are applied to a column that is not an integer
+     */
+    HashAggregate(OperatorPtr child, vector<size_t> groupColumns, vector<Aggregate> aggregates,
+        AggregateMode mode = AggregateMode::Complete, size_t memoryBudget = DEFAULT_MEMORY_BUDGET);
+
+    ~HashAggregate() override;
+
+    void open() override;
+    optional<string_view> next() override;
+    void close() override;
+    const vector<Column>& columns() const override;
+    optional<size_t> estimatedRows() const override;
+
+private:
+    /**
+     * @return the number of bytes of the state of an aggregate
+     */
+    size_t stateSize(const Aggregate& aggregate) const;
+
+    /**
+     * @brief add a row of the input to its group, or to a partition if its group is new and there is no memory
+     */
+    void consume(string_view input);
+
+    /**
+     * @return the entry of a key, nullptr if it is not in the table and it cannot be added
+     */
+    char* findOrInsert(string_view key, size_t hash, bool insert, bool& created);
+
+    /**
+     * @brief double the slots of the table
+     */
+    void grow();
+
+    /**
+     * @brief update the states of an entry with a row of the input
+     */
+    void update(char* entry, string_view input, bool created);
+
+    /**
+     * @brief write in row the result for an entry
+     */
+    void produce(const char* entry);
+
+    /**
+     * @brief empty the table and aggregate the rows of the next partition
+     *
+     * @return false if there are no more partitions
+     */
+    bool nextPartition();
+
+    /**
+     * @brief move the partitions written while aggregating in the list of the partitions to aggregate
+     */
+    void flushSpill();
+
+    void clearTable();
+};
+
+/**
+ * @class Gather
+ * @brief Run some pipelines in parallel on a ThreadPool and produce the rows of all of them, in no particular order.
+ *
+ * Every pipeline runs on a worker of the pool and hands its rows in chunks of CHUNK_ROWS to a queue of at most
+ * MAX_CHUNKS chunks, where next takes them: the workers wait when the consumer is slower, so the memory is bounded.
+ * The pipelines are usually TableScan sharing a MorselQueue, with other operators on top of them.
+ * The pipelines start at the first call to next, not at open, so the workers are not taken by a Gather that is
+ * opened but not read yet, like the probe input of a HashJoin while it reads its build input.
+ *
+ * @note the pipelines must produce rows with the same columns, and next must not be called from a worker of the pool
+ */
+class Gather: public Operator {
+public:
+    static constexpr size_t CHUNK_ROWS = RecordBatch::CAPACITY;
+    static constexpr size_t MAX_CHUNKS = 64;
+
+private:
+    struct Exchange;
+
+    vector<OperatorPtr> pipelines;
+    ThreadPool& pool;
+    shared_ptr<Exchange> exchange;
+    string chunk;
+    size_t position;
+    // aperto ma con le pipeline non ancora avviate se exchange è nullo
+    bool opened;
+public:
+    /**
+     * @throw invalid_argument if there are no pipelines or they produce rows of different length
+     */
+    Gather(vector<OperatorPtr> pipelines, ThreadPool& pool = ThreadPool::shared());
+
+    ~Gather() override;
+
+    void open() override;
+    /**
+     * @throw the first exception thrown by a pipeline
+     */
+    optional<string_view> next() override;
+    void close() override;
+    const vector<Column>& columns() const override;
+    optional<size_t> estimatedRows() const override;
+
+    /**
+     * @brief replace every pipeline p with transform(p), to run more operators in parallel
+     */
+    void transform(const function<OperatorPtr(OperatorPtr)>& transform);
+
+private:
+    /**
+     * @brief submit the pipelines to the pool
+     */
+    void start();
+
+    /**
+     * @brief run a pipeline on a worker, handing its rows to the consumer through an exchange
+     */
+    void run(size_t pipeline, Exchange& exchange);
+};
+
+#endif // OPERATORS_HPP
\ No newline at end of file
@@ -0,0 +1,167 @@
+#ifndef PAXFILE_HPP
+#define PAXFILE_HPP
+
+#include "File.hpp"
+#include "ColumnEncoding.hpp"
+
+/**
+ * @class PaxFile
+ * @brief Store raw records column by column inside blocks of pages (Partition Attributes Across).
+ *
+ * The page 0 is the header of the file, the other pages are grouped in blocks of BLOCK_PAGES pages.
+ * A block holds the same number of records for every field: the values of each field are stored one
+ * after the other in a minipage of the block, so a scan that needs a few fields of a wide record
+ * reads only the pages of their minipages. The records are dense: the record i is in the slot
+ * i % capacity of the block i / capacity, and its position is its RecordId.
+ *
+ * The fields are the consecutive ranges of the records given by their sizes, in the order of the record.
+ * Like HeapFile, the searches by key scan the key of every record and a deleted record is replaced
+ * by the last one.
+ *
+ * The minipages of the integer fields of a full block are encoded in frames of FRAME_VALUES values
+ * (see ColumnEncoding.hpp), when that makes them smaller: the block begins with the length of every
+ * encoded minipage, 0 if the minipage is not encoded. A block is decoded before it is changed and
+ * encoded again when it is full. The filters of a scan are checked on the encoded frames.
+ */
+class PaxFile: public File {
+
+size_t keySize;
+size_t recordSize;
+vector<size_t> fieldSizes;
+vector<size_t> fieldOffsets;
+vector<IntegerKind> fieldKinds;
+size_t blockHeaderSize;
+size_t blockCapacity;
+uint64_t recordCount;
+
+public:
+    static constexpr size_t BLOCK_PAGES = 16;
+    static constexpr size_t BLOCK_SIZE = BLOCK_PAGES * BufferPool::PAGE_SIZE;
+    static constexpr size_t FRAME_VALUES = RecordBatch::CAPACITY;
+
+    /**
+     * @param fieldSizes size of every field, in the order of the record
+     * @param fieldKinds how every field is read as an integer, empty if no field has to be encoded
+     */
+    PaxFile(string fileName, size_t keySize, vector<size_t> fieldSizes, vector<IntegerKind> fieldKinds = {}, BufferPool& pool = BufferPool::shared());
+
+    ~PaxFile() override;
+
+    iterator<input_iterator_tag,string> begin() override;
+    iterator<input_iterator_tag,string> end() override;
+    /**
+     * @brief append the records, writing every field of the records of a block with a single write
+     */
+    void pushData(string_view data) override;
+    /**
+     * @brief delete a record moving the last record of the file in its place
+     *
+     * @return the deleted record
+     */
+    optional<string> deleteData(string_view key) override;
+    optional<string> getData(string_view key) override;
+    optional<RecordId> findRecord(string_view key) override;
+    string getByRid(RecordId rid) override;
+    void updateInPlace(RecordId rid, string_view data, size_t offset = 0) override;
+    /**
+     * @brief compact the records that are kept toward the beginning of the file and truncate it once
+     */
+    size_t deleteWhere(const function<bool(string_view)>& predicate) override;
+    size_t updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) override;
+    bool nextBatch(size_t& cursor, RecordBatch& batch) override;
+    /**
+     * @brief read only the minipages of the fields that overlap the columns and leave out the records
+     * that do not satisfy the filters on the integer fields
+     */
+    bool nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) override;
+    size_t size() const override;
+    /**
+     * @brief split the records in morsels of whole blocks
+     */
+    vector<Morsel> morsels() override;
+    bool readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) override;
+    bool readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) override;
+
+private:
+
+    /**
+     * @return position in the file of the value of a field of a record
+     */
+    size_t fieldPosition(size_t field, size_t record) const;
+
+    /**
+     * @return position in the file of the minipage of a field in a block
+     */
+    size_t minipagePosition(size_t field, size_t block) const;
+
+    /**
+     * @brief fill the batch with the records from first to end, at most RecordBatch::CAPACITY and in the same block,
+     * that satisfy the filters
+     *
+     * @param columns the bytes needed, all the fields if it is empty
+     */
+    void readRecords(size_t first, size_t end, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters = {});
+
+    /**
+     * @brief read the raw values of a field from the slot first of a block, decoding them if the minipage is encoded
+     *
+     * @param length length of the encoded minipage, 0 if it is not encoded
+     */
+    void readField(size_t field, size_t block, size_t first, size_t count, uint32_t length, string& values);
+
+    /**
+     * @brief append to output the indexes, from 0, of the values of a field from the slot first of a block
+     * that satisfy a filter
+     */
+    void selectField(size_t field, size_t block, size_t first, size_t count, uint32_t length, const IntegerFilter& filter, SelectionVector& output);
+
+    /**
+     * @brief call visit(frame, first value, number of values, values already visited) for every frame
+     * of an encoded minipage that has some of the values from the slot first of a block
+     */
+    void forEachFrame(size_t field, size_t block, size_t first, size_t count, const function<void(string_view, size_t, size_t, size_t)>& visit);
+
+    /**
+     * @return the lengths of the encoded minipages of a block
+     */
+    vector<uint32_t> readBlockHeader(size_t block);
+
+    void writeBlockHeader(size_t block, const vector<uint32_t>& lengths);
+
+    /**
+     * @brief encode the integer minipages of the full blocks that have some records from first to end
+     */
+    void sealBlocks(size_t first, size_t end);
+
+    /**
+     * @brief decode the minipages of the blocks that have some positions from first to end
+     */
+    void unsealBlocks(size_t first, size_t end);
+
+    /**
+     * @brief write records in the positions starting from first, every field of a block with a single write
+     */
+    void writeRecords(size_t first, string_view data);
+
+    /**
+     * @return the position of the record with a key, nullopt if it does not exist
+     */
+    optional<size_t> searchRecord(string_view key);
+
+    void loadHeader();
+
+    void saveHeader();
+
+    /**
+     * @return the size of the file up to the end of the last block used
+     */
+    size_t fileEnd() const;
+
+    /**
+     * @brief truncate file on the filesystem after the last block used
+     */
+    void truncateFile();
+
+};
+
+#endif // PAXFILE_HPP
\ No newline at end of file
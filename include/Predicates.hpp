@@ -0,0 +1,42 @@
+#ifndef PREDICATES_HPP
+#define PREDICATES_HPP
+
+#include "RecordBatch.hpp"
+
+/*
+    Kernel per filtrare un intero RecordBatch.
+
+    Ogni kernel esamina i record elencati in input, o tutti i record del batch se input è nullptr,
+    e scrive in output, in ordine crescente, gli indici dei record che soddisfano il predicato.
+    Il campo si trova a offset byte dall'inizio di ogni record (vedi Relation::startPointOf).
+    input e output devono essere due vettori diversi.
+
+    Sui processori x86 i kernel usano AVX2 quando è disponibile, altrimenti SSE2;
+    sugli altri processori usano un ciclo scalare. Gli interi di un batch con record di un solo
+    intero sono contigui e si caricano con un'unica lettura vettoriale; i campi
+    di meno di 16 byte si confrontano con due letture di parole che si sovrappongono.
+*/
+
+/**
+ * @brief select the records with an integer field equal to value
+ */
+void selectIntEqual(const RecordBatch& batch, size_t offset, int value, const SelectionVector* input, SelectionVector& output);
+
+/**
+ * @brief select the records with an integer field between low and high (both included)
+ */
+void selectIntRange(const RecordBatch& batch, size_t offset, int low, int high, const SelectionVector* input, SelectionVector& output);
+
+/**
+ * @brief select the records with a fixed-width field equal to value, the field has the length of value
+ */
+void selectBytesEqual(const RecordBatch& batch, size_t offset, string_view value, const SelectionVector* input, SelectionVector& output);
+
+/**
+ * @brief select the records with a fixed-width field between low and high (both included) in the order of memcmp
+ *
+ * @note low and high must have the length of the field
+ */
+void selectBytesRange(const RecordBatch& batch, size_t offset, string_view low, string_view high, const SelectionVector* input, SelectionVector& output);
+
+#endif // PREDICATES_HPP
\ No newline at end of file
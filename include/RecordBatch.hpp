@@ -0,0 +1,71 @@
+#ifndef RECORDBATCH_HPP
+#define RECORDBATCH_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+using namespace std;
+
+/**
+ * @brief indexes of the records of a RecordBatch that satisfy a predicate, in increasing order
+ */
+using SelectionVector = vector<uint32_t>;
+
+/**
+ * @brief the bytes of the records needed by a scan, as (offset, size) pairs in the record
+ */
+using ColumnRanges = vector<pair<size_t, size_t>>;
+
+/**
+ * @brief the condition low <= value <= high on the field at offset in the records, with the value
+ * read as in orderKey (see ColumnEncoding.hpp). On a field of kind IntegerKind::Prefix the filter
+ * can only tell the records that surely do not satisfy it
+ */
+struct IntegerFilter {
+    size_t offset;
+    int64_t low;
+    int64_t high;
+};
+
+/**
+ * @struct RecordBatch
+ * @brief A block of up to CAPACITY fixed-width records stored one after the other in a contiguous buffer.
+ *
+ * The records can be copied in the buffer owned by the batch or, when the file allows it,
+ * data can point directly to the memory of the file.
+ *
+ * @note the content of a batch is valid until the next call that fills it or until the file is modified
+ */
+struct RecordBatch {
+    static constexpr size_t CAPACITY = 1024;
+
+    size_t recordSize = 0;
+    size_t count = 0;
+    const char* data = nullptr;
+    string buffer;
+
+    /**
+     * @brief make the batch use its own buffer for count records of recordSize bytes
+     *
+     * @return the buffer where the records have to be written
+     */
+    char* prepare(size_t recordSize, size_t count) {
+        this->recordSize = recordSize;
+        this->count = count;
+        if(buffer.size() < recordSize * count)
+            buffer.resize(recordSize * CAPACITY > recordSize * count ? recordSize * CAPACITY : recordSize * count);
+        data = buffer.data();
+        return buffer.data();
+    }
+
+    string_view operator[](size_t i) const {
+        return string_view(data + i * recordSize, recordSize);
+    }
+
+    bool empty() const { return count == 0; }
+};
+
+#endif // RECORDBATCH_HPP
\ No newline at end of file
@@ -0,0 +1,165 @@
+#ifndef RECORDCACHE_HPP
+#define RECORDCACHE_HPP
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "StorageEngine.hpp"
+
+class RecordHandle;
+
+/**
+ * @class RecordCache
+ * @brief Cache of the records read by key from the tables, bounded by a memory budget.
+ *
+ * The records are grouped by the table that owns them and found by their key. The cache is split in
+ * SHARDS shards, each with its own latch and an equal part of the budget, so lookups of different keys
+ * rarely wait for each other. When a shard is full the victim is chosen with the clock algorithm, like
+ * in BufferPool, skipping the records pinned by a RecordHandle.
+ *
+ * The owner of the records must invalidate them when it changes or deletes them. A pinned record that is
+ * invalidated leaves the cache at once, but it stays in memory until its last handle is released.
+ */
+class RecordCache {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 16 * 1024 * 1024;
+    static constexpr size_t SHARDS = 16;
+
+    /**
+     * @param memoryBudget maximum number of bytes used by the records that are not pinned
+     */
+    RecordCache(size_t memoryBudget = DEFAULT_BUDGET);
+
+    RecordCache(const RecordCache&) = delete;
+    RecordCache& operator=(const RecordCache&) = delete;
+
+    /**
+     * @return the cache used by the tables that are not given one explicitly
+     */
+    static RecordCache& shared();
+
+    /**
+     * @return the record with a key of a table, pinned, or nullopt if it is not in the cache
+     */
+    optional<RecordHandle> get(const void* owner, string_view key);
+
+    /**
+     * @brief add the record with a key of a table, replacing the one already in the cache
+     *
+     * @return the record, pinned: it is returned even if it is bigger than the budget
+     */
+    RecordHandle put(const void* owner, string_view key, Record record);
+
+    /**
+     * @brief remove the record with a key of a table, if it is in the cache
+     */
+    void invalidate(const void* owner, string_view key);
+
+    /**
+     * @brief remove every record of a table
+     */
+    void discard(const void* owner);
+
+    /**
+     * @return number of bytes used by the records, pinned or not
+     */
+    size_t usedBytes();
+
+private:
+    friend class RecordHandle;
+
+    struct Entry {
+        const void* owner;
+        string key;
+        Record record;
+        size_t bytes;
+        size_t pinCount;
+        bool referenced;
+        // falso se il record è stato invalidato mentre era in uso
+        bool cached;
+    };
+
+    struct EntryId {
+        const void* owner;
+        string_view key;
+
+        bool operator==(const EntryId& other) const {
+            return owner == other.owner && key == other.key;
+        }
+    };
+
+    struct EntryIdHash {
+        size_t operator()(const EntryId& id) const {
+            return hash<string_view>()(id.key) ^ (hash<const void*>()(id.owner) * 0x9E3779B97F4A7C15ULL);
+        }
+    };
+
+    struct Shard {
+        mutex latch;
+        // l'anello del clock, gli elementi di una list non si spostano
+        list<Entry> entries;
+        list<Entry>::iterator clockHand;
+        unordered_map<EntryId, list<Entry>::iterator, EntryIdHash> index;
+        size_t bytes = 0;
+    };
+
+    size_t shardBudget;
+    Shard shards[SHARDS];
+
+    Shard& shardOf(const void* owner, string_view key);
+
+    /**
+     * @brief remove records with the clock algorithm until a record of some bytes fits in the shard
+     */
+    void evict(Shard& shard, size_t needed);
+
+    /**
+     * @brief drop a record from the index of its shard, and from memory if it is not pinned
+     */
+    void drop(Shard& shard, list<Entry>::iterator entry);
+
+    void erase(Shard& shard, list<Entry>::iterator entry);
+
+    void unpin(Shard& shard, list<Entry>::iterator entry);
+};
+
+/**
+ * @class RecordHandle
+ * @brief A record returned by a Table, that stays valid for the lifetime of the object.
+ *
+ * A handle of a RecordCache keeps its record pinned; a handle made from a record owned by someone else,
+ * like the records of a VirtualTable, only refers to it.
+ */
+class RecordHandle {
+    RecordCache* cache;
+    RecordCache::Shard* shard;
+    list<RecordCache::Entry>::iterator entry;
+    const Record* record;
+
+    friend class RecordCache;
+
+    RecordHandle(RecordCache& cache, RecordCache::Shard& shard, list<RecordCache::Entry>::iterator entry);
+
+public:
+    explicit RecordHandle(const Record& record);
+
+    ~RecordHandle();
+
+    RecordHandle(RecordHandle&& other) noexcept;
+    RecordHandle& operator=(RecordHandle&& other) noexcept;
+
+    RecordHandle(const RecordHandle&) = delete;
+    RecordHandle& operator=(const RecordHandle&) = delete;
+
+    const Record& get() const { return *record; }
+
+    const Record& operator*() const { return *record; }
+
+    const Record* operator->() const { return record; }
+
+private:
+    void release();
+};
+
+#endif // RECORDCACHE_HPP
\ No newline at end of file
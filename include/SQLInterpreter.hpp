@@ -4,23 +4,213 @@
 #include <optional>
 
 #include "StorageEngine.hpp"
+#include "Operators.hpp"
+#include "SQLParserResult.h"
 #include "sql/SQLStatement.h"
 #include "sql/statements.h"
 
 using DatabaseRef = reference_wrapper<Database>;
 
 class SQLInterpreter {
+    /**
+     * @struct Statement
+     * @brief The statements parsed from a text, kept to run them again without parsing it.
+     */
+    struct Statement {
+        unique_ptr<hsql::SQLParserResult> parsed;
+        // la posizione di ogni segnaposto ?, e il testo del suo valore, condiviso con le condizioni del piano
+        unordered_map<const hsql::Expr*, size_t> placeholders;
+        vector<shared_ptr<string>> values;
+        // il piano di una SELECT da sola, valido finché non si aggiungono o tolgono tabelle
+        OperatorPtr plan;
+        size_t schemaVersion = 0;
+    };
+
     optional<DatabaseRef> db;
+    // i testi già analizzati, con gli spazi normalizzati
+    unordered_map<string, shared_ptr<Statement>> statements;
+    unordered_map<string, shared_ptr<Statement>> prepared;
+    // lo statement in esecuzione, che dà i valori dei segnaposto
+    Statement* running;
+    // falso se il piano appena costruito non si può eseguire una seconda volta
+    bool reusablePlan;
 public:
+    /**
+     * @brief tables with at least this number of records are scanned in parallel on ThreadPool::shared
+     */
+    static constexpr size_t PARALLEL_SCAN_ROWS = 64 * 1024;
+
+    /**
+     * @brief COPY loads the records of a file in batches of about this number of bytes
+     */
+    static constexpr size_t BULK_LOAD_BYTES = 64 * 1024 * 1024;
+
+    /**
+     * @brief the cache of parsed texts is emptied when it has this number of them, the prepared statements stay
+     */
+    static constexpr size_t MAX_CACHED_STATEMENTS = 256;
+
     SQLInterpreter();
     SQLInterpreter(Database& db);
 
+    /**
+     * @brief run the statements of a text
+     *
+     * The parsed statements are kept in a cache keyed by the text with its spaces normalized, so a text run
+     * again is not parsed again. A text with a single SELECT also keeps its plan, built again only after
+     * a table is added or deleted (see Database::getSchemaVersion) or if it reads a table in parallel.
+     * PREPARE name FROM 'text' keeps the statement of a text with ? placeholders under a name, and
+     * EXECUTE name(values) runs it with a constant for every placeholder.
+     */
     void execute(const string& sql);
 
+    /**
+     * @brief run a prepared statement, like EXECUTE but without parsing anything
+     *
+     * @param values the text of the value of every placeholder, in the order in which they are in the statement
+     * @throw invalid_argument if the statement has not been prepared or the number of values is not right
+     */
+    void executePrepared(const string& name, const vector<string>& values);
+
 private:
     void setDatabase(Database& db);
+
+    /**
+     * @return the statements of a normalized text, from the cache or parsed, nullptr if the text is not valid
+     */
+    shared_ptr<Statement> parse(const string& text);
+
+    /**
+     * @brief run all the statements of a text with the current values of its placeholders
+     */
+    void run(Statement& statement);
+
     void executeStatement(hsql::SQLStatement *statement);
     void executeSelect(hsql::SelectStatement *select);
+
+    /**
+     * @brief keep the statement of a text under a name, see execute
+     */
+    void executePrepare(hsql::PrepareStatement *statement);
+
+    void executeExecute(hsql::ExecuteStatement *statement);
+
+    /**
+     * @brief load the records of a CSV, '|' separated (.tbl) or binary file in a table with PhysicalTable::bulkLoad
+     *
+     * The binary file contains raw records one after the other. Every batch is checked as a whole
+     * before being written, so a batch with an error is not loaded but the batches before it stay in the table.
+     */
+    void executeImport(hsql::ImportStatement *import);
+
+    /**
+     * @brief delete the rows of a table that satisfy the WHERE clause with a single pass on its file
+     */
+    void executeDelete(hsql::DeleteStatement *statement);
+
+    /**
+     * @brief set some columns of the rows of a table that satisfy the WHERE clause with a single pass on its file
+     */
+    void executeUpdate(hsql::UpdateStatement *statement);
+
+    /**
+     * @return a predicate on the raw records of a table for the WHERE clause of a DELETE or an UPDATE, true for every record without WHERE
+     */
+    function<bool(string_view)> wherePredicate(hsql::Expr *where, PhysicalTable& table, const string& name);
+
+    /**
+     * @brief build a raw record from the text of the values of its fields, in the order of the relation
+     */
+    string parseRecord(Relation& relation, const vector<string>& values);
+
+    /**
+     * @brief lower a SELECT statement into a pipeline of operators
+     * 
+     * @throw invalid_argument if the statement refers to tables or columns that do not exist
+     * @throw runtime_error if the statement uses features that are not supported
+     */
+    OperatorPtr planSelect(hsql::SelectStatement *select);
+
+    /**
+     * @brief build the aggregation of a SELECT with GROUP BY or aggregate functions
+     * 
+     * If the source is a parallel scan every worker aggregates its rows and a final step merges the partial results.
+     * 
+     * @param indexes filled with the indexes of the columns of the aggregation that make the SELECT list
+     */
+    OperatorPtr planAggregate(hsql::SelectStatement *select, OperatorPtr source, vector<size_t>& indexes);
+
+    /**
+     * @brief translate a call of COUNT, SUM, MIN, MAX or AVG on a column of the input
+     */
+    Aggregate aggregateOf(hsql::Expr *expr, const vector<Column>& columns);
+
+    /**
+     * @return the name of the column of an aggregate function without alias, like SUM(price)
+     */
+    string aggregateName(hsql::Expr *expr);
+
+    /**
+     * @return the columns of the rows read from a table or a join of tables
+     */
+    vector<Column> sourceColumns(hsql::TableRef *table);
+
+    /**
+     * @brief build the operator that reads a table or a join of tables
+     * 
+     * @param conditions the conditions of the WHERE clause, each one is applied to the table of its column
+     * @param references the references to columns in the query, nullopt if it uses all the columns
+     */
+    OperatorPtr planSource(hsql::TableRef *table, const vector<Condition>& conditions, const optional<vector<hsql::Expr*>>& references);
+
+    /**
+     * @brief build the operator that reads a table applying some conditions on its columns
+     * 
+     * If the conditions fix every field of the key the table is accessed by key,
+     * otherwise it is scanned evaluating the conditions batch by batch, in parallel if it is big.
+     */
+    OperatorPtr planTable(hsql::TableRef *table, const vector<Condition>& conditions, const optional<vector<hsql::Expr*>>& references);
+
+    /**
+     * @brief build a hash join of two tables on the equalities of its ON clause
+     */
+    OperatorPtr planJoin(hsql::TableRef *table, const vector<Condition>& conditions, const optional<vector<hsql::Expr*>>& references);
+
+    /**
+     * @return the byte ranges of the columns of a table used by the query, empty if it uses all of them
+     */
+    ColumnRanges neededColumns(const vector<Column>& columns, const string& alias, const optional<vector<hsql::Expr*>>& references);
+
+    /**
+     * @brief translate a conjunction of equalities between a column of the left input and a column of the right input
+     */
+    void collectJoinKeys(hsql::Expr *expr, const vector<Column>& left, const vector<Column>& right, vector<size_t>& leftKeys, vector<size_t>& rightKeys);
+
+    /**
+     * @brief translate a conjunction of comparisons between columns and constants
+     */
+    void collectConditions(hsql::Expr *expr, const vector<Column>& columns, vector<Condition>& conditions);
+
+    /**
+     * @return the raw value of a literal in the domain of a field
+     */
+    string literalValue(hsql::Expr *expr, const Field& field);
+
+    /**
+     * @return the text of a literal or of the value of a placeholder, nullopt if the expression is not a constant
+     */
+    optional<string> literalText(hsql::Expr *expr);
+
+    /**
+     * @return the table with a name in the database
+     * @throw invalid_argument if it does not exist
+     */
+    PhysicalTable& tableNamed(const char *name);
+
+    /**
+     * @brief run a pipeline and print all its rows
+     */
+    void printRows(Operator& plan);
 };
 
 #endif // SQLINTERPRETER_HPP
\ No newline at end of file
@@ -0,0 +1,176 @@
+#ifndef SLOTTEDFILE_HPP
+#define SLOTTEDFILE_HPP
+
+#include "File.hpp"
+#include "ExtendibleHashFile.hpp"
+
+/**
+ * @class SlottedFile
+ * @brief Store records with variable-length fields in slotted pages.
+ *
+ * The records are given and returned with the usual fixed-width layout, but on the disk the variable
+ * fields are stored without their padding of '\0'. A stored record starts with an array of the end offsets
+ * of its variable values, followed by the fixed fields and by the variable values one after the other.
+ *
+ * The page 0 is the header of the file. A data page has a directory of slots (offset and length) that grows
+ * from the beginning of the page and the stored records that grow from the end: the records can move inside
+ * the page without changing their RecordId (page << 16 | slot). A stored record longer than MAX_INLINE
+ * bytes is kept in a chain of overflow pages and its slot points to the first of them.
+ *
+ * Like HeapFile with the hash index, a sidecar ExtendibleHashFile (".hidx") maps every key to its RecordId.
+ * New records go in the last data page or in the pages that deletions left with much free space.
+ */
+class SlottedFile: public File {
+public:
+    /**
+     * @brief a field of the records: its size in the fixed-width layout and if its padding can be dropped
+     */
+    struct FieldLayout {
+        size_t size;
+        bool variable;
+    };
+
+    /**
+     * @brief the longest stored record kept in a data page
+     */
+    static constexpr size_t MAX_INLINE = BufferPool::PAGE_SIZE / 4;
+
+private:
+
+size_t keySize;
+size_t recordSize;
+vector<FieldLayout> fields;
+vector<size_t> fieldOffsets;
+size_t variableCount;
+uint32_t pageCount;
+uint32_t lastPage;
+uint32_t freeList;
+uint64_t recordCount;
+// pagine dati con molto spazio libero dopo delle cancellazioni, non salvate nel file
+vector<uint32_t> roomyPages;
+unique_ptr<ExtendibleHashFile> index;
+
+public:
+    SlottedFile(string fileName, size_t keySize, vector<FieldLayout> fields, BufferPool& pool = BufferPool::shared());
+
+    ~SlottedFile() override;
+
+    iterator<input_iterator_tag,string> begin() override;
+    iterator<input_iterator_tag,string> end() override;
+    /**
+     * @throw invalid_argument if the key of one of the records is already in the file
+     */
+    void pushData(string_view data) override;
+    optional<string> deleteData(string_view key) override;
+    optional<string> getData(string_view key) override;
+    optional<RecordId> findRecord(string_view key) override;
+    string getByRid(RecordId rid) override;
+    /**
+     * @brief change a record keeping its RecordId, if it does not fit in its page anymore it is moved to overflow pages
+     */
+    void updateInPlace(RecordId rid, string_view data, size_t offset = 0) override;
+    /**
+     * @brief delete the records of every page and compact the page once
+     */
+    size_t deleteWhere(const function<bool(string_view)>& predicate) override;
+    size_t updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) override;
+    bool nextBatch(size_t& cursor, RecordBatch& batch) override;
+    size_t size() const override;
+    bool indexedLookup() const override;
+    /**
+     * @brief split the pages of the file in morsels of MORSEL_SIZE bytes
+     */
+    vector<Morsel> morsels() override;
+    bool readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) override;
+
+private:
+
+    friend class SlotIterator;
+
+    /**
+     * @return the stored form of a record: offsets of the variable values, fixed fields, variable values
+     */
+    string encode(string_view record) const;
+
+    /**
+     * @brief write in out the fixed-width record of a stored record
+     */
+    void decode(string_view stored, char* out) const;
+
+    /**
+     * @brief write in out the record in a slot of a data page
+     *
+     * @return false if the slot is empty
+     */
+    bool readSlot(const char* page, size_t slot, char* out);
+
+    /**
+     * @brief read the records of the pages from first to end, starting from the position cursor (page << 16 | slot)
+     */
+    bool readRecords(size_t first, size_t end, size_t& cursor, RecordBatch& batch);
+
+    /**
+     * @return the position of the first record at or after a position, pageCount << 16 if there are no more records
+     */
+    uint64_t nextRecord(uint64_t position);
+
+    /**
+     * @brief store a record in a data page with enough free space
+     */
+    RecordId insertRecord(string_view record);
+
+    /**
+     * @brief put the bytes of a slot in a page, in the slot given or in a new one
+     *
+     * @return the slot, nullopt if the page has not enough free space
+     */
+    optional<size_t> place(string& page, string_view bytes, bool overflow, optional<size_t> slot = nullopt);
+
+    /**
+     * @brief replace the record of a slot with a new version, that can be longer
+     */
+    void rewriteRecord(RecordId rid, string_view record);
+
+    /**
+     * @brief move the stored records to the end of the page, leaving all the free space in the middle
+     */
+    void compactPage(string& page);
+
+    /**
+     * @return the bytes of a page that are free or used by deleted records
+     */
+    size_t freeSpace(const string& page) const;
+
+    /**
+     * @return the first page of a chain of overflow pages with the bytes
+     */
+    uint32_t writeOverflow(string_view bytes);
+
+    string readOverflow(uint32_t first, size_t length);
+
+    void freeOverflow(uint32_t first);
+
+    uint32_t allocatePage();
+
+    void freePage(uint32_t pageNo);
+
+    string loadPage(uint32_t pageNo);
+
+    void savePage(uint32_t pageNo, const string& page);
+
+    /**
+     * @brief remember a data page that has a lot of free space for the next insertions
+     */
+    void noteFreeSpace(uint32_t pageNo, const string& page);
+
+    string indexEntry(string_view key, RecordId rid) const;
+
+    void openIndex();
+
+    void loadHeader();
+
+    void saveHeader();
+
+};
+
+#endif // SLOTTEDFILE_HPP
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef SPILLFILE_HPP
+#define SPILLFILE_HPP
+
+#include "HeapFile.hpp"
+
+/**
+ * @class SpillFile
+ * @brief A temporary HeapFile of fixed-width rows used by the operators that do not fit in memory,
+ * it is deleted from the disk when it is destroyed.
+ *
+ * The rows are appended in a buffer and written in blocks of WRITE_SIZE bytes, so the file
+ * is written sequentially with few large writes.
+ */
+class SpillFile {
+    string path;
+    unique_ptr<HeapFile> file;
+    string pending;
+    size_t rows;
+public:
+    static constexpr size_t WRITE_SIZE = 64 * 1024;
+
+    /**
+     * @param prefix beginning of the name of the file in the temporary directory of the system
+     */
+    SpillFile(size_t rowSize, const string& prefix = "minidbms");
+
+    ~SpillFile();
+
+    void append(string_view row);
+
+    /**
+     * @brief write on the file the rows still in the buffer
+     */
+    void flush();
+
+    /**
+     * @return number of rows appended
+     */
+    size_t size() const;
+
+    /**
+     * @brief read the next block of rows, the rows still in the buffer must be flushed before
+     */
+    bool nextBatch(size_t& cursor, RecordBatch& batch);
+};
+
+/**
+ * @brief choose the partition of a key when the rows are split in more SpillFile
+ *
+ * @param level at every level the hash is mixed with a different seed, so the keys of a partition
+ * are split again when it is partitioned at the next level
+ * @return a number less than partitions
+ */
+size_t partitionOf(string_view key, size_t level, size_t partitions);
+
+#endif // SPILLFILE_HPP
\ No newline at end of file
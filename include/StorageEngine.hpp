@@ -14,6 +14,11 @@
 #include "Domains.hpp"
 #include "File.hpp"
 #include "HeapFile.hpp"
+#include "BPlusTreeFile.hpp"
+#include "MappedHeapFile.hpp"
+#include "PaxFile.hpp"
+#include "SlottedFile.hpp"
+#include "WriteAheadLog.hpp"
 
 using namespace std;
 
@@ -44,11 +49,85 @@ public:
 
 using Value = tuple<const Field&,string_view>;
 
+/**
+ * @struct FieldHandle
+ * @brief Position of a Field in the records of a Relation: ordinal, offset and size in bytes.
+ */
+struct FieldHandle {
+    size_t ordinal;
+    size_t offset;
+    size_t size;
+};
+
+/**
+ * @class CompiledSchema
+ * @brief Layout of the records of a Relation computed once, when the Relation is created.
+ *
+ * It contains the offset of every field, indexed by ordinal and by name, and a validator
+ * specialized on the type of every domain, so that the records can be validated
+ * without copying the fields and without virtual calls.
+ */
+class CompiledSchema {
+public:
+    enum class Validator : uint8_t {
+        // ogni sequenza di byte della dimensione giusta è valida (IntegerDomain, StringDomain, i numeri e le date)
+        None,
+        // il valore deve essere un codice dell'EnumDomain
+        Enum,
+        // dominio sconosciuto: si usa Domain::isValid
+        Generic
+    };
+
+private:
+    vector<FieldHandle> handles;
+    unordered_map<string, size_t> ordinals;
+    vector<Validator> validators;
+    vector<SharedDomain> domains;
+    // l'EnumDomain dei campi con il validatore Enum, nullptr per gli altri
+    vector<const EnumDomain*> enums;
+    vector<size_t> checkedFields;
+    size_t recordSize;
+
+public:
+    CompiledSchema();
+
+    /**
+     * @param keyFields the fields of the key, stored first in the records
+     * @param fields the other fields
+     */
+    CompiledSchema(const vector<Field>& keyFields, const vector<Field>& fields);
+
+    /**
+     * @return the handle of the field with a name, nullopt if it does not exist
+     */
+    optional<FieldHandle> handleOf(const string& name) const;
+
+    /**
+     * @return the handle of the field in position ordinal of the records
+     */
+    const FieldHandle& handleAt(size_t ordinal) const;
+
+    size_t fieldCount() const;
+
+    bool isValid(string_view data) const;
+
+    /**
+     * @brief validate every record of a batch
+     *
+     * @return the index of the first record that is not valid, batch.count if they are all valid
+     */
+    size_t validate(const RecordBatch& batch) const;
+
+private:
+    bool isValidField(size_t ordinal, string_view value) const;
+};
+
 class Relation {
     vector<Field> fields;
     vector<Field> keyFields;
     size_t recordTotalSize;
     size_t keySize;
+    CompiledSchema schema;
 public:
     Relation(vector<Field> fields);
 
@@ -58,7 +137,12 @@ public:
      */
     size_t startPointOf(const Field& field) const;
 
-    bool isValid(const string& data) const;
+    /**
+     * @return the layout of the records precomputed by the Relation
+     */
+    const CompiledSchema& compiled() const;
+
+    bool isValid(string_view data) const;
 
     const vector<Field>& getKey() const;
 
@@ -68,9 +152,10 @@ public:
 
     size_t getKeySize() const;
 
-    /* vector<Field>::iterator getFields() const {
-        //TODO: implementare
-    } */
+    /**
+     * @return all the fields in the order in which they are stored in the records: first the key
+     */
+    vector<Field> getFields() const;
 
 };
 
@@ -85,15 +170,20 @@ public:
 class Record {
     shared_ptr<Relation> rel;
     string data;
+
+    friend class RecordView;
 public:
 
     Record(shared_ptr<Relation> rel, string data);
 
-    const string& getData();
+    const string& getData() const;
 
     // Ritorna una vista sulla parte di record di cui fa parte il campo
     const string_view valueAt(const Field& field) const;
 
+    // Come valueAt(field), ma in O(1) usando la posizione precalcolata del campo
+    const string_view valueAt(const FieldHandle& handle) const;
+
     bool valuesInside(const vector<Value>& values) const;
 
     bool isValid() const;
@@ -106,26 +196,101 @@ public:
 
 };
 
-using ConstRecordRef = reference_wrapper<const Record>;
+/**
+ * @class RecordView
+ * @brief The bytes of a record of a relation, that it does not own.
+ *
+ * A view copies neither the bytes nor the shared_ptr of the relation, so it costs nothing to pass it
+ * around by value: it is valid while the record or the row it comes from and the relation are.
+ */
+class RecordView {
+    const Relation* rel;
+    string_view data;
+public:
+
+    RecordView(const Relation& rel, string_view data);
+
+    RecordView(const Record& record);
+
+    const Relation& getRelation() const;
+
+    string_view getData() const;
+
+    // Ritorna una vista sulla parte di record di cui fa parte il campo
+    string_view valueAt(const Field& field) const;
+
+    string_view valueAt(const FieldHandle& handle) const;
+
+    bool valuesInside(const vector<Value>& values) const;
+
+    bool isValid() const;
+
+    vector<Value> getKey() const;
+
+    string_view getKeyData() const;
+
+};
 
 #include "Tables.hpp"
 
+/**
+ * @brief the file organizations that a PhysicalTable can use to store its records
+ */
+enum class FileType {
+    Heap,
+    HashedHeap,
+    MappedHeap,
+    BPlusTree,
+    // i record sono divisi per colonna, conviene alle scansioni che leggono pochi campi
+    Pax,
+    // le stringhe occupano solo la loro lunghezza, conviene alle tabelle con testi lunghi
+    Slotted
+};
+
 class Database {
     string name;
     string dirPath;
     vector<SharedDomain> domains;
+    // dichiarato prima delle tabelle, che lo usano fino alla loro distruzione
+    unique_ptr<WriteAheadLog> log;
+    BufferPool pool;
+    RecordCache records;
     vector<PhysicalTable> tables;
+    // cresce a ogni tabella aggiunta o tolta
+    size_t schemaVersion;
 public:
-    Database(string name,string dirPath);
+    /**
+     * @brief open the database in a directory, applying the changes left in its log by a crash
+     *
+     * @param recordCacheSize bytes of the records read by key that the tables keep in memory
+     */
+    Database(string name,string dirPath, size_t bufferPoolSize = BufferPool::DEFAULT_BUDGET, size_t recordCacheSize = RecordCache::DEFAULT_BUDGET);
+
+    /**
+     * @brief close the tables and checkpoint the log
+     */
+    ~Database();
 
     void addDomain(SharedDomain domain);
 
-    void addTable(string name, shared_ptr<Relation> relation);
+    /**
+     * @brief create a table, or open it if its file already exists in the directory of the database
+     *
+     * @param type the file organization used to store the records
+     * @throw invalid_argument if a table with the same name already exists
+     */
+    void addTable(string name, shared_ptr<Relation> relation, FileType type = FileType::Heap);
 
     optional<PhysicalTableRef> getTable(string_view name);
 
     // ritorna True se esisteva una tabella con quel nome, False se la tabella non esisteva
     bool deleteTable(string_view name);
+
+    /**
+     * @return a number that changes every time a table is added or deleted: the references to the
+     * tables and the plans built on their relations are valid while it does not change
+     */
+    size_t getSchemaVersion() const;
 };
 
 #endif // STORAGEENGINE_HPP
\ No newline at end of file
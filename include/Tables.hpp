@@ -2,6 +2,8 @@
 #define TABLES_HPP
 
 #include "StorageEngine.hpp"
+#include "KeyFilter.hpp"
+#include "RecordCache.hpp"
 
 /**
  * @class Table
@@ -19,34 +21,35 @@ public:
 
     Table(shared_ptr<Relation> rel);
 
+    virtual ~Table() = default;
+
     /**
      * @brief Adds a record to the table.
      *
-     * @param record The record to be added.
+     * @param record The record to be added, the table copies its bytes if it needs them.
+     * @throw invalid_argument if the record is not valid or its key is already in the table
      */
-    virtual void addRecord(Record record);
+    virtual void addRecord(RecordView record) = 0;
 
     /**
      * @brief Adds a record to the table.
      *
      * @param data The raw data to be added.
      */
-    virtual void addRecord(string data);
+    virtual void addRecord(string data) = 0;
 
     //TODO: virtual VirtualTable search(QueryPlan plan) const;
 
-    //TODO: virtual JoinedTable join(Table& rightTable);
-
     /**
      * @brief get a Reference to a Record
      * 
      * @note this function is not constant to allow flexibility to the various implementations of the Table class
      * 
      * @param key raw data that rappresent a key
-     * @return nullptr if the record don't exist or a constant reference to the Record
+     * @return nullptr if the record don't exist or a handle to the Record, valid until it is destroyed
      * @throw invalid_argument if the key is not valid
      */
-    virtual optional<ConstRecordRef> getRecord(string_view key);
+    virtual optional<RecordHandle> getRecord(string_view key) = 0;
 
     /**
      * @brief delete a Record
@@ -55,7 +58,7 @@ public:
      * @return nullptr if the record don't exist or the Record
      * @throw invalid_argument if the key is not valid
      */
-    virtual optional<Record> deleteRecord(string_view key);
+    virtual optional<Record> deleteRecord(string_view key) = 0;
 
     /**
      * @brief update the values of a Record.
@@ -65,7 +68,45 @@ public:
      * 
      * @return false if the key of the newRecord don't exist, true otherwise.
      */
-    virtual bool updateRecordByKey(string_view key, const vector<Value>& newValues);
+    virtual bool updateRecordByKey(string_view key, const vector<Value>& newValues) = 0;
+
+    /**
+     * @brief read the next block of raw records of a scan of the table
+     *
+     * @param cursor position of the scan, 0 to start from the beginning
+     * @param batch filled with up to RecordBatch::CAPACITY records
+     * @return false if there are no more records
+     */
+    virtual bool nextBatch(size_t& cursor, RecordBatch& batch) = 0;
+
+    /**
+     * @return number of records in the table
+     */
+    virtual size_t size() const = 0;
+
+    /**
+     * @brief split the records of the table in morsels that can be read in parallel with readMorsel
+     */
+    virtual vector<Morsel> morsels() = 0;
+
+    /**
+     * @brief read the next block of raw records of a morsel, see File::readMorsel
+     *
+     * @param cursor position in the morsel, 0 to start from the beginning of the morsel
+     * @return false if there are no more records in the morsel
+     */
+    virtual bool readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) = 0;
+
+    /**
+     * @brief like nextBatch, but only the bytes of the columns have to be read and the records
+     * that do not satisfy the filters can be left out, see File::nextColumns
+     */
+    virtual bool nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters);
+
+    /**
+     * @brief like readMorsel, but only the bytes of the columns have to be read
+     */
+    virtual bool readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters);
 
     /**
      * @brief getter for rel
@@ -90,39 +131,151 @@ class VirtualTable: public Table {
 
 public:
 
-    void addRecord(Record record) override;
+    void addRecord(RecordView record) override;
 
     void addRecord(string data) override;
 
-    optional<ConstRecordRef> getRecord(string_view key) override;
+    optional<RecordHandle> getRecord(string_view key) override;
 
     optional<Record> deleteRecord(string_view key) override;
 
     bool updateRecordByKey(string_view key, const vector<Value>& newValues) override;
 
+    bool nextBatch(size_t& cursor, RecordBatch& batch) override;
+
+    size_t size() const override;
+
+    vector<Morsel> morsels() override;
+
+    bool readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) override;
+
 };
 
 class PhysicalTable: public Table {
     string name;
-    // records salvati nella RAM e non sul disco rigito
-    vector<Record> volatileRecords;
     FilePtr file;
+    // filtro di Bloom sulle chiavi: se una chiave non c'è non si legge il file
+    unique_ptr<KeyFilter> keyFilter;
+    // i record letti con getRecord, il file li identifica nella cache
+    RecordCache* cache;
 public:
-    PhysicalTable(shared_ptr<Relation> rel, string name, FilePtr file);
+    /**
+     * @brief open the table, loading the filter on its keys or rebuilding it from the file
+     *
+     * @param cache where the records read by key are kept, shared with the other tables
+     */
+    PhysicalTable(shared_ptr<Relation> rel, string name, FilePtr file, RecordCache& cache = RecordCache::shared());
+
+    /**
+     * @brief remove the records of the table from the cache
+     */
+    ~PhysicalTable();
+
+    PhysicalTable(PhysicalTable&& other) = default;
+
+    PhysicalTable& operator=(PhysicalTable&& other);
 
-    void addRecord(Record record) override;
+    void addRecord(RecordView record) override;
 
     void addRecord(string data) override;
 
-    optional<ConstRecordRef> getRecord(string_view key) override;
+    /**
+     * @brief add many raw records with a single check of their keys and a single write
+     *
+     * The keys of the records are put in a hash set, that finds the duplicates among them and is probed
+     * with the keys of the table, read with a scan or looked up in its index. If a record is not valid
+     * nothing is added.
+     *
+     * @param data records one after the other
+     * @throw invalid_argument if a record is not valid or a key is repeated or already in the table
+     */
+    void bulkLoad(string_view data);
+
+    optional<RecordHandle> getRecord(string_view key) override;
+
+    /**
+     * @return the id of the record with a key, to read or update it without searching it again
+     * @throw invalid_argument if the key is not valid
+     */
+    optional<RecordId> findRecord(string_view key);
+
+    /**
+     * @return the record with an id returned by findRecord
+     * @throw out_of_range if the record does not exist anymore
+     */
+    Record getByRid(RecordId rid);
+
+    /**
+     * @brief overwrite some fields of a record where it is stored, without moving it
+     *
+     * @throw invalid_argument if a value is not valid for its field or it is a field of the key
+     */
+    void updateInPlace(RecordId rid, const vector<Value>& newValues);
 
     optional<Record> deleteRecord(string_view key) override;
 
+    /**
+     * @brief delete every record that satisfies a predicate with a single pass on the file
+     *
+     * @param predicate called on the raw records
+     * @return number of records deleted
+     */
+    size_t deleteWhere(const function<bool(string_view)>& predicate);
+
+    /**
+     * @brief set some fields of every record that satisfies a predicate with a single pass on the file
+     *
+     * @return number of records updated
+     * @throw invalid_argument if a value is not valid for its field or it is a field of the key
+     */
+    size_t updateWhere(const function<bool(string_view)>& predicate, const vector<Value>& newValues);
+
+    /**
+     * @brief update the values of a Record, in place if the key does not change
+     *
+     * @throw invalid_argument if a value is not valid or the new key is already in the table
+     */
     bool updateRecordByKey(string_view key, const vector<Value>& newValues) override;
 
+    bool nextBatch(size_t& cursor, RecordBatch& batch) override;
+
+    size_t size() const override;
+
+    vector<Morsel> morsels() override;
+
+    bool readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) override;
+
+    bool nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) override;
+
+    bool readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) override;
+
     const string& getName() const;
 
+    /**
+     * @return the file where the records are stored
+     */
+    File& getFile();
+
+    /**
+     * @brief remove the records of the table from the cache, the handles already returned stay valid
+     */
     void clear();
+
+private:
+    /**
+     * @throw invalid_argument if a value is not valid for its field or it is a field of the key
+     */
+    void checkValues(const vector<Value>& newValues) const;
+
+    /**
+     * @brief fill the filter with the keys of the file
+     */
+    void rebuildKeys();
+
+    /**
+     * @brief add a key to the filter, rebuilding it if it has become too full
+     */
+    void addKey(string_view key);
 };
 
 using PhysicalTableRef = reference_wrapper<PhysicalTable>;
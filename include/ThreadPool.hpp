@@ -0,0 +1,88 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads that run tasks with work stealing.
+ *
+ * Every worker has its own queue: it takes its tasks from the back of the queue (the most recent ones,
+ * still in its cache) and, when the queue is empty, steals from the front of the queues of the others.
+ * A task submitted by a worker goes in the queue of the worker, the others are spread round robin.
+ */
+class ThreadPool {
+    struct Queue {
+        mutex latch;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> threads;
+    atomic<size_t> queued;
+    atomic<size_t> nextQueue;
+    bool stopping;
+    mutex sleepLatch;
+    condition_variable wake;
+
+public:
+    /**
+     * @param threads number of workers, at least one
+     */
+    ThreadPool(size_t threads = thread::hardware_concurrency());
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief wait for the tasks already submitted and stop the workers
+     */
+    ~ThreadPool();
+
+    /**
+     * @return the pool used by the operators that are not given one explicitly
+     */
+    static ThreadPool& shared();
+
+    /**
+     * @return number of workers
+     */
+    size_t size() const;
+
+    /**
+     * @brief run a task on a worker, without waiting for it
+     */
+    void submit(function<void()> task);
+
+    /**
+     * @brief run task(i, worker) for every i less than count and wait for all of them
+     *
+     * If the caller is a worker of the pool it runs tasks while it waits.
+     * @throw the first exception thrown by a task
+     */
+    void parallelFor(size_t count, const function<void(size_t index, size_t worker)>& task);
+
+    /**
+     * @return the index of the worker running the caller, size() if the caller is not a worker of the pool
+     */
+    size_t currentWorker() const;
+
+private:
+    void work(size_t worker);
+
+    /**
+     * @brief take a task from the queue of a worker or, if it is empty, from the queue of another worker
+     */
+    bool take(size_t worker, function<void()>& task);
+};
+
+#endif // THREADPOOL_HPP
\ No newline at end of file
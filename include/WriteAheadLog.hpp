@@ -0,0 +1,119 @@
+#ifndef WRITEAHEADLOG_HPP
+#define WRITEAHEADLOG_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @class WriteAheadLog
+ * @brief Redo log of the changes made to the files of a database.
+ *
+ * Every change is appended as a record that describes it physically: the bytes written at an offset
+ * of a file (WRITE) or the new length of a file (SETEND). A record is identified by its LSN, the position
+ * in the log where it ends. The records are collected in memory and a background thread writes them and
+ * calls fdatasync: the commits that arrive while a sync is in progress are made durable together by the
+ * next one (group commit), so many writers pay for few syncs.
+ *
+ * The pages of the files are written lazily by the BufferPool, which before writing a page waits until
+ * the records that changed it are durable. After a crash recover applies the records again.
+ */
+class WriteAheadLog {
+    enum RecordType : uint8_t {
+        Write = 1,
+        SetEnd = 2
+    };
+
+    string path;
+    int fd;
+
+    mutex latch;
+    condition_variable flushRequested;
+    condition_variable flushed;
+    string buffer;
+    uint64_t appendedLsn;
+    uint64_t requestedLsn;
+    uint64_t durableLsn;
+    // byte del file del log già sincronizzati: dopo un errore il file si tronca qui
+    uint64_t durableBytes;
+    bool stopping;
+    // dopo il primo errore nessun record diventa più durevole
+    bool failed;
+    // file modificati dall'ultimo checkpoint
+    unordered_set<string> files;
+    thread flusher;
+
+public:
+    /**
+     * @brief open or create the log, the records already in the log are not applied until recover is called
+     */
+    WriteAheadLog(string path);
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /**
+     * @brief make every record durable and stop the background thread
+     */
+    ~WriteAheadLog();
+
+    /**
+     * @brief append a record for len bytes written at an offset of a file
+     *
+     * @return the LSN of the record
+     * @throw runtime_error if the log could not be written before
+     */
+    uint64_t logWrite(const string& file, size_t offset, string_view data);
+
+    /**
+     * @brief append a record for the change of the length of a file
+     *
+     * @return the LSN of the record
+     * @throw runtime_error if the log could not be written before
+     */
+    uint64_t logSetEnd(const string& file, size_t end);
+
+    /**
+     * @brief wait until the record with an LSN, and all the records before it, are durable
+     *
+     * When a write or a sync of the log fails the log is truncated to the records already durable and the
+     * background thread stops: every record after them is lost, and every commit waiting for them fails.
+     * @throw runtime_error if the log cannot be written
+     */
+    void commit(uint64_t lsn);
+
+    /**
+     * @brief apply the records of the log to the files and empty the log
+     *
+     * A record of a file that does not exist anymore is skipped, a partial record at the end
+     * of the log (written during a crash) is ignored. A file with SETEND records is cut at the last one
+     * when all the records are applied, so the writes of a change interrupted by the crash past that end
+     * are dropped.
+     * @return names of the files changed by the records applied
+     */
+    vector<string> recover();
+
+    /**
+     * @brief sync the files changed since the last checkpoint and empty the log
+     *
+     * @note the dirty pages of the files must have been written back before
+     */
+    void checkpoint();
+
+private:
+    uint64_t append(RecordType type, const string& file, size_t offset, string_view data);
+
+    /**
+     * @brief body of the background thread that writes and syncs the log
+     */
+    void flushLoop();
+};
+
+#endif // WRITEAHEADLOG_HPP
\ No newline at end of file
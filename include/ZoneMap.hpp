@@ -0,0 +1,75 @@
+#ifndef ZONEMAP_HPP
+#define ZONEMAP_HPP
+
+#include "ColumnEncoding.hpp"
+
+/**
+ * @struct ZoneField
+ * @brief A field of the records summarized by a ZoneMap.
+ */
+struct ZoneField {
+    size_t offset;
+    size_t size;
+    IntegerKind kind;
+};
+
+/**
+ * @class ZoneMap
+ * @brief Minimum and maximum of some fields for every block of BLOCK_RECORDS consecutive records of a file.
+ *
+ * The values are compared by orderKey, so a scan with IntegerFilter filters can skip the blocks
+ * whose ranges do not overlap them. The ranges only grow while the records change: a deleted or
+ * changed record can leave a range wider than needed, which never skips a block that has to be read.
+ *
+ * The zone map is kept in memory and saved in a sidecar file by save. The sidecar is removed at the
+ * first change after it is saved, so after a crash it is missing and the file rebuilds it.
+ */
+class ZoneMap {
+
+string fileName;
+vector<ZoneField> fields;
+// per ogni blocco, il minimo e il massimo di ogni campo
+vector<int64_t> bounds;
+bool saved;
+
+public:
+    static constexpr size_t BLOCK_RECORDS = RecordBatch::CAPACITY;
+
+    ZoneMap(string fileName, vector<ZoneField> fields);
+
+    /**
+     * @brief load the sidecar file
+     *
+     * @return false if it does not exist or it does not describe recordCount records of the same fields
+     */
+    bool load(size_t recordCount);
+
+    /**
+     * @brief write the sidecar file for a file of recordCount records
+     */
+    void save(size_t recordCount);
+
+    /**
+     * @brief widen the ranges of the block of a position with a record stored there
+     */
+    void add(size_t position, string_view record);
+
+    /**
+     * @brief forget the blocks after the one of the last of recordCount records
+     */
+    void truncate(size_t recordCount);
+
+    /**
+     * @return false if no record of the block of a position can satisfy all the filters
+     */
+    bool mayMatch(size_t position, const vector<IntegerFilter>& filters) const;
+
+private:
+    /**
+     * @brief remove the sidecar file, that does not describe the records anymore
+     */
+    void invalidate();
+
+};
+
+#endif // ZONEMAP_HPP
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Arena.hpp"
+
+Arena::Arena(size_t blockSize): blockSize(blockSize), used(0), allocated(0) {
+    if(blockSize == 0)
+        throw invalid_argument("The blocks of an arena cannot be empty");
+}
+
+char* Arena::allocate(size_t bytes, size_t alignment) {
+    if(alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > alignof(max_align_t))
+        throw invalid_argument("The alignment is not supported by the arena");
+
+    // new[] dà blocchi allineati a max_align_t, basta allineare la posizione nel blocco
+    size_t offset = (used + alignment - 1) & ~(alignment - 1);
+    if(blocks.empty() || offset + bytes > blocks.back().size) {
+        size_t size = max(blockSize, bytes);
+        // la memoria non si azzera, chi la chiede la scrive
+        blocks.push_back(Block{unique_ptr<char[]>(new char[size]), size});
+        offset = 0;
+    }
+
+    used = offset + bytes;
+    allocated += bytes;
+    return blocks.back().memory.get() + offset;
+}
+
+string_view Arena::copy(string_view bytes) {
+    char* p = allocate(bytes.size(), 1);
+    memcpy(p, bytes.data(), bytes.size());
+    return string_view(p, bytes.size());
+}
+
+void Arena::reset() {
+    if(blocks.size() > 1)
+        blocks.resize(1);
+    used = 0;
+    allocated = 0;
+}
+
+size_t Arena::size() const { return allocated; }
\ No newline at end of file
@@ -0,0 +1,695 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+#include "BPlusTreeFile.hpp"
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t BPLUS_MAGIC = 0x31545042; // "BPT1"
+
+/*
+    Ogni nodo inizia con questo header.
+    Nelle foglie seguono i record ordinati per chiave.
+    Nei nodi interni segue il primo figlio e poi le coppie (chiave, figlio):
+    nel figlio i-esimo ci sono le chiavi minori della chiave i-esima.
+*/
+struct NodeHeader {
+    uint8_t leaf;
+    uint8_t unused;
+    uint16_t count;
+    uint32_t next;
+};
+
+constexpr size_t NODE_HEADER_SIZE = sizeof(NodeHeader);
+
+NodeHeader readNodeHeader(const char* page) {
+    NodeHeader header;
+    memcpy(&header, page, NODE_HEADER_SIZE);
+    return header;
+}
+
+void writeNodeHeader(char* page, const NodeHeader& header) {
+    memcpy(page, &header, NODE_HEADER_SIZE);
+}
+
+uint32_t readPageNo(const char* p) {
+    uint32_t result;
+    memcpy(&result, p, sizeof(uint32_t));
+    return result;
+}
+
+void writePageNo(char* p, uint32_t pageNo) {
+    memcpy(p, &pageNo, sizeof(uint32_t));
+}
+
+}
+
+BPlusTreeFile::BPlusTreeFile(string fileName, size_t keySize, size_t recordSize, BufferPool& pool)
+: File(fileName, pool), keySize(keySize), recordSize(recordSize) {
+    if(keySize == 0 || keySize > recordSize)
+        throw invalid_argument("The key must be a non empty prefix of the record");
+    if(leafCapacity() < 3 || internalCapacity() < 3)
+        throw invalid_argument("Records are too big to be stored in a B+-tree page");
+
+    file.seekg(0, ios::end);
+    if(file.tellg() <= 0) {
+        pageCount = 1;
+        recordCount = 0;
+        rootPage = allocatePage(true);
+        firstLeaf = rootPage;
+        saveHeader();
+    } else loadHeader();
+}
+
+BPlusTreeFile::~BPlusTreeFile() {
+    saveHeader();
+    flush();
+    file.close();
+}
+
+class LeafIterator : public iterator<input_iterator_tag, string> {
+    BPlusTreeFile& tree;
+    uint32_t pageNo;
+    size_t slot;
+
+    // si sposta sulla prima foglia non vuota, pageNo 0 indica la fine
+    void skipEmptyLeaves() {
+        while(pageNo != 0) {
+            PageGuard node(tree.pool, tree, pageNo);
+            NodeHeader header = readNodeHeader(node.data());
+            if(slot < header.count)
+                return;
+            pageNo = header.next;
+            slot = 0;
+        }
+    }
+public:
+    LeafIterator(BPlusTreeFile& tree, uint32_t pageNo, size_t slot = 0)
+        : tree(tree), pageNo(pageNo), slot(slot) {
+        skipEmptyLeaves();
+    }
+
+    iterator& operator++() {
+        slot++;
+        skipEmptyLeaves();
+        return *this;
+    }
+
+    string operator*() const {
+        PageGuard node(tree.pool, tree, pageNo);
+        return string(node.data() + NODE_HEADER_SIZE + slot * tree.recordSize, tree.recordSize);
+    }
+
+    bool operator==(const LeafIterator& other) const {
+        return pageNo == other.pageNo && slot == other.slot;
+    }
+
+    bool operator!=(const LeafIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+iterator<input_iterator_tag,string> BPlusTreeFile::begin() {
+    return LeafIterator(*this, firstLeaf);
+}
+
+iterator<input_iterator_tag,string> BPlusTreeFile::end() {
+    return LeafIterator(*this, 0);
+}
+
+void BPlusTreeFile::pushData(string_view data) {
+    if(data.length() % recordSize != 0 || data.length() == 0)
+        throw runtime_error("Data length is not a multiple of record size");
+
+    for(size_t i = 0; i < data.length(); i += recordSize) {
+        auto split = insert(rootPage, data.substr(i, recordSize));
+
+        if(split.has_value()) {
+            uint32_t newRoot = allocatePage(false);
+            PageGuard root(pool, *this, newRoot);
+            char* p = root.data();
+
+            writePageNo(p + NODE_HEADER_SIZE, rootPage);
+            memcpy(p + NODE_HEADER_SIZE + sizeof(uint32_t), split.value().first.data(), keySize);
+            writePageNo(p + NODE_HEADER_SIZE + sizeof(uint32_t) + keySize, split.value().second);
+            writeNodeHeader(p, NodeHeader{0, 0, 1, 0});
+            root.markDirty();
+
+            rootPage = newRoot;
+        }
+        recordCount++;
+    }
+
+    saveHeader();
+}
+
+void BPlusTreeFile::bulkLoad(string_view data) {
+    if(data.length() % recordSize != 0 || data.length() == 0)
+        throw runtime_error("Data length is not a multiple of record size");
+
+    size_t count = data.length() / recordSize;
+    vector<uint32_t> order(count);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return memcmp(data.data() + (size_t)a * recordSize, data.data() + (size_t)b * recordSize, keySize) < 0;
+    });
+
+    string sorted;
+    sorted.reserve(data.length());
+    for(uint32_t i : order)
+        sorted.append(data.substr((size_t)i * recordSize, recordSize));
+
+    // nodi più a destra, dalla foglia alla radice, e il limite inferiore delle chiavi della foglia più a destra
+    vector<uint32_t> path;
+    string bound;
+    size_t entrySize = keySize + sizeof(uint32_t);
+    for(uint32_t pageNo = rootPage;;) {
+        PageGuard node(pool, *this, pageNo);
+        const char* p = node.data();
+        NodeHeader header = readNodeHeader(p);
+        path.insert(path.begin(), pageNo);
+
+        if(header.leaf) {
+            if(header.count > 0)
+                bound.assign(p + NODE_HEADER_SIZE + (header.count - 1) * recordSize, keySize);
+            break;
+        }
+        if(header.count == 0) {
+            pageNo = readPageNo(p + NODE_HEADER_SIZE);
+            continue;
+        }
+        const char* last = p + NODE_HEADER_SIZE + sizeof(uint32_t) + (header.count - 1) * entrySize;
+        bound.assign(last, keySize);
+        pageNo = readPageNo(last + keySize);
+    }
+
+    if(!bound.empty() && memcmp(sorted.data(), bound.data(), keySize) <= 0) {
+        // le chiavi si mescolano a quelle del file: l'ordine rende comunque locali gli accessi alle foglie
+        pushData(sorted);
+        return;
+    }
+
+    for(size_t i = 0; i < count;) {
+        {
+            PageGuard leaf(pool, *this, path[0]);
+            NodeHeader header = readNodeHeader(leaf.data());
+            size_t taken = min(leafCapacity() - header.count, count - i);
+            memcpy(leaf.data() + NODE_HEADER_SIZE + header.count * recordSize, sorted.data() + i * recordSize, taken * recordSize);
+            header.count += taken;
+            writeNodeHeader(leaf.data(), header);
+            leaf.markDirty();
+            i += taken;
+            recordCount += taken;
+        }
+        if(i == count)
+            break;
+
+        uint32_t newLeaf = allocatePage(true);
+        {
+            PageGuard leaf(pool, *this, path[0]);
+            NodeHeader header = readNodeHeader(leaf.data());
+            header.next = newLeaf;
+            writeNodeHeader(leaf.data(), header);
+            leaf.markDirty();
+        }
+        appendChild(path, 1, string_view(sorted.data() + i * recordSize, keySize), newLeaf);
+        path[0] = newLeaf;
+    }
+
+    saveHeader();
+}
+
+void BPlusTreeFile::appendChild(vector<uint32_t>& path, size_t height, string_view key, uint32_t child) {
+    size_t entrySize = keySize + sizeof(uint32_t);
+
+    if(height == path.size()) {
+        // la radice si è riempita: la nuova radice ha come figli la vecchia e il nuovo nodo
+        uint32_t newRoot = allocatePage(false);
+        PageGuard root(pool, *this, newRoot);
+        char* p = root.data();
+        writePageNo(p + NODE_HEADER_SIZE, rootPage);
+        memcpy(p + NODE_HEADER_SIZE + sizeof(uint32_t), key.data(), keySize);
+        writePageNo(p + NODE_HEADER_SIZE + sizeof(uint32_t) + keySize, child);
+        writeNodeHeader(p, NodeHeader{0, 0, 1, 0});
+        root.markDirty();
+
+        rootPage = newRoot;
+        path.push_back(newRoot);
+        return;
+    }
+
+    {
+        PageGuard node(pool, *this, path[height]);
+        char* p = node.data();
+        NodeHeader header = readNodeHeader(p);
+        if(header.count < internalCapacity()) {
+            char* entry = p + NODE_HEADER_SIZE + sizeof(uint32_t) + header.count * entrySize;
+            memcpy(entry, key.data(), keySize);
+            writePageNo(entry + keySize, child);
+            header.count++;
+            writeNodeHeader(p, header);
+            node.markDirty();
+            return;
+        }
+    }
+
+    // il nodo è pieno: il figlio apre un nuovo nodo a destra e la chiave sale al padre
+    uint32_t newNode = allocatePage(false);
+    {
+        PageGuard node(pool, *this, newNode);
+        writePageNo(node.data() + NODE_HEADER_SIZE, child);
+        node.markDirty();
+    }
+    appendChild(path, height + 1, key, newNode);
+    path[height] = newNode;
+}
+
+optional<string> BPlusTreeFile::deleteData(string_view key) {
+    if(key.length() != keySize)
+        throw invalid_argument("The key is not valid");
+
+    PageGuard leaf(pool, *this, findLeaf(key));
+    char* p = leaf.data();
+    NodeHeader header = readNodeHeader(p);
+    char* records = p + NODE_HEADER_SIZE;
+
+    size_t low = 0, high = header.count;
+    while(low < high) {
+        size_t mid = (low + high) / 2;
+        if(memcmp(records + mid * recordSize, key.data(), keySize) < 0)
+            low = mid + 1;
+        else high = mid;
+    }
+
+    if(low == header.count || memcmp(records + low * recordSize, key.data(), keySize) != 0)
+        return nullopt;
+
+    string result(records + low * recordSize, recordSize);
+    memmove(records + low * recordSize, records + (low + 1) * recordSize, (header.count - low - 1) * recordSize);
+    header.count--;
+    writeNodeHeader(p, header);
+    leaf.markDirty();
+
+    recordCount--;
+    saveHeader();
+
+    return result;
+}
+
+optional<string> BPlusTreeFile::getData(string_view key) {
+    auto rid = findRecord(key);
+    if(!rid.has_value())
+        return nullopt;
+    return getByRid(rid.value());
+}
+
+optional<RecordId> BPlusTreeFile::findRecord(string_view key) {
+    if(key.length() != keySize)
+        throw invalid_argument("The key is not valid");
+
+    uint32_t pageNo = findLeaf(key);
+    PageGuard leaf(pool, *this, pageNo);
+    const char* p = leaf.data();
+    NodeHeader header = readNodeHeader(p);
+    const char* records = p + NODE_HEADER_SIZE;
+
+    size_t low = 0, high = header.count;
+    while(low < high) {
+        size_t mid = (low + high) / 2;
+        int cmp = memcmp(records + mid * recordSize, key.data(), keySize);
+        if(cmp == 0)
+            return ((RecordId)pageNo << 16) | mid;
+        if(cmp < 0)
+            low = mid + 1;
+        else high = mid;
+    }
+    return nullopt;
+}
+
+string BPlusTreeFile::getByRid(RecordId rid) {
+    // come il cursore delle scansioni: la foglia nei bit alti e lo slot nei 16 bit bassi
+    uint32_t pageNo = rid >> 16;
+    size_t slot = rid & 0xFFFF;
+    if(pageNo == 0 || pageNo >= pageCount)
+        throw out_of_range("The record does not exist");
+
+    PageGuard leaf(pool, *this, pageNo);
+    NodeHeader header = readNodeHeader(leaf.data());
+    if(!header.leaf || slot >= header.count)
+        throw out_of_range("The record does not exist");
+    return string(leaf.data() + NODE_HEADER_SIZE + slot * recordSize, recordSize);
+}
+
+void BPlusTreeFile::updateInPlace(RecordId rid, string_view data, size_t offset) {
+    uint32_t pageNo = rid >> 16;
+    size_t slot = rid & 0xFFFF;
+    if(pageNo == 0 || pageNo >= pageCount)
+        throw out_of_range("The record does not exist");
+    checkUpdate(data, offset, keySize, recordSize);
+
+    PageGuard leaf(pool, *this, pageNo);
+    NodeHeader header = readNodeHeader(leaf.data());
+    if(!header.leaf || slot >= header.count)
+        throw out_of_range("The record does not exist");
+    memcpy(leaf.data() + NODE_HEADER_SIZE + slot * recordSize + offset, data.data(), data.length());
+    leaf.markDirty();
+}
+
+size_t BPlusTreeFile::deleteWhere(const function<bool(string_view)>& predicate) {
+    size_t deleted = 0;
+
+    for(uint32_t pageNo = firstLeaf; pageNo != 0;) {
+        PageGuard leaf(pool, *this, pageNo);
+        NodeHeader header = readNodeHeader(leaf.data());
+        char* records = leaf.data() + NODE_HEADER_SIZE;
+
+        // le foglie restano ordinate: si compattano senza cambiare l'ordine
+        size_t kept = 0;
+        for(size_t i = 0; i < header.count; i++) {
+            if(predicate(string_view(records + i * recordSize, recordSize)))
+                continue;
+            if(kept != i)
+                memcpy(records + kept * recordSize, records + i * recordSize, recordSize);
+            kept++;
+        }
+
+        if(kept != header.count) {
+            deleted += header.count - kept;
+            header.count = kept;
+            writeNodeHeader(leaf.data(), header);
+            leaf.markDirty();
+        }
+        pageNo = header.next;
+    }
+
+    if(deleted > 0) {
+        recordCount -= deleted;
+        saveHeader();
+    }
+    return deleted;
+}
+
+size_t BPlusTreeFile::updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) {
+    size_t updated = 0;
+    string record;
+
+    for(uint32_t pageNo = firstLeaf; pageNo != 0;) {
+        PageGuard leaf(pool, *this, pageNo);
+        NodeHeader header = readNodeHeader(leaf.data());
+        char* records = leaf.data() + NODE_HEADER_SIZE;
+
+        for(size_t i = 0; i < header.count; i++) {
+            string_view current(records + i * recordSize, recordSize);
+            if(!predicate(current))
+                continue;
+            applyUpdate(update, current, record, keySize);
+            memcpy(records + i * recordSize, record.data(), recordSize);
+            leaf.markDirty();
+            updated++;
+        }
+        pageNo = header.next;
+    }
+    return updated;
+}
+
+bool BPlusTreeFile::nextBatch(size_t& cursor, RecordBatch& batch) {
+    // il cursore contiene la foglia nei bit alti e lo slot nei 16 bit bassi, SIZE_MAX indica la fine
+    if(cursor == SIZE_MAX) {
+        batch.count = 0;
+        return false;
+    }
+
+    uint32_t pageNo = cursor == 0 ? firstLeaf : cursor >> 16;
+    size_t slot = cursor & 0xFFFF;
+    char* out = batch.prepare(recordSize, RecordBatch::CAPACITY);
+    size_t n = 0;
+
+    while(pageNo != 0 && n < RecordBatch::CAPACITY) {
+        PageGuard leaf(pool, *this, pageNo);
+        NodeHeader header = readNodeHeader(leaf.data());
+
+        if(slot < header.count) {
+            size_t taken = min(header.count - slot, RecordBatch::CAPACITY - n);
+            memcpy(out + n * recordSize, leaf.data() + NODE_HEADER_SIZE + slot * recordSize, taken * recordSize);
+            n += taken;
+            slot += taken;
+        }
+
+        if(slot >= header.count) {
+            pageNo = header.next;
+            slot = 0;
+        }
+    }
+
+    batch.count = n;
+    cursor = pageNo == 0 ? SIZE_MAX : ((size_t)pageNo << 16) | slot;
+    return n > 0;
+}
+
+void BPlusTreeFile::scan(string_view low, string_view high, const function<bool(string_view)>& consumer) {
+    if((!low.empty() && low.length() != keySize) || (!high.empty() && high.length() != keySize))
+        throw invalid_argument("The key is not valid");
+
+    uint32_t pageNo = findLeaf(low);
+    bool first = true;
+
+    while(pageNo != 0) {
+        PageGuard leaf(pool, *this, pageNo);
+        NodeHeader header = readNodeHeader(leaf.data());
+        const char* records = leaf.data() + NODE_HEADER_SIZE;
+
+        size_t slot = 0;
+        if(first && !low.empty()) {
+            size_t end = header.count;
+            while(slot < end) {
+                size_t mid = (slot + end) / 2;
+                if(memcmp(records + mid * recordSize, low.data(), keySize) < 0)
+                    slot = mid + 1;
+                else end = mid;
+            }
+        }
+        first = false;
+
+        for(; slot < header.count; slot++) {
+            const char* record = records + slot * recordSize;
+            if(!high.empty() && memcmp(record, high.data(), keySize) > 0)
+                return;
+            if(!consumer(string_view(record, recordSize)))
+                return;
+        }
+
+        pageNo = header.next;
+    }
+}
+
+size_t BPlusTreeFile::size() const { return recordCount; }
+
+bool BPlusTreeFile::indexedLookup() const { return true; }
+
+size_t BPlusTreeFile::leafCapacity() const {
+    return (BufferPool::PAGE_SIZE - NODE_HEADER_SIZE) / recordSize;
+}
+
+size_t BPlusTreeFile::internalCapacity() const {
+    return (BufferPool::PAGE_SIZE - NODE_HEADER_SIZE - sizeof(uint32_t)) / (keySize + sizeof(uint32_t));
+}
+
+optional<pair<string,uint32_t>> BPlusTreeFile::insert(uint32_t pageNo, string_view record) {
+    PageGuard node(pool, *this, pageNo);
+    char* p = node.data();
+    NodeHeader header = readNodeHeader(p);
+
+    if(header.leaf) {
+        char* records = p + NODE_HEADER_SIZE;
+
+        size_t pos = 0, end = header.count;
+        while(pos < end) {
+            size_t mid = (pos + end) / 2;
+            if(memcmp(records + mid * recordSize, record.data(), keySize) < 0)
+                pos = mid + 1;
+            else end = mid;
+        }
+
+        if(pos < header.count && memcmp(records + pos * recordSize, record.data(), keySize) == 0)
+            throw invalid_argument("Primary Key constraint violated");
+
+        node.markDirty();
+
+        if(header.count < leafCapacity()) {
+            memmove(records + (pos + 1) * recordSize, records + pos * recordSize, (header.count - pos) * recordSize);
+            memcpy(records + pos * recordSize, record.data(), recordSize);
+            header.count++;
+            writeNodeHeader(p, header);
+            return nullopt;
+        }
+
+        // la foglia è piena: metà dei record vanno in una nuova foglia a destra
+        string all((header.count + 1) * recordSize, '\0');
+        memcpy(all.data(), records, pos * recordSize);
+        memcpy(all.data() + pos * recordSize, record.data(), recordSize);
+        memcpy(all.data() + (pos + 1) * recordSize, records + pos * recordSize, (header.count - pos) * recordSize);
+
+        size_t total = header.count + 1;
+        size_t leftCount = total / 2;
+
+        uint32_t newPage = allocatePage(true);
+        PageGuard right(pool, *this, newPage);
+
+        memcpy(records, all.data(), leftCount * recordSize);
+        memcpy(right.data() + NODE_HEADER_SIZE, all.data() + leftCount * recordSize, (total - leftCount) * recordSize);
+        writeNodeHeader(right.data(), NodeHeader{1, 0, (uint16_t)(total - leftCount), header.next});
+        right.markDirty();
+
+        header.count = leftCount;
+        header.next = newPage;
+        writeNodeHeader(p, header);
+
+        return pair(string(all.data() + leftCount * recordSize, keySize), newPage);
+    }
+
+    size_t entrySize = keySize + sizeof(uint32_t);
+    char* entries = p + NODE_HEADER_SIZE + sizeof(uint32_t);
+
+    // indice del figlio: numero di chiavi minori o uguali alla chiave del record
+    size_t idx = 0, end = header.count;
+    while(idx < end) {
+        size_t mid = (idx + end) / 2;
+        if(memcmp(entries + mid * entrySize, record.data(), keySize) <= 0)
+            idx = mid + 1;
+        else end = mid;
+    }
+
+    uint32_t child = idx == 0 ? readPageNo(p + NODE_HEADER_SIZE) : readPageNo(entries + (idx - 1) * entrySize + keySize);
+
+    auto split = insert(child, record);
+    if(!split.has_value())
+        return nullopt;
+
+    auto [separator, newChild] = split.value();
+    node.markDirty();
+
+    if(header.count < internalCapacity()) {
+        memmove(entries + (idx + 1) * entrySize, entries + idx * entrySize, (header.count - idx) * entrySize);
+        memcpy(entries + idx * entrySize, separator.data(), keySize);
+        writePageNo(entries + idx * entrySize + keySize, newChild);
+        header.count++;
+        writeNodeHeader(p, header);
+        return nullopt;
+    }
+
+    // il nodo interno è pieno: la chiave di mezzo sale al padre
+    vector<string> keys;
+    vector<uint32_t> children;
+    children.push_back(readPageNo(p + NODE_HEADER_SIZE));
+    for(size_t i = 0; i < header.count; i++) {
+        keys.push_back(string(entries + i * entrySize, keySize));
+        children.push_back(readPageNo(entries + i * entrySize + keySize));
+    }
+    keys.insert(keys.begin() + idx, separator);
+    children.insert(children.begin() + idx + 1, newChild);
+
+    size_t mid = keys.size() / 2;
+
+    uint32_t newPage = allocatePage(false);
+    PageGuard right(pool, *this, newPage);
+    char* r = right.data();
+
+    writePageNo(r + NODE_HEADER_SIZE, children[mid + 1]);
+    char* rightEntries = r + NODE_HEADER_SIZE + sizeof(uint32_t);
+    for(size_t i = mid + 1; i < keys.size(); i++) {
+        memcpy(rightEntries + (i - mid - 1) * entrySize, keys[i].data(), keySize);
+        writePageNo(rightEntries + (i - mid - 1) * entrySize + keySize, children[i + 1]);
+    }
+    writeNodeHeader(r, NodeHeader{0, 0, (uint16_t)(keys.size() - mid - 1), 0});
+    right.markDirty();
+
+    writePageNo(p + NODE_HEADER_SIZE, children[0]);
+    for(size_t i = 0; i < mid; i++) {
+        memcpy(entries + i * entrySize, keys[i].data(), keySize);
+        writePageNo(entries + i * entrySize + keySize, children[i + 1]);
+    }
+    header.count = mid;
+    writeNodeHeader(p, header);
+
+    return pair(keys[mid], newPage);
+}
+
+uint32_t BPlusTreeFile::findLeaf(string_view key) {
+    uint32_t pageNo = rootPage;
+    size_t entrySize = keySize + sizeof(uint32_t);
+
+    while(true) {
+        PageGuard node(pool, *this, pageNo);
+        const char* p = node.data();
+        NodeHeader header = readNodeHeader(p);
+
+        if(header.leaf)
+            return pageNo;
+
+        if(key.empty()) {
+            pageNo = readPageNo(p + NODE_HEADER_SIZE);
+            continue;
+        }
+
+        const char* entries = p + NODE_HEADER_SIZE + sizeof(uint32_t);
+        size_t idx = 0, end = header.count;
+        while(idx < end) {
+            size_t mid = (idx + end) / 2;
+            if(memcmp(entries + mid * entrySize, key.data(), keySize) <= 0)
+                idx = mid + 1;
+            else end = mid;
+        }
+
+        pageNo = idx == 0 ? readPageNo(p + NODE_HEADER_SIZE) : readPageNo(entries + (idx - 1) * entrySize + keySize);
+    }
+}
+
+uint32_t BPlusTreeFile::allocatePage(bool leaf) {
+    uint32_t pageNo = pageCount++;
+
+    PageGuard page(pool, *this, pageNo);
+    memset(page.data(), 0, BufferPool::PAGE_SIZE);
+    writeNodeHeader(page.data(), NodeHeader{(uint8_t)leaf, 0, 0, 0});
+    page.markDirty();
+
+    return pageNo;
+}
+
+void BPlusTreeFile::loadHeader() {
+    PageGuard page(pool, *this, 0);
+    const char* p = page.data();
+
+    uint32_t magic, storedKeySize, storedRecordSize;
+    memcpy(&magic, p, sizeof(uint32_t));
+    memcpy(&rootPage, p + 4, sizeof(uint32_t));
+    memcpy(&pageCount, p + 8, sizeof(uint32_t));
+    memcpy(&firstLeaf, p + 12, sizeof(uint32_t));
+    memcpy(&storedKeySize, p + 16, sizeof(uint32_t));
+    memcpy(&storedRecordSize, p + 20, sizeof(uint32_t));
+    memcpy(&recordCount, p + 24, sizeof(uint64_t));
+
+    if(magic != BPLUS_MAGIC)
+        throw runtime_error("Not a B+-tree file: " + filename());
+    if(storedKeySize != keySize || storedRecordSize != recordSize)
+        throw runtime_error("The B+-tree file has a different record layout: " + filename());
+}
+
+void BPlusTreeFile::saveHeader() {
+    PageGuard page(pool, *this, 0);
+    char* p = page.data();
+
+    uint32_t magic = BPLUS_MAGIC, storedKeySize = keySize, storedRecordSize = recordSize;
+    memcpy(p, &magic, sizeof(uint32_t));
+    memcpy(p + 4, &rootPage, sizeof(uint32_t));
+    memcpy(p + 8, &pageCount, sizeof(uint32_t));
+    memcpy(p + 12, &firstLeaf, sizeof(uint32_t));
+    memcpy(p + 16, &storedKeySize, sizeof(uint32_t));
+    memcpy(p + 20, &storedRecordSize, sizeof(uint32_t));
+    memcpy(p + 24, &recordCount, sizeof(uint64_t));
+    page.markDirty();
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "BufferPool.hpp"
+#include "File.hpp"
+#include "WriteAheadLog.hpp"
+
+BufferPool::BufferPool(size_t memoryBudget): clockHand(0) {
+    size_t nFrames = memoryBudget / PAGE_SIZE;
+    if(nFrames == 0)
+        throw invalid_argument("The buffer pool must contain at least one page");
+
+    memory = make_unique<char[]>(nFrames * PAGE_SIZE);
+    frames.resize(nFrames);
+
+    for(size_t i = 0; i < nFrames; i++)
+        frames[i] = Page{nullptr, 0, memory.get() + i * PAGE_SIZE, 0, false, false, 0};
+
+    pageTable.reserve(nFrames);
+}
+
+BufferPool& BufferPool::shared() {
+    static BufferPool pool;
+    return pool;
+}
+
+Page& BufferPool::pin(File& file, size_t pageNo) {
+    lock_guard<mutex> lock(latch);
+
+    auto it = pageTable.find(PageId{&file, pageNo});
+    if(it != pageTable.end()) {
+        Page& page = frames[it->second];
+        page.pinCount++;
+        page.referenced = true;
+        return page;
+    }
+
+    size_t frame = victim();
+    Page& page = frames[frame];
+
+    file.readPage(pageNo, page.data);
+    page.file = &file;
+    page.pageNo = pageNo;
+    page.pinCount = 1;
+    page.dirty = false;
+    page.referenced = true;
+    page.lsn = 0;
+    pageTable[PageId{&file, pageNo}] = frame;
+
+    return page;
+}
+
+void BufferPool::unpin(Page& page, bool dirty, uint64_t lsn) {
+    lock_guard<mutex> lock(latch);
+
+    if(page.pinCount == 0)
+        throw logic_error("Unpin of a page that is not pinned");
+    page.pinCount--;
+    page.dirty = page.dirty || dirty;
+    page.lsn = max(page.lsn, lsn);
+}
+
+void BufferPool::flush(File& file) {
+    lock_guard<mutex> lock(latch);
+
+    for(Page& page : frames) {
+        if(page.file == &file && page.dirty)
+            writeBack(page);
+    }
+}
+
+void BufferPool::discard(File& file) {
+    lock_guard<mutex> lock(latch);
+
+    for(Page& page : frames) {
+        if(page.file == &file) {
+            pageTable.erase(PageId{page.file, page.pageNo});
+            page.file = nullptr;
+            page.pinCount = 0;
+            page.dirty = false;
+            page.referenced = false;
+            page.lsn = 0;
+        }
+    }
+}
+
+size_t BufferPool::capacity() const { return frames.size(); }
+
+size_t BufferPool::victim() {
+    // due giri completi bastano: nel primo si azzerano i bit di riferimento
+    for(size_t i = 0; i < 2 * frames.size(); i++) {
+        Page& page = frames[clockHand];
+        size_t frame = clockHand;
+        clockHand = (clockHand + 1) % frames.size();
+
+        if(page.pinCount > 0)
+            continue;
+        if(page.referenced) {
+            page.referenced = false;
+            continue;
+        }
+
+        if(page.file != nullptr) {
+            if(page.dirty)
+                writeBack(page);
+            pageTable.erase(PageId{page.file, page.pageNo});
+            page.file = nullptr;
+        }
+        return frame;
+    }
+
+    throw runtime_error("Buffer pool exhausted: every page is pinned");
+}
+
+void BufferPool::writeBack(Page& page) {
+    // la pagina va sul disco solo dopo i record del log che l'hanno modificata
+    if(page.lsn > 0 && page.file->log != nullptr)
+        page.file->log->commit(page.lsn);
+
+    page.file->writePage(page.pageNo, page.data);
+    page.dirty = false;
+    page.lsn = 0;
+}
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include <cstring>
+#include <stdexcept>
+#include <typeinfo>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ENCODING_X86
+#endif
+
+#include "ColumnEncoding.hpp"
+
+using namespace std;
+
+namespace {
+
+enum Encoding : uint8_t { FOR = 1, DELTA = 2, RLE = 3 };
+
+// codifica, minimo e massimo
+constexpr size_t FRAME_HEADER = 1 + 2 * sizeof(int64_t);
+// i valori impacchettati si leggono 8 byte alla volta: dopo l'ultimo servono 8 byte leggibili
+constexpr size_t PACK_SLACK = sizeof(uint64_t);
+// oltre questo numero di bit un valore spostato al bit del suo byte non sta più in 8 byte
+constexpr unsigned MAX_BITS = 56;
+// valori spacchettati alla volta per confrontarli con un intervallo
+constexpr size_t CHUNK = 256;
+
+struct RleRun {
+    int64_t value;
+    uint32_t end;
+};
+constexpr size_t RUN_SIZE = sizeof(int64_t) + sizeof(uint32_t);
+
+template<class T>
+inline T load(const char* p) {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template<class T>
+inline void append(string& out, T value) {
+    out.append((const char*)&value, sizeof(T));
+}
+
+inline unsigned bitsFor(uint64_t spread) {
+    return spread == 0 ? 0 : 64 - __builtin_clzll(spread);
+}
+
+inline size_t packedSize(size_t count, unsigned bits) {
+    return (count * bits + 7) / 8 + PACK_SLACK;
+}
+
+void pack(const uint64_t* values, size_t count, unsigned bits, string& out) {
+    size_t start = out.size();
+    out.resize(start + packedSize(count, bits), '\0');
+    char* p = out.data() + start;
+
+    for(size_t i = 0; i < count && bits > 0; i++) {
+        size_t position = i * bits;
+        uint64_t word = load<uint64_t>(p + position / 8);
+        word |= values[i] << (position % 8);
+        memcpy(p + position / 8, &word, sizeof(uint64_t));
+    }
+}
+
+// valori da first a first + count - 1, ognuno sommato a base
+void unpackScalar(const char* p, size_t first, size_t count, unsigned bits, uint64_t base, uint64_t* out) {
+    uint64_t mask = bits == 0 ? 0 : (~0ull >> (64 - bits));
+    for(size_t i = 0; i < count; i++) {
+        size_t position = (first + i) * bits;
+        out[i] = base + ((load<uint64_t>(p + position / 8) >> (position % 8)) & mask);
+    }
+}
+
+#ifdef ENCODING_X86
+
+bool hasAvx2() {
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+
+__attribute__((target("avx2")))
+void unpackAvx2(const char* p, size_t first, size_t count, unsigned bits, uint64_t base, uint64_t* out) {
+    const __m256i mask = _mm256_set1_epi64x(bits == 0 ? 0 : (long long)(~0ull >> (64 - bits)));
+    const __m256i baseVec = _mm256_set1_epi64x((long long)base);
+    const __m256i seven = _mm256_set1_epi64x(7);
+    const __m256i step = _mm256_set1_epi64x(4 * bits);
+    __m256i positions = _mm256_add_epi64(_mm256_set1_epi64x(first * bits), _mm256_setr_epi64x(0, bits, 2 * bits, 3 * bits));
+
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        // ogni valore si legge con gli 8 byte che iniziano dal byte del suo primo bit
+        __m256i words = _mm256_i64gather_epi64((const long long*)p, _mm256_srli_epi64(positions, 3), 1);
+        __m256i values = _mm256_and_si256(_mm256_srlv_epi64(words, _mm256_and_si256(positions, seven)), mask);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi64(values, baseVec));
+        positions = _mm256_add_epi64(positions, step);
+    }
+
+    unpackScalar(p, first + i, count - i, bits, base, out + i);
+}
+
+#endif
+
+void unpack(const char* p, size_t first, size_t count, unsigned bits, uint64_t base, uint64_t* out) {
+#ifdef ENCODING_X86
+    if(hasAvx2()) {
+        unpackAvx2(p, first, count, bits, base, out);
+        return;
+    }
+#endif
+    unpackScalar(p, first, count, bits, base, out);
+}
+
+// DELTA: il primo valore, la differenza minima e i bit delle differenze
+constexpr size_t DELTA_HEADER = 2 * sizeof(int64_t) + 1;
+
+void decodeDelta(const char* payload, size_t first, size_t count, int64_t* out) {
+    uint64_t value = load<uint64_t>(payload);
+    uint64_t minDelta = load<uint64_t>(payload + sizeof(int64_t));
+    unsigned bits = (unsigned char)payload[2 * sizeof(int64_t)];
+    const char* packed = payload + DELTA_HEADER;
+
+    // le differenze prima di first servono solo per arrivare al primo valore
+    uint64_t deltas[CHUNK];
+    size_t end = first + count;
+    for(size_t i = 0; i < end;) {
+        if(i >= first)
+            out[i - first] = (int64_t)value;
+        size_t n = min(CHUNK, end - 1 - i);
+        if(n == 0)
+            break;
+        unpack(packed, i, n, bits, minDelta, deltas);
+        for(size_t j = 0; j < n; j++) {
+            value += deltas[j];
+            if(i + j + 1 >= first)
+                out[i + j + 1 - first] = (int64_t)value;
+        }
+        i += n;
+    }
+}
+
+vector<RleRun> runsOf(const int64_t* values, size_t count) {
+    vector<RleRun> runs;
+    for(size_t i = 0; i < count; i++) {
+        if(runs.empty() || runs.back().value != values[i])
+            runs.push_back(RleRun{values[i], 0});
+        runs.back().end = i + 1;
+    }
+    return runs;
+}
+
+// indice della prima sequenza che contiene la posizione first
+size_t findRun(const char* runs, size_t runCount, size_t first) {
+    size_t low = 0, high = runCount;
+    while(low < high) {
+        size_t middle = (low + high) / 2;
+        if(load<uint32_t>(runs + middle * RUN_SIZE + sizeof(int64_t)) <= first)
+            low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+}
+
+IntegerKind integerKind(const Domain& domain) {
+    if(typeid(domain) == typeid(IntegerDomain))
+        return IntegerKind::Native32;
+    if(typeid(domain) == typeid(DateDomain))
+        return IntegerKind::Ordered32;
+    if(typeid(domain) == typeid(BigIntDomain) || typeid(domain) == typeid(TimestampDomain) || typeid(domain) == typeid(DecimalDomain))
+        return IntegerKind::Ordered64;
+    return IntegerKind::None;
+}
+
+IntegerKind orderKind(const Domain& domain) {
+    IntegerKind kind = integerKind(domain);
+    if(kind == IntegerKind::None && (typeid(domain) == typeid(StringDomain) || typeid(domain) == typeid(EnumDomain) || typeid(domain) == typeid(DoubleDomain)))
+        return IntegerKind::Prefix;
+    return kind;
+}
+
+size_t integerSize(IntegerKind kind) {
+    switch (kind) {
+        case IntegerKind::Native32:
+        case IntegerKind::Ordered32:
+            return sizeof(int32_t);
+        case IntegerKind::Ordered64:
+            return sizeof(int64_t);
+        case IntegerKind::None:
+        case IntegerKind::Prefix:
+            break;
+    }
+    return 0;
+}
+
+int64_t loadInteger(IntegerKind kind, const char* value) {
+    size_t len = integerSize(kind);
+    if(kind == IntegerKind::Native32)
+        return load<int32_t>(value);
+    if(len == 0)
+        throw invalid_argument("The field is not an integer");
+
+    uint64_t u = 0;
+    for(size_t i = 0; i < len; i++)
+        u = u << 8 | (unsigned char)value[i];
+    u ^= 1ull << (8 * len - 1);
+    if(len < 8 && (u >> (8 * len - 1)) != 0)
+        u |= ~0ull << (8 * len);
+    return (int64_t)u;
+}
+
+int64_t orderKey(IntegerKind kind, string_view value) {
+    if(kind != IntegerKind::Prefix)
+        return loadInteger(kind, value.data());
+
+    char prefix[sizeof(int64_t)] = {};
+    memcpy(prefix, value.data(), min(value.length(), sizeof(int64_t)));
+    return loadInteger(IntegerKind::Ordered64, prefix);
+}
+
+void storeInteger(IntegerKind kind, int64_t value, char* out) {
+    size_t len = integerSize(kind);
+    if(kind == IntegerKind::Native32) {
+        int32_t v = (int32_t)value;
+        memcpy(out, &v, sizeof(int32_t));
+        return;
+    }
+    if(len == 0)
+        throw invalid_argument("The field is not an integer");
+
+    uint64_t u = (uint64_t)value ^ (1ull << (8 * len - 1));
+    for(size_t i = 0; i < len; i++)
+        out[i] = (char)(u >> (8 * (len - 1 - i)));
+}
+
+string encodeIntegers(const int64_t* values, size_t count) {
+    if(count == 0)
+        throw invalid_argument("There are no values to encode");
+
+    int64_t low = values[0], high = values[0];
+    int64_t minDelta = 0, maxDelta = 0;
+    for(size_t i = 1; i < count; i++) {
+        low = min(low, values[i]);
+        high = max(high, values[i]);
+        int64_t delta = (int64_t)((uint64_t)values[i] - (uint64_t)values[i - 1]);
+        minDelta = i == 1 ? delta : min(minDelta, delta);
+        maxDelta = i == 1 ? delta : max(maxDelta, delta);
+    }
+
+    unsigned forBits = bitsFor((uint64_t)high - (uint64_t)low);
+    unsigned deltaBits = bitsFor((uint64_t)maxDelta - (uint64_t)minDelta);
+    vector<RleRun> runs = runsOf(values, count);
+
+    // RLE vale sempre, FOR e DELTA solo se i valori stanno nei bit che si possono spacchettare
+    Encoding encoding = RLE;
+    size_t best = sizeof(uint32_t) + runs.size() * RUN_SIZE;
+    if(forBits <= MAX_BITS && 1 + packedSize(count, forBits) <= best) {
+        encoding = FOR;
+        best = 1 + packedSize(count, forBits);
+    }
+    if(deltaBits <= MAX_BITS && DELTA_HEADER + packedSize(count - 1, deltaBits) < best)
+        encoding = DELTA;
+
+    string result;
+    result.push_back((char)encoding);
+    append(result, low);
+    append(result, high);
+
+    vector<uint64_t> packed(count);
+    switch (encoding) {
+        case FOR:
+            for(size_t i = 0; i < count; i++)
+                packed[i] = (uint64_t)values[i] - (uint64_t)low;
+            result.push_back((char)forBits);
+            pack(packed.data(), count, forBits, result);
+            break;
+        case DELTA:
+            for(size_t i = 1; i < count; i++)
+                packed[i - 1] = (uint64_t)values[i] - (uint64_t)values[i - 1] - (uint64_t)minDelta;
+            append(result, values[0]);
+            append(result, minDelta);
+            result.push_back((char)deltaBits);
+            pack(packed.data(), count - 1, deltaBits, result);
+            break;
+        case RLE:
+            append(result, (uint32_t)runs.size());
+            for(const RleRun& run : runs) {
+                append(result, run.value);
+                append(result, run.end);
+            }
+            break;
+    }
+    return result;
+}
+
+void decodeIntegers(string_view encoded, size_t first, size_t count, int64_t* out) {
+    if(encoded.length() < FRAME_HEADER)
+        throw runtime_error("The encoded values are corrupted");
+    const char* payload = encoded.data() + FRAME_HEADER;
+
+    switch ((Encoding)encoded[0]) {
+        case FOR:
+            unpack(payload + 1, first, count, (unsigned char)payload[0], load<uint64_t>(encoded.data() + 1), (uint64_t*)out);
+            return;
+        case DELTA:
+            decodeDelta(payload, first, count, out);
+            return;
+        case RLE: {
+            const char* runs = payload + sizeof(uint32_t);
+            size_t run = findRun(runs, load<uint32_t>(payload), first);
+            for(size_t i = first; i < first + count; i++) {
+                while(load<uint32_t>(runs + run * RUN_SIZE + sizeof(int64_t)) <= i)
+                    run++;
+                out[i - first] = load<int64_t>(runs + run * RUN_SIZE);
+            }
+            return;
+        }
+    }
+    throw runtime_error("The encoded values are corrupted");
+}
+
+void selectIntegers(string_view encoded, size_t first, size_t count, int64_t low, int64_t high, uint32_t base, SelectionVector& output) {
+    if(encoded.length() < FRAME_HEADER)
+        throw runtime_error("The encoded values are corrupted");
+    const char* payload = encoded.data() + FRAME_HEADER;
+    int64_t minimum = load<int64_t>(encoded.data() + 1);
+    int64_t maximum = load<int64_t>(encoded.data() + 1 + sizeof(int64_t));
+
+    // il minimo e il massimo del frame bastano spesso a decidere per tutti i valori
+    if(maximum < low || minimum > high || low > high)
+        return;
+    if(low <= minimum && maximum <= high) {
+        for(size_t i = 0; i < count; i++)
+            output.push_back(base + i);
+        return;
+    }
+
+    switch ((Encoding)encoded[0]) {
+        case FOR: {
+            // si confrontano le differenze dal minimo, senza ricostruire i valori
+            uint64_t lowDiff = low <= minimum ? 0 : (uint64_t)low - (uint64_t)minimum;
+            uint64_t highDiff = (uint64_t)min(high, maximum) - (uint64_t)minimum;
+            unsigned bits = (unsigned char)payload[0];
+            uint64_t diffs[CHUNK];
+            for(size_t i = 0; i < count; i += CHUNK) {
+                size_t n = min(CHUNK, count - i);
+                unpack(payload + 1, first + i, n, bits, 0, diffs);
+                for(size_t j = 0; j < n; j++) {
+                    if(diffs[j] >= lowDiff && diffs[j] <= highDiff)
+                        output.push_back(base + i + j);
+                }
+            }
+            return;
+        }
+        case RLE: {
+            // un confronto per ogni sequenza di valori uguali
+            const char* runs = payload + sizeof(uint32_t);
+            size_t runCount = load<uint32_t>(payload);
+            size_t start = first;
+            for(size_t run = findRun(runs, runCount, first); run < runCount && start < first + count; run++) {
+                size_t end = min<size_t>(load<uint32_t>(runs + run * RUN_SIZE + sizeof(int64_t)), first + count);
+                int64_t value = load<int64_t>(runs + run * RUN_SIZE);
+                if(value >= low && value <= high) {
+                    for(size_t i = start; i < end; i++)
+                        output.push_back(base + i - first);
+                }
+                start = end;
+            }
+            return;
+        }
+        case DELTA: {
+            vector<int64_t> values(count);
+            decodeDelta(payload, first, count, values.data());
+            for(size_t i = 0; i < count; i++) {
+                if(values[i] >= low && values[i] <= high)
+                    output.push_back(base + i);
+            }
+            return;
+        }
+    }
+    throw runtime_error("The encoded values are corrupted");
+}
\ No newline at end of file
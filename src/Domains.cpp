@@ -1,19 +1,171 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <typeinfo>
+
 #include "Domains.hpp"
 
-EnumDomain::EnumDomain(const std::vector<std::string>& validValues) : validValues(validValues) {
-    max_len = 0;
-    for(std::string val: validValues) {
-        if(val.size() > max_len)
-            max_len = val.size();
+namespace {
+
+// toglie il padding di '\0' in fondo a un valore
+std::string_view unpad(std::string_view value) {
+    size_t end = value.find_last_not_of('\0');
+    return end == std::string_view::npos ? std::string_view() : value.substr(0, end + 1);
+}
+
+std::string pad(std::string_view text, size_t len) {
+    std::string result(text);
+    result.resize(len, '\0');
+    return result;
+}
+
+// big-endian con il bit del segno invertito: memcmp ordina come i numeri
+std::string encodeOrdered(int64_t value, size_t len) {
+    uint64_t u = (uint64_t)value ^ (1ull << (8 * len - 1));
+    std::string result(len, '\0');
+    for(size_t i = 0; i < len; i++)
+        result[i] = (char)(u >> (8 * (len - 1 - i)));
+    return result;
+}
+
+int64_t decodeOrdered(std::string_view value) {
+    size_t len = value.length();
+    uint64_t u = 0;
+    for(size_t i = 0; i < len; i++)
+        u = u << 8 | (unsigned char)value[i];
+    u ^= 1ull << (8 * len - 1);
+    // estensione del segno per i valori più corti di 8 byte
+    if(len < 8 && (u >> (8 * len - 1)) != 0)
+        u |= ~0ull << (8 * len);
+    return (int64_t)u;
+}
+
+int64_t parseInt64(const std::string& str, const char* what) {
+    size_t end = 0;
+    long long value;
+    try {
+        value = std::stoll(str, &end);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("'" + str + "' is not " + what);
     }
+    if(end != str.length())
+        throw std::invalid_argument("'" + str + "' is not " + what);
+    return value;
+}
+
+// giorni dal 1970-01-01 di una data del calendario gregoriano
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int64_t)yoe + era * 400 + (m <= 2);
+}
+
+/**
+ * @brief read exactly len digits of text starting from pos
+ */
+bool readDigits(std::string_view text, size_t& pos, size_t len, unsigned& out) {
+    if(pos + len > text.length())
+        return false;
+    out = 0;
+    for(size_t i = 0; i < len; i++) {
+        char c = text[pos + i];
+        if(c < '0' || c > '9')
+            return false;
+        out = out * 10 + (c - '0');
+    }
+    pos += len;
+    return true;
+}
+
+// legge YYYY-MM-DD a partire da pos, controllando che il giorno esista
+bool readDate(std::string_view text, size_t& pos, int64_t& days) {
+    static const unsigned monthDays[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    unsigned y, m, d;
+    if(!readDigits(text, pos, 4, y) || pos >= text.length() || text[pos++] != '-'
+        || !readDigits(text, pos, 2, m) || pos >= text.length() || text[pos++] != '-'
+        || !readDigits(text, pos, 2, d))
+        return false;
+    if(m < 1 || m > 12 || d < 1 || d > monthDays[m - 1])
+        return false;
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if(m == 2 && d == 29 && !leap)
+        return false;
+    days = daysFromCivil(y, m, d);
+    return true;
+}
+
+std::string formatDate(int64_t days) {
+    int64_t y;
+    unsigned m, d;
+    civilFromDays(days, y, m, d);
+    char text[32];
+    snprintf(text, sizeof(text), "%04lld-%02u-%02u", (long long)y, m, d);
+    return text;
+}
+
+constexpr int64_t MICROS_PER_DAY = 86400ll * 1000000;
+
+int64_t floorDiv(int64_t a, int64_t b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+}
+
+int Domain::compare(const std::string_view a, const std::string_view b) const {
+    return a.compare(b);
+}
+
+void Domain::normalize(const std::string_view value, char* out) const {
+    memcpy(out, value.data(), size());
+}
+
+EnumDomain::EnumDomain(const std::vector<std::string>& validValues) : validValues(validValues), labels(validValues) {
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+    if(labels.size() > UINT16_MAX)
+        throw std::invalid_argument("An enum can have at most 65535 values");
+
+    codeSize = labels.size() <= UINT8_MAX ? 1 : 2;
+    for(size_t i = 0; i < labels.size(); i++)
+        codes[labels[i]] = i + 1;
 }
 
 bool EnumDomain::isValid(const std::string_view value) const {
-    return std::find(validValues.begin(), validValues.end(), value) != validValues.end();
+    if(value.length() != codeSize)
+        return false;
+    unsigned c = code(value);
+    return c >= 1 && c <= labels.size();
+}
+
+const std::vector<std::string>& EnumDomain::values() const {
+    return validValues;
+}
+
+size_t EnumDomain::count() const {
+    return labels.size();
 }
 
 size_t EnumDomain::size() const {
-    return max_len;
+    return codeSize;
 }
 
 bool EnumDomain::operator==(const Domain& other) const {
@@ -23,7 +175,26 @@ bool EnumDomain::operator==(const Domain& other) const {
         
     const auto& derived = static_cast<const EnumDomain&>(other);
         
-    return max_len == derived.max_len && validValues == derived.validValues;
+    // i codici dipendono solo dall'insieme dei valori
+    return labels == derived.labels;
+}
+
+std::string EnumDomain::parse(const std::string_view text) const {
+    auto it = codes.find(std::string(text));
+    if(it == codes.end())
+        throw std::invalid_argument("'" + std::string(text) + "' is not a value of the enum");
+
+    std::string result(codeSize, '\0');
+    if(codeSize == 2)
+        result[0] = (char)(it->second >> 8);
+    result[codeSize - 1] = (char)(it->second & 0xFF);
+    return result;
+}
+
+std::string EnumDomain::format(const std::string_view value) const {
+    if(!isValid(value))
+        throw std::invalid_argument("Not a code of the enum");
+    return labels[code(value) - 1];
 }
 
 bool IntegerDomain::isValid(const std::string_view value) const {
@@ -38,6 +209,45 @@ bool IntegerDomain::operator==(const Domain& other) const {
     return typeid(*this) == typeid(other);
 }
 
+std::string IntegerDomain::parse(const std::string_view text) const {
+    std::string str(text);
+    size_t end = 0;
+    long long value;
+
+    try {
+        value = std::stoll(str, &end);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("'" + str + "' is not an integer");
+    }
+    if(end != str.length() || value < INT_MIN || value > INT_MAX)
+        throw std::invalid_argument("'" + str + "' is not an integer");
+
+    int result = value;
+    return std::string((const char*)&result, sizeof(int));
+}
+
+std::string IntegerDomain::format(const std::string_view value) const {
+    int result;
+    memcpy(&result, value.data(), sizeof(int));
+    return std::to_string(result);
+}
+
+int IntegerDomain::compare(const std::string_view a, const std::string_view b) const {
+    int x, y;
+    memcpy(&x, a.data(), sizeof(int));
+    memcpy(&y, b.data(), sizeof(int));
+    return (x > y) - (x < y);
+}
+
+void IntegerDomain::normalize(const std::string_view value, char* out) const {
+    int x;
+    memcpy(&x, value.data(), sizeof(int));
+    // big-endian con il bit del segno invertito: i negativi vengono prima dei positivi
+    uint32_t u = (uint32_t)x ^ 0x80000000u;
+    for(size_t i = 0; i < sizeof(int); i++)
+        out[i] = (char)(u >> (8 * (sizeof(int) - 1 - i)));
+}
+
 StringDomain::StringDomain(size_t max_len) : max_len(max_len) {}
 
 bool StringDomain::isValid(const std::string_view value) const {
@@ -55,4 +265,247 @@ bool StringDomain::operator==(const Domain& other) const {
     const auto& derived = static_cast<const StringDomain&>(other);
 
     return max_len == derived.max_len;
+}
+
+std::string StringDomain::parse(const std::string_view text) const {
+    if(text.length() > max_len)
+        throw std::invalid_argument("'" + std::string(text) + "' is longer than " + std::to_string(max_len) + " characters");
+    return pad(text, max_len);
+}
+
+std::string StringDomain::format(const std::string_view value) const {
+    return std::string(unpad(value));
+}
+
+bool BigIntDomain::isValid(const std::string_view value) const {
+    return value.length() == sizeof(int64_t);
+}
+
+size_t BigIntDomain::size() const {
+    return sizeof(int64_t);
+}
+
+bool BigIntDomain::operator==(const Domain& other) const {
+    return typeid(*this) == typeid(other);
+}
+
+std::string BigIntDomain::parse(const std::string_view text) const {
+    return encode(parseInt64(std::string(text), "an integer"));
+}
+
+std::string BigIntDomain::format(const std::string_view value) const {
+    return std::to_string(decode(value));
+}
+
+std::string BigIntDomain::encode(int64_t value) {
+    return encodeOrdered(value, sizeof(int64_t));
+}
+
+int64_t BigIntDomain::decode(const std::string_view value) {
+    return decodeOrdered(value.substr(0, sizeof(int64_t)));
+}
+
+bool DoubleDomain::isValid(const std::string_view value) const {
+    return value.length() == sizeof(double) && !std::isnan(decode(value));
+}
+
+size_t DoubleDomain::size() const {
+    return sizeof(double);
+}
+
+bool DoubleDomain::operator==(const Domain& other) const {
+    return typeid(*this) == typeid(other);
+}
+
+std::string DoubleDomain::parse(const std::string_view text) const {
+    std::string str(text);
+    size_t end = 0;
+    double value;
+
+    try {
+        value = std::stod(str, &end);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("'" + str + "' is not a number");
+    }
+    if(end != str.length() || std::isnan(value))
+        throw std::invalid_argument("'" + str + "' is not a number");
+    return encode(value);
+}
+
+std::string DoubleDomain::format(const std::string_view value) const {
+    double x = decode(value);
+    char text[32];
+    // la rappresentazione più corta che si rilegge uguale
+    snprintf(text, sizeof(text), "%.15g", x);
+    if(std::stod(text) != x)
+        snprintf(text, sizeof(text), "%.17g", x);
+    return text;
+}
+
+std::string DoubleDomain::encode(double value) {
+    if(value == 0)
+        value = 0; // -0 e 0 devono avere gli stessi byte
+    uint64_t u;
+    memcpy(&u, &value, sizeof(double));
+    u = (u >> 63) != 0 ? ~u : u ^ (1ull << 63);
+
+    std::string result(sizeof(double), '\0');
+    for(size_t i = 0; i < sizeof(double); i++)
+        result[i] = (char)(u >> (8 * (sizeof(double) - 1 - i)));
+    return result;
+}
+
+double DoubleDomain::decode(const std::string_view value) {
+    uint64_t u = 0;
+    for(size_t i = 0; i < sizeof(double); i++)
+        u = u << 8 | (unsigned char)value[i];
+    u = (u >> 63) != 0 ? u ^ (1ull << 63) : ~u;
+
+    double result;
+    memcpy(&result, &u, sizeof(double));
+    return result;
+}
+
+bool DateDomain::isValid(const std::string_view value) const {
+    return value.length() == sizeof(int32_t);
+}
+
+size_t DateDomain::size() const {
+    return sizeof(int32_t);
+}
+
+bool DateDomain::operator==(const Domain& other) const {
+    return typeid(*this) == typeid(other);
+}
+
+std::string DateDomain::parse(const std::string_view text) const {
+    size_t pos = 0;
+    int64_t days;
+    if(!readDate(text, pos, days) || pos != text.length())
+        throw std::invalid_argument("'" + std::string(text) + "' is not a date");
+    return encodeOrdered(days, sizeof(int32_t));
+}
+
+std::string DateDomain::format(const std::string_view value) const {
+    return formatDate(decodeOrdered(value.substr(0, sizeof(int32_t))));
+}
+
+bool TimestampDomain::isValid(const std::string_view value) const {
+    return value.length() == sizeof(int64_t);
+}
+
+size_t TimestampDomain::size() const {
+    return sizeof(int64_t);
+}
+
+bool TimestampDomain::operator==(const Domain& other) const {
+    return typeid(*this) == typeid(other);
+}
+
+std::string TimestampDomain::parse(const std::string_view text) const {
+    size_t pos = 0;
+    int64_t days;
+    unsigned h = 0, m = 0, sec = 0, fraction = 0;
+    bool ok = readDate(text, pos, days);
+
+    // senza l'ora è la mezzanotte
+    if(ok && pos < text.length()) {
+        ok = (text[pos] == ' ' || text[pos] == 'T') && readDigits(text, ++pos, 2, h)
+            && pos < text.length() && text[pos++] == ':' && readDigits(text, pos, 2, m)
+            && pos < text.length() && text[pos++] == ':' && readDigits(text, pos, 2, sec)
+            && h < 24 && m < 60 && sec < 60;
+        if(ok && pos < text.length() && text[pos] == '.') {
+            size_t digits = text.length() - ++pos;
+            ok = digits >= 1 && digits <= 6 && readDigits(text, pos, digits, fraction);
+            for(; digits < 6; digits++)
+                fraction *= 10;
+        }
+        ok = ok && pos == text.length();
+    }
+    if(!ok)
+        throw std::invalid_argument("'" + std::string(text) + "' is not a timestamp");
+
+    int64_t micros = days * MICROS_PER_DAY + ((int64_t)h * 3600 + m * 60 + sec) * 1000000 + fraction;
+    return encodeOrdered(micros, sizeof(int64_t));
+}
+
+std::string TimestampDomain::format(const std::string_view value) const {
+    int64_t micros = decodeOrdered(value.substr(0, sizeof(int64_t)));
+    int64_t days = floorDiv(micros, MICROS_PER_DAY);
+    int64_t time = micros - days * MICROS_PER_DAY;
+
+    char text[32];
+    snprintf(text, sizeof(text), " %02lld:%02lld:%02lld", (long long)(time / 3600000000), (long long)(time / 60000000 % 60), (long long)(time / 1000000 % 60));
+    std::string result = formatDate(days) + text;
+    if(time % 1000000 != 0) {
+        snprintf(text, sizeof(text), ".%06lld", (long long)(time % 1000000));
+        result += text;
+    }
+    return result;
+}
+
+DecimalDomain::DecimalDomain(size_t precision, size_t scale) : precision(precision), scale(scale) {
+    if(precision == 0 || precision > 18 || scale > precision)
+        throw std::invalid_argument("A decimal needs a precision from 1 to 18 and a scale not greater than the precision");
+}
+
+bool DecimalDomain::isValid(const std::string_view value) const {
+    return value.length() == sizeof(int64_t);
+}
+
+size_t DecimalDomain::size() const {
+    return sizeof(int64_t);
+}
+
+bool DecimalDomain::operator==(const Domain& other) const {
+    if (typeid(*this) != typeid(other))
+        return false;
+
+    const auto& derived = static_cast<const DecimalDomain&>(other);
+
+    return precision == derived.precision && scale == derived.scale;
+}
+
+std::string DecimalDomain::parse(const std::string_view text) const {
+    size_t pos = 0;
+    bool negative = false;
+    if(pos < text.length() && (text[pos] == '-' || text[pos] == '+'))
+        negative = text[pos++] == '-';
+
+    size_t point = text.find('.', pos);
+    std::string_view integer = text.substr(pos, point == std::string_view::npos ? std::string_view::npos : point - pos);
+    std::string_view fraction = point == std::string_view::npos ? std::string_view() : text.substr(point + 1);
+
+    // le cifre oltre la precisione o la scala non vengono arrotondate, sono ammessi solo zeri in più
+    bool ok = (!integer.empty() || !fraction.empty()) && integer.length() <= precision - scale
+        && (point == std::string_view::npos || !fraction.empty());
+    for(size_t i = scale; i < fraction.length() && ok; i++)
+        ok = fraction[i] == '0';
+    int64_t value = 0;
+    for(size_t i = 0; i < integer.length() && ok; i++) {
+        ok = integer[i] >= '0' && integer[i] <= '9';
+        value = value * 10 + (integer[i] - '0');
+    }
+    for(size_t i = 0; i < scale && ok; i++) {
+        char c = i < fraction.length() ? fraction[i] : '0';
+        ok = c >= '0' && c <= '9';
+        value = value * 10 + (c - '0');
+    }
+    if(!ok)
+        throw std::invalid_argument("'" + std::string(text) + "' is not a DECIMAL(" + std::to_string(precision) + "," + std::to_string(scale) + ")");
+
+    return encodeOrdered(negative ? -value : value, sizeof(int64_t));
+}
+
+std::string DecimalDomain::format(const std::string_view value) const {
+    int64_t x = decodeOrdered(value.substr(0, sizeof(int64_t)));
+    std::string digits = std::to_string(x < 0 ? -(uint64_t)x : (uint64_t)x);
+    if(digits.length() <= scale)
+        digits.insert(0, scale + 1 - digits.length(), '0');
+
+    std::string result = x < 0 ? "-" : "";
+    result += digits.substr(0, digits.length() - scale);
+    if(scale > 0)
+        result += "." + digits.substr(digits.length() - scale);
+    return result;
 }
\ No newline at end of file
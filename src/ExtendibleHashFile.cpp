@@ -0,0 +1,469 @@
+#include <stdexcept>
+#include <cstring>
+
+#include "ExtendibleHashFile.hpp"
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t HASH_MAGIC = 0x31485845; // "EXH1"
+
+constexpr uint32_t FIRST_BUCKET_PAGE = 1 + ExtendibleHashFile::DIRECTORY_PAGES;
+
+constexpr uint32_t MAX_GLOBAL_DEPTH = 16;
+
+static_assert((1u << MAX_GLOBAL_DEPTH) * sizeof(uint32_t) <= ExtendibleHashFile::DIRECTORY_PAGES * BufferPool::PAGE_SIZE,
+    "The directory does not fit in its pages");
+
+/*
+    Ogni bucket inizia con questo header, seguono i record.
+    overflow è la pagina successiva della catena, 0 se non esiste.
+*/
+struct BucketHeader {
+    uint8_t localDepth;
+    uint8_t unused;
+    uint16_t count;
+    uint32_t overflow;
+};
+
+constexpr size_t BUCKET_HEADER_SIZE = sizeof(BucketHeader);
+
+BucketHeader readBucketHeader(const char* page) {
+    BucketHeader header;
+    memcpy(&header, page, BUCKET_HEADER_SIZE);
+    return header;
+}
+
+void writeBucketHeader(char* page, const BucketHeader& header) {
+    memcpy(page, &header, BUCKET_HEADER_SIZE);
+}
+
+// FNV-1a
+uint64_t hashKey(string_view key) {
+    uint64_t result = 14695981039346656037ULL;
+    for(unsigned char c : key) {
+        result ^= c;
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
+}
+
+ExtendibleHashFile::ExtendibleHashFile(string fileName, size_t keySize, size_t recordSize, BufferPool& pool)
+: File(fileName, pool), keySize(keySize), recordSize(recordSize) {
+    if(keySize == 0 || keySize > recordSize)
+        throw invalid_argument("The key must be a non empty prefix of the record");
+    if(bucketCapacity() < 2)
+        throw invalid_argument("Records are too big to be stored in a hash bucket");
+
+    file.seekg(0, ios::end);
+    if(file.tellg() <= 0) {
+        globalDepth = 0;
+        pageCount = FIRST_BUCKET_PAGE;
+        recordCount = 0;
+        directory.push_back(allocatePage(0));
+        saveDirectory();
+        saveHeader();
+    } else loadHeader();
+}
+
+ExtendibleHashFile::~ExtendibleHashFile() {
+    saveHeader();
+    flush();
+    file.close();
+}
+
+class BucketIterator : public iterator<input_iterator_tag, string> {
+    ExtendibleHashFile& hashFile;
+    uint32_t pageNo;
+    size_t slot;
+
+    // si sposta sul primo slot occupato, pageCount indica la fine
+    void skipEmptyPages() {
+        while(pageNo < hashFile.pageCount) {
+            PageGuard bucket(hashFile.pool, hashFile, pageNo);
+            if(slot < readBucketHeader(bucket.data()).count)
+                return;
+            pageNo++;
+            slot = 0;
+        }
+    }
+public:
+    BucketIterator(ExtendibleHashFile& hashFile, uint32_t pageNo, size_t slot = 0)
+        : hashFile(hashFile), pageNo(pageNo), slot(slot) {
+        skipEmptyPages();
+    }
+
+    iterator& operator++() {
+        slot++;
+        skipEmptyPages();
+        return *this;
+    }
+
+    string operator*() const {
+        PageGuard bucket(hashFile.pool, hashFile, pageNo);
+        return string(bucket.data() + BUCKET_HEADER_SIZE + slot * hashFile.recordSize, hashFile.recordSize);
+    }
+
+    bool operator==(const BucketIterator& other) const {
+        return pageNo == other.pageNo && slot == other.slot;
+    }
+
+    bool operator!=(const BucketIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+iterator<input_iterator_tag,string> ExtendibleHashFile::begin() {
+    return BucketIterator(*this, FIRST_BUCKET_PAGE);
+}
+
+iterator<input_iterator_tag,string> ExtendibleHashFile::end() {
+    return BucketIterator(*this, pageCount);
+}
+
+void ExtendibleHashFile::pushData(string_view data) {
+    if(data.length() % recordSize != 0 || data.length() == 0)
+        throw runtime_error("Data length is not a multiple of record size");
+
+    for(size_t i = 0; i < data.length(); i += recordSize) {
+        insert(data.substr(i, recordSize));
+        recordCount++;
+    }
+
+    saveHeader();
+}
+
+optional<string> ExtendibleHashFile::deleteData(string_view key) {
+    if(key.length() != keySize)
+        throw invalid_argument("The key is not valid");
+
+    for(uint32_t pageNo = bucketOf(key); pageNo != 0;) {
+        PageGuard bucket(pool, *this, pageNo);
+        BucketHeader header = readBucketHeader(bucket.data());
+        char* records = bucket.data() + BUCKET_HEADER_SIZE;
+
+        for(size_t i = 0; i < header.count; i++) {
+            char* record = records + i * recordSize;
+            if(memcmp(record, key.data(), keySize) == 0) {
+                string result(record, recordSize);
+                // i record non hanno ordine: l'ultimo prende il posto di quello cancellato
+                memcpy(record, records + (header.count - 1) * recordSize, recordSize);
+                header.count--;
+                writeBucketHeader(bucket.data(), header);
+                bucket.markDirty();
+
+                recordCount--;
+                saveHeader();
+                return result;
+            }
+        }
+
+        pageNo = header.overflow;
+    }
+
+    return nullopt;
+}
+
+optional<string> ExtendibleHashFile::getData(string_view key) {
+    auto rid = findRecord(key);
+    if(!rid.has_value())
+        return nullopt;
+    return getByRid(rid.value());
+}
+
+optional<RecordId> ExtendibleHashFile::findRecord(string_view key) {
+    if(key.length() != keySize)
+        throw invalid_argument("The key is not valid");
+
+    for(uint32_t pageNo = bucketOf(key); pageNo != 0;) {
+        PageGuard bucket(pool, *this, pageNo);
+        BucketHeader header = readBucketHeader(bucket.data());
+        const char* records = bucket.data() + BUCKET_HEADER_SIZE;
+
+        for(size_t i = 0; i < header.count; i++) {
+            if(memcmp(records + i * recordSize, key.data(), keySize) == 0)
+                return ((RecordId)pageNo << 16) | i;
+        }
+
+        pageNo = header.overflow;
+    }
+
+    return nullopt;
+}
+
+string ExtendibleHashFile::getByRid(RecordId rid) {
+    // la pagina del bucket nei bit alti e lo slot nei 16 bit bassi
+    uint32_t pageNo = rid >> 16;
+    size_t slot = rid & 0xFFFF;
+    if(pageNo < FIRST_BUCKET_PAGE || pageNo >= pageCount)
+        throw out_of_range("The record does not exist");
+
+    PageGuard bucket(pool, *this, pageNo);
+    if(slot >= readBucketHeader(bucket.data()).count)
+        throw out_of_range("The record does not exist");
+    return string(bucket.data() + BUCKET_HEADER_SIZE + slot * recordSize, recordSize);
+}
+
+void ExtendibleHashFile::updateInPlace(RecordId rid, string_view data, size_t offset) {
+    uint32_t pageNo = rid >> 16;
+    size_t slot = rid & 0xFFFF;
+    if(pageNo < FIRST_BUCKET_PAGE || pageNo >= pageCount)
+        throw out_of_range("The record does not exist");
+    checkUpdate(data, offset, keySize, recordSize);
+
+    PageGuard bucket(pool, *this, pageNo);
+    if(slot >= readBucketHeader(bucket.data()).count)
+        throw out_of_range("The record does not exist");
+    memcpy(bucket.data() + BUCKET_HEADER_SIZE + slot * recordSize + offset, data.data(), data.length());
+    bucket.markDirty();
+}
+
+size_t ExtendibleHashFile::deleteWhere(const function<bool(string_view)>& predicate) {
+    size_t deleted = 0;
+
+    // ogni pagina dopo la directory è un bucket o una sua pagina di overflow
+    for(uint32_t pageNo = FIRST_BUCKET_PAGE; pageNo < pageCount; pageNo++) {
+        PageGuard bucket(pool, *this, pageNo);
+        BucketHeader header = readBucketHeader(bucket.data());
+        char* records = bucket.data() + BUCKET_HEADER_SIZE;
+
+        size_t kept = 0;
+        for(size_t i = 0; i < header.count; i++) {
+            if(predicate(string_view(records + i * recordSize, recordSize)))
+                continue;
+            if(kept != i)
+                memcpy(records + kept * recordSize, records + i * recordSize, recordSize);
+            kept++;
+        }
+
+        if(kept != header.count) {
+            deleted += header.count - kept;
+            header.count = kept;
+            writeBucketHeader(bucket.data(), header);
+            bucket.markDirty();
+        }
+    }
+
+    if(deleted > 0) {
+        recordCount -= deleted;
+        saveHeader();
+    }
+    return deleted;
+}
+
+size_t ExtendibleHashFile::updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) {
+    size_t updated = 0;
+    string record;
+
+    for(uint32_t pageNo = FIRST_BUCKET_PAGE; pageNo < pageCount; pageNo++) {
+        PageGuard bucket(pool, *this, pageNo);
+        BucketHeader header = readBucketHeader(bucket.data());
+        char* records = bucket.data() + BUCKET_HEADER_SIZE;
+
+        for(size_t i = 0; i < header.count; i++) {
+            string_view current(records + i * recordSize, recordSize);
+            if(!predicate(current))
+                continue;
+            applyUpdate(update, current, record, keySize);
+            memcpy(records + i * recordSize, record.data(), recordSize);
+            bucket.markDirty();
+            updated++;
+        }
+    }
+    return updated;
+}
+
+bool ExtendibleHashFile::nextBatch(size_t& cursor, RecordBatch& batch) {
+    // il cursore contiene la pagina nei bit alti e lo slot nei 16 bit bassi, SIZE_MAX indica la fine
+    if(cursor == SIZE_MAX) {
+        batch.count = 0;
+        return false;
+    }
+
+    uint32_t pageNo = cursor == 0 ? FIRST_BUCKET_PAGE : cursor >> 16;
+    size_t slot = cursor & 0xFFFF;
+    char* out = batch.prepare(recordSize, RecordBatch::CAPACITY);
+    size_t n = 0;
+
+    while(pageNo < pageCount && n < RecordBatch::CAPACITY) {
+        PageGuard bucket(pool, *this, pageNo);
+        BucketHeader header = readBucketHeader(bucket.data());
+
+        if(slot < header.count) {
+            size_t taken = min(header.count - slot, RecordBatch::CAPACITY - n);
+            memcpy(out + n * recordSize, bucket.data() + BUCKET_HEADER_SIZE + slot * recordSize, taken * recordSize);
+            n += taken;
+            slot += taken;
+        }
+
+        if(slot >= header.count) {
+            pageNo++;
+            slot = 0;
+        }
+    }
+
+    batch.count = n;
+    cursor = pageNo >= pageCount ? SIZE_MAX : ((size_t)pageNo << 16) | slot;
+    return n > 0;
+}
+
+size_t ExtendibleHashFile::size() const { return recordCount; }
+
+bool ExtendibleHashFile::indexedLookup() const { return true; }
+
+size_t ExtendibleHashFile::bucketCapacity() const {
+    return (BufferPool::PAGE_SIZE - BUCKET_HEADER_SIZE) / recordSize;
+}
+
+uint32_t ExtendibleHashFile::bucketOf(string_view key) const {
+    return directory[hashKey(key) & ((1u << globalDepth) - 1)];
+}
+
+void ExtendibleHashFile::insert(string_view record) {
+    string_view key = record.substr(0, keySize);
+
+    if(getData(key).has_value())
+        throw invalid_argument("Primary Key constraint violated");
+
+    while(true) {
+        uint32_t pageNo = bucketOf(key);
+        PageGuard bucket(pool, *this, pageNo);
+        BucketHeader header = readBucketHeader(bucket.data());
+
+        if(header.count < bucketCapacity()) {
+            memcpy(bucket.data() + BUCKET_HEADER_SIZE + header.count * recordSize, record.data(), recordSize);
+            header.count++;
+            writeBucketHeader(bucket.data(), header);
+            bucket.markDirty();
+            return;
+        }
+
+        if(header.localDepth < MAX_GLOBAL_DEPTH) {
+            splitBucket(pageNo);
+            continue;
+        }
+
+        // la directory non può più crescere: si usa la catena di overflow
+        uint32_t last = pageNo;
+        while(true) {
+            PageGuard page(pool, *this, last);
+            BucketHeader lastHeader = readBucketHeader(page.data());
+
+            if(lastHeader.count < bucketCapacity()) {
+                memcpy(page.data() + BUCKET_HEADER_SIZE + lastHeader.count * recordSize, record.data(), recordSize);
+                lastHeader.count++;
+                writeBucketHeader(page.data(), lastHeader);
+                page.markDirty();
+                return;
+            }
+
+            if(lastHeader.overflow == 0) {
+                lastHeader.overflow = allocatePage(lastHeader.localDepth);
+                writeBucketHeader(page.data(), lastHeader);
+                page.markDirty();
+            }
+            last = lastHeader.overflow;
+        }
+    }
+}
+
+void ExtendibleHashFile::splitBucket(uint32_t pageNo) {
+    PageGuard bucket(pool, *this, pageNo);
+    BucketHeader header = readBucketHeader(bucket.data());
+
+    if(header.localDepth == globalDepth) {
+        // raddoppia la directory: la metà alta punta agli stessi bucket della metà bassa
+        size_t oldSize = directory.size();
+        directory.resize(oldSize * 2);
+        for(size_t i = 0; i < oldSize; i++)
+            directory[oldSize + i] = directory[i];
+        globalDepth++;
+    }
+
+    uint8_t newDepth = header.localDepth + 1;
+    uint32_t newPage = allocatePage(newDepth);
+    PageGuard sibling(pool, *this, newPage);
+    uint64_t splitBit = 1ULL << header.localDepth;
+
+    char* records = bucket.data() + BUCKET_HEADER_SIZE;
+    char* siblingRecords = sibling.data() + BUCKET_HEADER_SIZE;
+    uint16_t kept = 0, moved = 0;
+
+    for(size_t i = 0; i < header.count; i++) {
+        const char* record = records + i * recordSize;
+        if(hashKey(string_view(record, keySize)) & splitBit)
+            memcpy(siblingRecords + (moved++) * recordSize, record, recordSize);
+        else
+            memmove(records + (kept++) * recordSize, record, recordSize);
+    }
+
+    header.localDepth = newDepth;
+    header.count = kept;
+    writeBucketHeader(bucket.data(), header);
+    writeBucketHeader(sibling.data(), BucketHeader{newDepth, 0, moved, 0});
+    bucket.markDirty();
+    sibling.markDirty();
+
+    for(size_t i = 0; i < directory.size(); i++) {
+        if(directory[i] == pageNo && (i & splitBit))
+            directory[i] = newPage;
+    }
+
+    saveDirectory();
+    saveHeader();
+}
+
+uint32_t ExtendibleHashFile::allocatePage(uint8_t localDepth) {
+    uint32_t pageNo = pageCount++;
+
+    PageGuard page(pool, *this, pageNo);
+    memset(page.data(), 0, BufferPool::PAGE_SIZE);
+    writeBucketHeader(page.data(), BucketHeader{localDepth, 0, 0, 0});
+    page.markDirty();
+
+    return pageNo;
+}
+
+void ExtendibleHashFile::loadHeader() {
+    uint32_t magic, storedKeySize, storedRecordSize;
+    {
+        PageGuard page(pool, *this, 0);
+        const char* p = page.data();
+
+        memcpy(&magic, p, sizeof(uint32_t));
+        memcpy(&globalDepth, p + 4, sizeof(uint32_t));
+        memcpy(&pageCount, p + 8, sizeof(uint32_t));
+        memcpy(&storedKeySize, p + 12, sizeof(uint32_t));
+        memcpy(&storedRecordSize, p + 16, sizeof(uint32_t));
+        memcpy(&recordCount, p + 20, sizeof(uint64_t));
+    }
+
+    if(magic != HASH_MAGIC)
+        throw runtime_error("Not an extendible hash file: " + filename());
+    if(storedKeySize != keySize || storedRecordSize != recordSize)
+        throw runtime_error("The hash file has a different record layout: " + filename());
+
+    directory.resize(1u << globalDepth);
+    readAt(BufferPool::PAGE_SIZE, (char*)directory.data(), directory.size() * sizeof(uint32_t));
+}
+
+void ExtendibleHashFile::saveHeader() {
+    PageGuard page(pool, *this, 0);
+    char* p = page.data();
+
+    uint32_t magic = HASH_MAGIC, storedKeySize = keySize, storedRecordSize = recordSize;
+    memcpy(p, &magic, sizeof(uint32_t));
+    memcpy(p + 4, &globalDepth, sizeof(uint32_t));
+    memcpy(p + 8, &pageCount, sizeof(uint32_t));
+    memcpy(p + 12, &storedKeySize, sizeof(uint32_t));
+    memcpy(p + 16, &storedRecordSize, sizeof(uint32_t));
+    memcpy(p + 20, &recordCount, sizeof(uint64_t));
+    page.markDirty();
+}
+
+void ExtendibleHashFile::saveDirectory() {
+    writeAt(BufferPool::PAGE_SIZE, (const char*)directory.data(), directory.size() * sizeof(uint32_t));
+}
\ No newline at end of file
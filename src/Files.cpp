@@ -3,14 +3,18 @@
 #include <unistd.h>
 #include <stdexcept>
 #include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
 
 #include "HeapFile.hpp"
 #include "File.hpp"
+#include "WriteAheadLog.hpp"
 
 
 using namespace std;
 
-File::File(string fileName): name(fileName) {
+File::File(string fileName, BufferPool& pool): name(fileName), log(nullptr), lastLsn(0), pool(pool) {
     file.open(fileName, ios::binary | ios::in | ios::out);
 
     if (!file.is_open()) {
@@ -20,31 +24,167 @@ File::File(string fileName): name(fileName) {
     }
 }
 
+File::~File() {
+    if(file.is_open())
+        pool.flush(*this);
+    pool.discard(*this);
+}
+
 const string& File::filename() const { return name; }
 
-void File::flush() { file.flush(); }
+void File::flush() {
+    pool.flush(*this);
+    file.flush();
+}
+
+void File::sync() {
+    flush();
+    file.sync();
+}
+
+void File::attachLog(WriteAheadLog& log) { this->log = &log; }
+
+void File::bulkLoad(string_view data) { pushData(data); }
+
+bool File::indexedLookup() const { return false; }
 
-void File::sync() { file.sync(); }
+bool File::nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges&, const vector<IntegerFilter>&) {
+    return nextBatch(cursor, batch);
+}
+
+vector<Morsel> File::morsels() { return {Morsel{0, SIZE_MAX}}; }
+
+bool File::readMorsel(const Morsel&, size_t& cursor, RecordBatch& batch) {
+    // il morsel predefinito è tutto il file
+    return nextBatch(cursor, batch);
+}
 
+bool File::readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges&, const vector<IntegerFilter>&) {
+    return readMorsel(morsel, cursor, batch);
+}
+
+vector<Morsel> File::splitRecords(size_t end, size_t recordSize) {
+    vector<Morsel> result;
+    size_t begin = 0;
 
-HeapFile::HeapFile(string fileName, size_t keySize, size_t recordSize)
-: File(fileName), keySize(keySize), recordSize(recordSize) {
+    while(begin < end) {
+        size_t block = (begin / MORSEL_SIZE + 1) * MORSEL_SIZE;
+        size_t next = min(end, (block + recordSize - 1) / recordSize * recordSize);
+        result.push_back(Morsel{begin, next});
+        begin = next;
+    }
+    return result;
+}
+
+void File::checkUpdate(string_view data, size_t offset, size_t keySize, size_t recordSize) {
+    if(offset + data.length() > recordSize)
+        throw out_of_range("The data goes past the end of the record");
+    if(offset < keySize && !data.empty())
+        throw invalid_argument("The key of a record cannot be updated in place");
+}
+
+void File::applyUpdate(const function<void(char*)>& update, string_view record, string& out, size_t keySize) {
+    out.assign(record);
+    update(out.data());
+    if(memcmp(out.data(), record.data(), keySize) != 0)
+        throw invalid_argument("The key of a record cannot be updated in place");
+}
+
+void File::readAt(size_t pos, char* dst, size_t len) {
+    while(len > 0) {
+        size_t pageNo = pos / BufferPool::PAGE_SIZE;
+        size_t offset = pos % BufferPool::PAGE_SIZE;
+        size_t n = min(len, BufferPool::PAGE_SIZE - offset);
+
+        Page& page = pool.pin(*this, pageNo);
+        memcpy(dst, page.data + offset, n);
+        pool.unpin(page, false);
+
+        pos += n;
+        dst += n;
+        len -= n;
+    }
+}
+
+void File::writeAt(size_t pos, const char* src, size_t len) {
+    while(len > 0) {
+        size_t pageNo = pos / BufferPool::PAGE_SIZE;
+        size_t offset = pos % BufferPool::PAGE_SIZE;
+        size_t n = min(len, BufferPool::PAGE_SIZE - offset);
+
+        // un record per pagina, così l'LSN della pagina copre esattamente la modifica
+        if(log != nullptr)
+            lastLsn = log->logWrite(name, pos, string_view(src, n));
+
+        Page& page = pool.pin(*this, pageNo);
+        memcpy(page.data + offset, src, n);
+        pool.unpin(page, true, log != nullptr ? lastLsn : 0);
+
+        pos += n;
+        src += n;
+        len -= n;
+    }
+}
+
+void File::logEnd(size_t end) {
+    if(log != nullptr)
+        lastLsn = log->logSetEnd(name, end);
+}
+
+void File::commit() {
+    if(log != nullptr && lastLsn > 0)
+        log->commit(lastLsn);
+}
+
+void File::readPage(size_t pageNo, char* dst) {
+    file.seekg(pageNo * BufferPool::PAGE_SIZE, ios::beg);
+    size_t n = file.read(dst, BufferPool::PAGE_SIZE).gcount();
+    if(n < BufferPool::PAGE_SIZE) {
+        // la pagina è oltre la fine del file
+        file.clear();
+        memset(dst + n, 0, BufferPool::PAGE_SIZE - n);
+    }
+}
+
+void File::writePage(size_t pageNo, const char* src) {
+    file.seekp(pageNo * BufferPool::PAGE_SIZE, ios::beg);
+    if(!file.write(src, BufferPool::PAGE_SIZE))
+        throw runtime_error("Failed to write page of file: " + filename());
+}
+
+
+HeapFile::HeapFile(string fileName, size_t keySize, size_t recordSize, BufferPool& pool, bool hashIndex, vector<ZoneField> zoneFields)
+: File(fileName, pool), keySize(keySize), recordSize(recordSize), readFd(-1) {
     file.seekg(0, ios::end);
     endFilePosition = file.tellg();
+
+    if(hashIndex)
+        openIndex();
+    if(!zoneFields.empty()) {
+        zones = make_unique<ZoneMap>(fileName + ".zmap", move(zoneFields));
+        openZones();
+    }
 }
 
 HeapFile::~HeapFile() {
+    if(readFd >= 0)
+        close(readFd);
+    if(zones)
+        zones->save(size());
+    flush();
     file.close();
     truncateFile();
+    if(index)
+        closeIndex();
 }
 
 class RecordIterator : public iterator<input_iterator_tag, string> {
-    fstream& fileStream;
+    HeapFile& heapFile;
     size_t recordSize;
     size_t pos;
 public:
-    RecordIterator(fstream& file, size_t recordSize, size_t pos = 0)
-        : fileStream(file), recordSize(recordSize), pos(pos) {}
+    RecordIterator(HeapFile& file, size_t recordSize, size_t pos = 0)
+        : heapFile(file), recordSize(recordSize), pos(pos) {}
 
     iterator& operator++() {
         pos += recordSize;
@@ -52,10 +192,7 @@ public:
     }
 
     string operator*() const {
-        string record(recordSize, '\0');
-        fileStream.seekg(pos, ios::beg);
-        fileStream.read(record.data(), recordSize);
-        return record;
+        return heapFile.readRecord(pos);
     }
 
     bool operator==(const RecordIterator& other) const {
@@ -68,21 +205,67 @@ public:
 };
 
 iterator<input_iterator_tag,string> HeapFile::begin() {
-    return RecordIterator(file, recordSize);
+    return RecordIterator(*this, recordSize);
 }
 
 iterator<input_iterator_tag,string> HeapFile::end() {
-    return RecordIterator(file, recordSize, endFilePosition);
+    return RecordIterator(*this, recordSize, endFilePosition);
 }
 
 void HeapFile::pushData(string_view data) {
     if(data.length() % recordSize != 0 || data.length() == 0)
         throw runtime_error("Data length is not a multiple of record size");
 
-    file.seekg(endFilePosition, ios::beg);
-    if(!file.write(data.data(), data.length()))
-        throw runtime_error("Failed to write data");
+    // la fine attuale va nel log prima dei dati: se il crash interrompe l'inserimento la recovery taglia il file qui
+    logEnd(endFilePosition);
+
+    if(!index) {
+        writeAt(endFilePosition, data.data(), data.length());
+        addZones(endFilePosition, data);
+        endFilePosition += data.length();
+        logEnd(endFilePosition);
+        commit();
+        return;
+    }
+
+    // un record alla volta, così se una chiave è duplicata i record precedenti restano consistenti con l'indice
+    try {
+        for(size_t i = 0; i < data.length(); i += recordSize) {
+            index->pushData(indexEntry(data.substr(i, keySize), endFilePosition));
+            writeAt(endFilePosition, data.data() + i, recordSize);
+            addZones(endFilePosition, data.substr(i, recordSize));
+            endFilePosition += recordSize;
+        }
+    } catch(...) {
+        logEnd(endFilePosition);
+        commit();
+        throw;
+    }
+    logEnd(endFilePosition);
+    commit();
+}
+
+void HeapFile::bulkLoad(string_view data) {
+    if(data.length() % recordSize != 0 || data.length() == 0)
+        throw runtime_error("Data length is not a multiple of record size");
+
+    long start = endFilePosition;
+    logEnd(endFilePosition);
+    writeAt(endFilePosition, data.data(), data.length());
+    addZones(endFilePosition, data);
     endFilePosition += data.length();
+
+    if(index) {
+        // le chiavi sono già state controllate: gli elementi dell'indice si inseriscono in una sola chiamata
+        string entries;
+        entries.reserve(data.length() / recordSize * (keySize + sizeof(uint64_t)));
+        for(size_t i = 0; i < data.length(); i += recordSize)
+            entries.append(indexEntry(data.substr(i, keySize), start + i));
+        index->pushData(entries);
+    }
+
+    logEnd(endFilePosition);
+    commit();
 }
 
 optional<string> HeapFile::deleteData(string_view key) {
@@ -92,34 +275,211 @@ optional<string> HeapFile::deleteData(string_view key) {
     if(last_record.has_value()) {
 
         long pos = searchPosition(key);
-        if(pos == -1) return nullptr;
+        if(pos == -1) return nullopt;
+
+        string deleted = readRecord(pos);
+        long lastPosition = endFilePosition - recordSize;
+
+        logEnd(endFilePosition);
+        if(pos != lastPosition) {
+            writeAt(pos, last_record.value().c_str(), recordSize);
+            addZones(pos, last_record.value());
+            if(index) {
+                string_view movedKey(last_record.value().c_str(), keySize);
+                index->deleteData(movedKey);
+                index->pushData(indexEntry(movedKey, pos));
+            }
+        }
+        if(index)
+            index->deleteData(key);
 
-        file.seekp(pos, ios::beg);
-        file.write(last_record.value().c_str(), recordSize);
         removeLastRecord();
-        return last_record.value();
+        if(zones)
+            zones->truncate(size());
+        logEnd(endFilePosition);
+        commit();
+        return deleted;
     }
 
-    return nullptr;
+    return nullopt;
 }
 
 optional<string> HeapFile::getData(string_view key) {
-    string result(recordSize, '\0');
+    long pos = searchPosition(key);
+    if(pos == -1)
+        return nullopt;
+
+    return readRecord(pos);
+}
+
+optional<RecordId> HeapFile::findRecord(string_view key) {
+    long pos = searchPosition(key);
+    if(pos == -1)
+        return nullopt;
+    return pos;
+}
+
+string HeapFile::getByRid(RecordId rid) {
+    if(rid % recordSize != 0 || rid + recordSize > (size_t)endFilePosition)
+        throw out_of_range("The record does not exist");
+    return readRecord(rid);
+}
+
+void HeapFile::updateInPlace(RecordId rid, string_view data, size_t offset) {
+    if(rid % recordSize != 0 || rid + recordSize > (size_t)endFilePosition)
+        throw out_of_range("The record does not exist");
+    checkUpdate(data, offset, keySize, recordSize);
+
+    // la chiave non cambia, quindi l'indice resta valido; la fine nel log toglie il riempimento dell'ultima pagina dopo un crash
+    logEnd(endFilePosition);
+    writeAt(rid + offset, data.data(), data.length());
+    if(zones)
+        addZones(rid, readRecord(rid));
+    commit();
+}
 
-    file.seekg(0, ios::beg);
-    size_t n = 0;
+size_t HeapFile::deleteWhere(const function<bool(string_view)>& predicate) {
+    RecordBatch batch;
+    size_t cursor = 0;
+    long position = 0;
+    size_t deleted = 0;
+    string kept;
+
+    logEnd(endFilePosition);
+    // i record tenuti si spostano indietro: si scrive sempre prima del punto in cui si legge
+    while(nextBatch(cursor, batch)) {
+        long read = cursor - batch.count * recordSize;
+        kept.clear();
+
+        for(size_t i = 0; i < batch.count; i++) {
+            string_view record = batch[i];
+            if(predicate(record)) {
+                if(index)
+                    index->deleteData(record.substr(0, keySize));
+                deleted++;
+                continue;
+            }
+
+            long target = position + kept.size();
+            if(index && target != read + (long)(i * recordSize)) {
+                auto entry = index->findRecord(record.substr(0, keySize));
+                uint64_t value = target;
+                index->updateInPlace(entry.value(), string_view((const char*)&value, sizeof(uint64_t)), keySize);
+            }
+            kept.append(record);
+        }
 
-    do {
-        n = file.read(result.data(), recordSize).gcount();
-        if(n < recordSize) {
-            file.clear();
-            return nullopt;
+        // un blocco senza record cancellati e non spostato resta dov'è
+        if(!kept.empty() && (position != read || kept.size() != batch.count * recordSize)) {
+            writeAt(position, kept.data(), kept.size());
+            addZones(position, kept);
         }
-        if(string_view(result.c_str(),keySize) == key)
-            return result;
-    }while(true);
+        position += kept.size();
+    }
 
-    throw std::logic_error("FATAL ERROR: Unreachable code");
+    if(deleted > 0) {
+        endFilePosition = position;
+        if(zones)
+            zones->truncate(size());
+        logEnd(endFilePosition);
+        commit();
+        flush();
+        truncateFile();
+    }
+    return deleted;
+}
+
+size_t HeapFile::updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) {
+    RecordBatch batch;
+    size_t cursor = 0;
+    size_t updated = 0;
+    string record;
+
+    while(nextBatch(cursor, batch)) {
+        long read = cursor - batch.count * recordSize;
+        for(size_t i = 0; i < batch.count; i++) {
+            if(!predicate(batch[i]))
+                continue;
+            if(updated == 0)
+                logEnd(endFilePosition);
+            applyUpdate(update, batch[i], record, keySize);
+            writeAt(read + i * recordSize, record.data(), recordSize);
+            addZones(read + i * recordSize, record);
+            updated++;
+        }
+    }
+
+    // una passata senza modifiche non ha scritto nulla nel log
+    if(updated > 0)
+        commit();
+    return updated;
+}
+
+bool HeapFile::nextBatch(size_t& cursor, RecordBatch& batch) {
+    size_t remaining = cursor < (size_t)endFilePosition ? (endFilePosition - cursor) / recordSize : 0;
+    if(remaining == 0) {
+        batch.count = 0;
+        return false;
+    }
+
+    size_t n = min(remaining, RecordBatch::CAPACITY);
+    readAt(cursor, batch.prepare(recordSize, n), n * recordSize);
+    cursor += n * recordSize;
+    return true;
+}
+
+bool HeapFile::nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges&, const vector<IntegerFilter>& filters) {
+    cursor = skipZones(cursor, endFilePosition, filters);
+    return nextBatch(cursor, batch);
+}
+
+size_t HeapFile::size() const { return endFilePosition / recordSize; }
+
+bool HeapFile::indexedLookup() const { return index != nullptr; }
+
+vector<Morsel> HeapFile::morsels() {
+    // i morsel si leggono dal disco senza passare dal buffer pool
+    flush();
+    if(readFd < 0) {
+        readFd = open(filename().c_str(), O_RDONLY);
+        if(readFd < 0)
+            throw runtime_error("Failed to open file: " + filename());
+    }
+    return splitRecords(endFilePosition, recordSize);
+}
+
+bool HeapFile::readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) {
+    cursor = max(cursor, morsel.begin);
+    size_t end = min(morsel.end, (size_t)endFilePosition);
+    size_t remaining = cursor < end ? (end - cursor) / recordSize : 0;
+    if(remaining == 0 || readFd < 0) {
+        batch.count = 0;
+        return false;
+    }
+
+    size_t n = min(remaining, RecordBatch::CAPACITY);
+    char* dst = batch.prepare(recordSize, n);
+    // pread non usa la posizione condivisa del file, quindi più thread possono leggere insieme
+    for(size_t done = 0; done < n * recordSize;) {
+        ssize_t r = pread(readFd, dst + done, n * recordSize - done, cursor + done);
+        if(r <= 0)
+            throw runtime_error("Failed to read file: " + filename());
+        done += r;
+    }
+    cursor += n * recordSize;
+    return true;
+}
+
+bool HeapFile::readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges&, const vector<IntegerFilter>& filters) {
+    cursor = max(cursor, morsel.begin);
+    cursor = skipZones(cursor, min(morsel.end, (size_t)endFilePosition), filters);
+    return readMorsel(morsel, cursor, batch);
+}
+
+string HeapFile::readRecord(long position) {
+    string record(recordSize, '\0');
+    readAt(position, record.data(), recordSize);
+    return record;
 }
 
 long HeapFile::searchPosition(string_view key) {
@@ -128,39 +488,31 @@ long HeapFile::searchPosition(string_view key) {
     if(!file)
         throw runtime_error("Not working");
 
-    file.seekg(0, ios::beg);
-    string data(recordSize, '\0');
-    size_t n = 0;
+    if(index) {
+        auto entry = index->getData(key);
+        if(!entry.has_value())
+            return -1;
+        uint64_t position;
+        memcpy(&position, entry.value().c_str() + keySize, sizeof(uint64_t));
+        return position;
+    }
 
-    long result = 0;
+    string data(recordSize, '\0');
 
-    do {
-        result += n;
-        n = file.read(data.data(), recordSize).gcount();
-        if(n < recordSize) {
-            file.clear();
-            return -1;
-        }
+    for(long result = 0; result + (long)recordSize <= endFilePosition; result += recordSize) {
+        readAt(result, data.data(), keySize);
         if(string_view(data.c_str(),keySize) == key)
             return result;
-    }while(true);
+    }
 
-        
+    return -1;
 }
 
 optional<string> HeapFile::getLastRecord() {
-    // TODO: gestire il caso in cui non ci sia un record alla fine poiché il file è vuoto
-    size_t position = endFilePosition - recordSize;
-
-        // Move the file pointer to the position of the last record
-    file.seekg(position, ios::beg);
-
-        // Read the last record from the file
-    string lastRecord(recordSize, '\0');
-    file.read(lastRecord.data(), recordSize);
+    if(endFilePosition < (long)recordSize)
+        return nullopt;
 
-
-    return lastRecord;
+    return readRecord(endFilePosition - recordSize);
 }
 
 void HeapFile::removeLastRecord() {
@@ -181,4 +533,76 @@ void HeapFile::truncateFile() {
     }
 
     close(fd);
+}
+
+void HeapFile::openIndex() {
+    string indexName = filename() + ".hidx";
+    size_t entrySize = keySize + sizeof(uint64_t);
+
+    // il segno si consuma all'apertura: se il processo si ferma prima di closeIndex l'indice non è più affidabile
+    bool clean = remove((indexName + ".clean").c_str()) == 0;
+    index = make_unique<ExtendibleHashFile>(indexName, keySize, entrySize, pool);
+    if(clean && index->size() * recordSize == (size_t)endFilePosition)
+        return;
+
+    // l'indice manca, non è stato chiuso o non corrisponde al file: viene ricostruito
+    index.reset();
+    remove(indexName.c_str());
+    index = make_unique<ExtendibleHashFile>(indexName, keySize, entrySize, pool);
+
+    string key(keySize, '\0');
+    for(long position = 0; position + (long)recordSize <= endFilePosition; position += recordSize) {
+        readAt(position, key.data(), keySize);
+        index->pushData(indexEntry(key, position));
+    }
+}
+
+void HeapFile::closeIndex() {
+    string indexName = filename() + ".hidx";
+    index.reset();
+
+    // l'indice va sul disco prima del segno, altrimenti un crash del sistema potrebbe lasciare solo il segno
+    int fd = open(indexName.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    if(synced)
+        ofstream(indexName + ".clean");
+}
+
+void HeapFile::openZones() {
+    if(zones->load(size()))
+        return;
+
+    // la zone map manca o non corrisponde al file: viene ricostruita
+    RecordBatch batch;
+    size_t cursor = 0;
+    while(nextBatch(cursor, batch))
+        addZones(cursor - batch.count * recordSize, string_view(batch.data, batch.count * recordSize));
+}
+
+void HeapFile::addZones(long position, string_view data) {
+    if(!zones)
+        return;
+    for(size_t i = 0; i < data.length(); i += recordSize)
+        zones->add((position + i) / recordSize, data.substr(i, recordSize));
+}
+
+size_t HeapFile::skipZones(size_t cursor, size_t end, const vector<IntegerFilter>& filters) const {
+    if(!zones || filters.empty())
+        return cursor;
+
+    // si salta un blocco alla volta, fino al primo che può avere record che soddisfano i filtri
+    size_t record = cursor / recordSize;
+    while(record * recordSize < end && !zones->mayMatch(record, filters))
+        record = (record / ZoneMap::BLOCK_RECORDS + 1) * ZoneMap::BLOCK_RECORDS;
+    return max(cursor, min(record * recordSize, end));
+}
+
+string HeapFile::indexEntry(string_view key, long position) const {
+    string entry(key.data(), keySize);
+    uint64_t value = position;
+    entry.append((const char*)&value, sizeof(uint64_t));
+    return entry;
 }
\ No newline at end of file
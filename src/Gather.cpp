@@ -0,0 +1,167 @@
+#include <deque>
+#include <exception>
+
+#include "Operators.hpp"
+
+/**
+ * @struct Gather::Exchange
+ * @brief The state shared by the consumer and the workers of a Gather while it is open.
+ */
+struct Gather::Exchange {
+    mutex latch;
+    condition_variable changed;
+    deque<string> chunks;
+    size_t running = 0;
+    bool cancelled = false;
+    exception_ptr error;
+};
+
+Gather::Gather(vector<OperatorPtr> pipelines, ThreadPool& pool)
+: pipelines(move(pipelines)), pool(pool), position(0), opened(false) {
+    if(this->pipelines.empty())
+        throw invalid_argument("Gather needs at least a pipeline");
+    for(const OperatorPtr& pipeline : this->pipelines) {
+        if(rowSize(pipeline->columns()) != rowSize(this->pipelines[0]->columns()))
+            throw invalid_argument("The pipelines of a Gather must produce the same rows");
+    }
+}
+
+Gather::~Gather() { close(); }
+
+void Gather::open() {
+    close();
+    // i task partono al primo next: un operatore che apre più Gather e ne legge uno alla volta, come HashJoin,
+    // non deve trovare i worker occupati dalle pipeline di un Gather che non legge ancora
+    opened = true;
+}
+
+optional<string_view> Gather::next() {
+    size_t length = rowSize(columns());
+    if(position + length <= chunk.size() && length > 0) {
+        position += length;
+        return string_view(chunk).substr(position - length, length);
+    }
+    if(exchange == nullptr) {
+        if(!opened)
+            return nullopt;
+        start();
+    }
+
+    unique_lock<mutex> lock(exchange->latch);
+    exchange->changed.wait(lock, [this]() {
+        return !exchange->chunks.empty() || exchange->running == 0 || exchange->error;
+    });
+
+    if(exchange->error) {
+        exchange->cancelled = true;
+        exchange->changed.notify_all();
+        rethrow_exception(exchange->error);
+    }
+    if(exchange->chunks.empty())
+        return nullopt;
+
+    chunk = move(exchange->chunks.front());
+    exchange->chunks.pop_front();
+    exchange->changed.notify_all();
+    lock.unlock();
+
+    position = length;
+    return string_view(chunk).substr(0, length);
+}
+
+void Gather::close() {
+    if(exchange != nullptr) {
+        unique_lock<mutex> lock(exchange->latch);
+        exchange->cancelled = true;
+        exchange->changed.notify_all();
+        exchange->changed.wait(lock, [this]() { return exchange->running == 0; });
+        lock.unlock();
+        exchange.reset();
+    }
+    chunk.clear();
+    position = 0;
+    opened = false;
+}
+
+const vector<Column>& Gather::columns() const { return pipelines[0]->columns(); }
+
+optional<size_t> Gather::estimatedRows() const {
+    // le pipeline si dividono le stesse righe, ognuna ne stima il totale
+    optional<size_t> result;
+    for(const OperatorPtr& pipeline : pipelines) {
+        auto rows = pipeline->estimatedRows();
+        if(!rows.has_value())
+            return nullopt;
+        result = max(result.value_or(0), rows.value());
+    }
+    return result;
+}
+
+void Gather::transform(const function<OperatorPtr(OperatorPtr)>& transform) {
+    for(OperatorPtr& pipeline : pipelines)
+        pipeline = transform(move(pipeline));
+}
+
+void Gather::start() {
+    exchange = make_shared<Exchange>();
+    exchange->running = pipelines.size();
+    for(size_t i = 0; i < pipelines.size(); i++) {
+        // il task tiene un riferimento allo scambio, close aspetta che tutti i task siano finiti
+        shared_ptr<Exchange> state = exchange;
+        pool.submit([this, state, i]() { run(i, *state); });
+    }
+}
+
+void Gather::run(size_t i, Exchange& state) {
+    Operator& pipeline = *pipelines[i];
+    size_t length = rowSize(pipeline.columns());
+    size_t chunkSize = max<size_t>(length, 1) * CHUNK_ROWS;
+
+    // consegna un blocco di righe, aspettando se il consumatore è indietro
+    auto deliver = [&state](string& rows) {
+        unique_lock<mutex> lock(state.latch);
+        state.changed.wait(lock, [&state]() { return state.chunks.size() < MAX_CHUNKS || state.cancelled; });
+        if(state.cancelled)
+            return false;
+        state.chunks.push_back(move(rows));
+        state.changed.notify_all();
+        return true;
+    };
+
+    try {
+        pipeline.open();
+        string rows;
+        rows.reserve(chunkSize);
+        bool delivering = true;
+        while(delivering) {
+            auto row = pipeline.next();
+            if(row.has_value())
+                rows.append(row.value());
+            if((!row.has_value() && !rows.empty()) || rows.size() >= chunkSize) {
+                delivering = deliver(rows);
+                // il blocco consegnato ha portato via la memoria: se ne prende uno intero, senza farlo crescere riga per riga
+                rows.clear();
+                rows.reserve(chunkSize);
+            }
+            delivering = delivering && row.has_value();
+        }
+        pipeline.close();
+    } catch(...) {
+        {
+            lock_guard<mutex> lock(state.latch);
+            if(!state.error)
+                state.error = current_exception();
+            state.cancelled = true;
+            state.changed.notify_all();
+        }
+        try {
+            pipeline.close();
+        } catch(...) {
+            // l'errore da riportare è il primo
+        }
+    }
+
+    lock_guard<mutex> lock(state.latch);
+    state.running--;
+    state.changed.notify_all();
+}
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include <cstring>
+#include <typeinfo>
+
+#include "Operators.hpp"
+
+namespace {
+
+constexpr size_t INITIAL_SLOTS = 1024;
+
+inline int64_t loadInt64(const char* p) {
+    int64_t value;
+    memcpy(&value, p, sizeof(int64_t));
+    return value;
+}
+
+inline void storeInt64(char* p, int64_t value) {
+    memcpy(p, &value, sizeof(int64_t));
+}
+
+// le colonne di SUM e AVG sono IntegerDomain o BigIntDomain, che hanno dimensioni diverse
+inline int64_t loadInt(string_view value) {
+    if(value.length() == sizeof(int64_t))
+        return BigIntDomain::decode(value);
+    int result;
+    memcpy(&result, value.data(), sizeof(int));
+    return result;
+}
+
+}
+
+HashAggregate::HashAggregate(OperatorPtr child, vector<size_t> groupColumns, vector<Aggregate> aggregates, AggregateMode mode, size_t memoryBudget)
+: child(move(child)), groupColumns(move(groupColumns)), aggregates(move(aggregates)), mode(mode), memoryBudget(memoryBudget),
+  keySize(0), entryCount(0), depth(0), position(0) {
+    const auto& childColumns = this->child->columns();
+
+    for(size_t i : this->groupColumns) {
+        const Column& c = childColumns.at(i);
+        cols.push_back(Column{c.table, c.field, keySize});
+        keySize += c.field.size();
+    }
+
+    entrySize = keySize;
+    size_t offset = keySize;
+    for(const Aggregate& aggregate : this->aggregates) {
+        optional<Field> input;
+        if(aggregate.column.has_value())
+            input = childColumns.at(aggregate.column.value()).field;
+
+        bool numeric = aggregate.function == AggregateFunction::Sum || aggregate.function == AggregateFunction::Avg;
+        bool extreme = aggregate.function == AggregateFunction::Min || aggregate.function == AggregateFunction::Max;
+        if((numeric || extreme || mode == AggregateMode::Final) && !input.has_value())
+            throw invalid_argument("The aggregate " + aggregate.name + " needs a column");
+        bool integer = input.has_value() && (typeid(*input->getDomain()) == typeid(IntegerDomain) || typeid(*input->getDomain()) == typeid(BigIntDomain));
+        if(numeric && mode != AggregateMode::Final && !integer)
+            throw invalid_argument("The aggregate " + aggregate.name + " needs an integer column");
+
+        stateOffsets.push_back(entrySize);
+        entrySize += stateSize(aggregate);
+
+        SharedDomain domain;
+        if(extreme)
+            domain = input->getDomain();
+        else if(mode == AggregateMode::Partial)
+            domain = make_shared<StringDomain>(stateSize(aggregate));
+        else if(aggregate.function == AggregateFunction::Avg)
+            domain = make_shared<DoubleDomain>();
+        else
+            domain = make_shared<BigIntDomain>();
+
+        cols.push_back(Column{"", Field(aggregate.name, domain), offset});
+        offset += domain->size();
+    }
+}
+
+HashAggregate::~HashAggregate() = default;
+
+void HashAggregate::open() {
+    clearTable();
+    partitions.clear();
+    spill.clear();
+    depth = 0;
+
+    child->open();
+    while(auto input = child->next())
+        consume(input.value());
+    flushSpill();
+
+    // senza GROUP BY il risultato ha sempre una riga, anche se l'input è vuoto
+    if(groupColumns.empty() && entryCount == 0 && mode != AggregateMode::Partial) {
+        bool created;
+        findOrInsert("", hash<string_view>{}(""), true, created);
+    }
+    position = 0;
+}
+
+optional<string_view> HashAggregate::next() {
+    while(true) {
+        if(position < entryCount) {
+            produce(entries.data() + position++ * entrySize);
+            return row;
+        }
+        if(!nextPartition())
+            return nullopt;
+    }
+}
+
+void HashAggregate::close() {
+    child->close();
+    clearTable();
+    string().swap(entries);
+    partitions.clear();
+    spill.clear();
+}
+
+const vector<Column>& HashAggregate::columns() const { return cols; }
+
+optional<size_t> HashAggregate::estimatedRows() const {
+    if(groupColumns.empty())
+        return 1;
+    return child->estimatedRows();
+}
+
+size_t HashAggregate::stateSize(const Aggregate& aggregate) const {
+    switch (aggregate.function) {
+        case AggregateFunction::Count:
+        case AggregateFunction::Sum:
+            return sizeof(int64_t);
+        case AggregateFunction::Avg:
+            // somma e numero di righe
+            return 2 * sizeof(int64_t);
+        case AggregateFunction::Min:
+        case AggregateFunction::Max:
+            return child->columns().at(aggregate.column.value()).field.size();
+    }
+    return 0;
+}
+
+void HashAggregate::consume(string_view input) {
+    const auto& childColumns = child->columns();
+    key.clear();
+    for(size_t i : groupColumns)
+        key.append(input.substr(childColumns[i].offset, childColumns[i].field.size()));
+
+    size_t hash = std::hash<string_view>{}(key);
+    // oltre il budget si aggiornano solo i gruppi già presenti, finché c'è un livello di partizionamento disponibile
+    bool full = entryCount > 0 && depth < MAX_DEPTH
+        && entries.size() + entrySize + slots.size() * 2 * sizeof(uint32_t) > memoryBudget;
+
+    bool created;
+    char* entry = findOrInsert(key, hash, !full, created);
+    if(entry != nullptr) {
+        update(entry, input, created);
+        return;
+    }
+
+    if(spill.empty()) {
+        for(size_t i = 0; i < PARTITIONS; i++)
+            spill.push_back(make_unique<SpillFile>(rowSize(childColumns), "minidbms-aggregate"));
+    }
+    spill[partitionOf(key, depth, PARTITIONS)]->append(input);
+}
+
+char* HashAggregate::findOrInsert(string_view key, size_t hash, bool insert, bool& created) {
+    created = false;
+    size_t mask = slots.size() - 1;
+    uint32_t tag = (uint32_t)(hash >> 32) ^ (uint32_t)hash;
+
+    size_t i = hash & mask;
+    for(; slots[i] != 0; i = (i + 1) & mask) {
+        char* entry = entries.data() + (size_t)(slots[i] - 1) * entrySize;
+        if(slotHashes[i] == tag && memcmp(entry, key.data(), keySize) == 0)
+            return entry;
+    }
+
+    if(!insert)
+        return nullptr;
+
+    if((entryCount + 1) * 2 > slots.size()) {
+        grow();
+        return findOrInsert(key, hash, insert, created);
+    }
+
+    entries.resize(entries.size() + entrySize, '\0');
+    char* entry = entries.data() + entryCount * entrySize;
+    memcpy(entry, key.data(), keySize);
+    slots[i] = ++entryCount;
+    slotHashes[i] = tag;
+    created = true;
+    return entry;
+}
+
+void HashAggregate::grow() {
+    slots.assign(slots.size() * 2, 0);
+    slotHashes.assign(slots.size(), 0);
+    size_t mask = slots.size() - 1;
+
+    for(size_t e = 0; e < entryCount; e++) {
+        size_t hash = std::hash<string_view>{}(string_view(entries.data() + e * entrySize, keySize));
+        size_t i = hash & mask;
+        while(slots[i] != 0)
+            i = (i + 1) & mask;
+        slots[i] = e + 1;
+        slotHashes[i] = (uint32_t)(hash >> 32) ^ (uint32_t)hash;
+    }
+}
+
+void HashAggregate::update(char* entry, string_view input, bool created) {
+    const auto& childColumns = child->columns();
+    bool final = mode == AggregateMode::Final;
+
+    for(size_t a = 0; a < aggregates.size(); a++) {
+        const Aggregate& aggregate = aggregates[a];
+        char* state = entry + stateOffsets[a];
+        string_view value;
+        if(aggregate.column.has_value()) {
+            const Column& c = childColumns[aggregate.column.value()];
+            value = input.substr(c.offset, c.field.size());
+        }
+
+        switch (aggregate.function) {
+            case AggregateFunction::Count:
+                storeInt64(state, loadInt64(state) + (final ? loadInt64(value.data()) : 1));
+                break;
+            case AggregateFunction::Sum:
+                storeInt64(state, loadInt64(state) + (final ? loadInt64(value.data()) : loadInt(value)));
+                break;
+            case AggregateFunction::Avg:
+                storeInt64(state, loadInt64(state) + (final ? loadInt64(value.data()) : loadInt(value)));
+                storeInt64(state + sizeof(int64_t), loadInt64(state + sizeof(int64_t)) + (final ? loadInt64(value.data() + sizeof(int64_t)) : 1));
+                break;
+            case AggregateFunction::Min:
+            case AggregateFunction::Max: {
+                const Domain& domain = *childColumns[aggregate.column.value()].field.getDomain();
+                int cmp = created ? 0 : domain.compare(value, string_view(state, value.length()));
+                if(created || (aggregate.function == AggregateFunction::Min ? cmp < 0 : cmp > 0))
+                    memcpy(state, value.data(), value.length());
+                break;
+            }
+        }
+    }
+}
+
+void HashAggregate::produce(const char* entry) {
+    row.assign(entry, keySize);
+
+    for(size_t a = 0; a < aggregates.size(); a++) {
+        const Aggregate& aggregate = aggregates[a];
+        const char* state = entry + stateOffsets[a];
+
+        if(mode == AggregateMode::Partial || aggregate.function == AggregateFunction::Min || aggregate.function == AggregateFunction::Max) {
+            row.append(state, stateSize(aggregate));
+            continue;
+        }
+
+        if(aggregate.function == AggregateFunction::Avg) {
+            int64_t count = loadInt64(state + sizeof(int64_t));
+            row.append(DoubleDomain::encode(count > 0 ? (double)loadInt64(state) / count : 0.0));
+        } else
+            row.append(BigIntDomain::encode(loadInt64(state)));
+    }
+}
+
+bool HashAggregate::nextPartition() {
+    if(partitions.empty())
+        return false;
+
+    Partition partition = move(partitions.back());
+    partitions.pop_back();
+
+    clearTable();
+    depth = partition.depth;
+
+    RecordBatch batch;
+    size_t cursor = 0;
+    while(partition.rows->nextBatch(cursor, batch)) {
+        for(size_t i = 0; i < batch.count; i++)
+            consume(batch[i]);
+    }
+    flushSpill();
+    position = 0;
+    return true;
+}
+
+void HashAggregate::flushSpill() {
+    for(auto& file : spill) {
+        file->flush();
+        if(file->size() > 0)
+            partitions.push_back(Partition{move(file), depth + 1});
+    }
+    spill.clear();
+}
+
+void HashAggregate::clearTable() {
+    entries.clear();
+    entryCount = 0;
+    slots.assign(INITIAL_SLOTS, 0);
+    slotHashes.assign(INITIAL_SLOTS, 0);
+}
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include <cstring>
+#include <unordered_map>
+
+#include "Arena.hpp"
+#include "Operators.hpp"
+
+namespace {
+
+// costo stimato in memoria di una riga della hash table oltre ai suoi byte (nodo e bucket della mappa)
+constexpr size_t ENTRY_OVERHEAD = 64;
+
+}
+
+/**
+ * @class HashJoin::HashTable
+ * @brief Rows of the build input stored in blocks of memory and indexed by key.
+ *
+ * Every row is followed by its key, so the index can use views on the blocks, that never move.
+ * The blocks are taken from an Arena, that frees them all at once when the table is cleared
+ * and keeps one for the next partition.
+ */
+class HashJoin::HashTable {
+    static constexpr size_t BLOCK_SIZE = 1024 * 1024;
+
+    size_t rowSize;
+    size_t keySize;
+    size_t rowsPerBlock;
+    size_t count;
+    Arena arena;
+    vector<char*> blocks;
+    unordered_multimap<string_view, const char*> index;
+public:
+    HashTable(size_t rowSize, size_t keySize)
+    : rowSize(rowSize), keySize(keySize), rowsPerBlock(max<size_t>(1, BLOCK_SIZE / (rowSize + keySize))), count(0), arena(BLOCK_SIZE) {}
+
+    void insert(string_view key, string_view row) {
+        if(count % rowsPerBlock == 0)
+            blocks.push_back(arena.allocate(rowsPerBlock * (rowSize + keySize), 1));
+
+        char* p = blocks.back() + (count % rowsPerBlock) * (rowSize + keySize);
+        memcpy(p, row.data(), rowSize);
+        memcpy(p + rowSize, key.data(), keySize);
+        index.emplace(string_view(p + rowSize, keySize), p);
+        count++;
+    }
+
+    /**
+     * @brief replace the content of result with the rows that have a key
+     */
+    void find(string_view key, vector<const char*>& result) const {
+        result.clear();
+        auto range = index.equal_range(key);
+        for(auto it = range.first; it != range.second; ++it)
+            result.push_back(it->second);
+    }
+
+    /**
+     * @brief call consumer(key, row) for every row
+     */
+    template<class Consumer>
+    void forEach(Consumer consumer) const {
+        for(size_t i = 0; i < count; i++) {
+            const char* p = blocks[i / rowsPerBlock] + (i % rowsPerBlock) * (rowSize + keySize);
+            consumer(string_view(p + rowSize, keySize), string_view(p, rowSize));
+        }
+    }
+
+    /**
+     * @return the memory used by count rows
+     */
+    size_t memory(size_t count) const { return count * (rowSize + keySize + ENTRY_OVERHEAD); }
+
+    size_t memory() const { return memory(count); }
+
+    void clear() {
+        index.clear();
+        blocks.clear();
+        arena.reset();
+        count = 0;
+    }
+};
+
+HashJoin::HashJoin(OperatorPtr left, OperatorPtr right, vector<size_t> leftKeys, vector<size_t> rightKeys, size_t memoryBudget)
+: left(move(left)), right(move(right)), leftKeys(move(leftKeys)), rightKeys(move(rightKeys)), memoryBudget(memoryBudget),
+  buildLeft(false), spilled(false), probeCursor(0), probePosition(0), matchPosition(0) {
+    const auto& leftColumns = this->left->columns();
+    const auto& rightColumns = this->right->columns();
+
+    if(this->leftKeys.empty() || this->leftKeys.size() != this->rightKeys.size())
+        throw invalid_argument("The join has no valid join columns");
+
+    for(size_t i = 0; i < this->leftKeys.size(); i++) {
+        const Field& a = leftColumns.at(this->leftKeys[i]).field;
+        const Field& b = rightColumns.at(this->rightKeys[i]).field;
+        // le chiavi si confrontano byte per byte, quindi i valori devono avere la stessa rappresentazione:
+        // due enum hanno gli stessi codici solo se hanno gli stessi valori
+        if(!(*a.getDomain() == *b.getDomain()))
+            throw invalid_argument("Columns " + a.getName() + " and " + b.getName() + " have different domains");
+    }
+
+    size_t leftSize = rowSize(leftColumns);
+    cols = leftColumns;
+    for(const Column& c : rightColumns)
+        cols.push_back(Column{c.table, c.field, leftSize + c.offset});
+}
+
+HashJoin::~HashJoin() = default;
+
+void HashJoin::open() {
+    auto leftRows = left->estimatedRows();
+    auto rightRows = right->estimatedRows();
+    buildLeft = leftRows.has_value() && (!rightRows.has_value() || leftRows.value() < rightRows.value());
+
+    left->open();
+    right->open();
+
+    partitions.clear();
+    probeFile.reset();
+    matches.clear();
+    matchPosition = 0;
+    build();
+}
+
+optional<string_view> HashJoin::next() {
+    while(true) {
+        if(matchPosition < matches.size()) {
+            string_view match(matches[matchPosition++], rowSize(buildInput().columns()));
+            row.clear();
+            row.append(buildLeft ? match : probeRow);
+            row.append(buildLeft ? probeRow : match);
+            return row;
+        }
+
+        auto input = nextProbeRow();
+        if(!input.has_value()) {
+            if(!nextPartition())
+                return nullopt;
+            continue;
+        }
+
+        probeRow = input.value();
+        table->find(keyOf(probeRow, false), matches);
+        matchPosition = 0;
+    }
+}
+
+void HashJoin::close() {
+    left->close();
+    right->close();
+    table.reset();
+    partitions.clear();
+    probeFile.reset();
+    matches.clear();
+}
+
+const vector<Column>& HashJoin::columns() const { return cols; }
+
+optional<size_t> HashJoin::estimatedRows() const {
+    auto leftRows = left->estimatedRows();
+    auto rightRows = right->estimatedRows();
+    if(!leftRows.has_value() || !rightRows.has_value())
+        return nullopt;
+    // di solito si unisce una chiave esterna con la chiave della tabella riferita
+    return max(leftRows.value(), rightRows.value());
+}
+
+Operator& HashJoin::buildInput() const { return buildLeft ? *left : *right; }
+
+Operator& HashJoin::probeInput() const { return buildLeft ? *right : *left; }
+
+string_view HashJoin::keyOf(string_view row, bool build) {
+    bool fromLeft = build == buildLeft;
+    const auto& columns = fromLeft ? left->columns() : right->columns();
+    const auto& keys = fromLeft ? leftKeys : rightKeys;
+
+    key.clear();
+    for(size_t i : keys)
+        key.append(row.substr(columns[i].offset, columns[i].field.size()));
+    return key;
+}
+
+void HashJoin::build() {
+    size_t buildSize = rowSize(buildInput().columns());
+    size_t keySize = 0;
+    for(size_t i : leftKeys)
+        keySize += left->columns()[i].field.size();
+
+    table = make_unique<HashTable>(buildSize, keySize);
+    spilled = false;
+
+    while(auto input = buildInput().next()) {
+        table->insert(keyOf(input.value(), true), input.value());
+        if(table->memory() > memoryBudget) {
+            spill();
+            return;
+        }
+    }
+}
+
+void HashJoin::spill() {
+    spilled = true;
+
+    size_t buildSize = rowSize(buildInput().columns());
+    size_t probeSize = rowSize(probeInput().columns());
+    vector<Partition> created(PARTITIONS);
+    for(Partition& p : created) {
+        p.build = make_unique<SpillFile>(buildSize, "minidbms-join");
+        p.probe = make_unique<SpillFile>(probeSize, "minidbms-join");
+        p.depth = 0;
+    }
+
+    table->forEach([&](string_view key, string_view row) {
+        created[partitionOf(key, 0, PARTITIONS)].build->append(row);
+    });
+    table->clear();
+
+    while(auto input = buildInput().next())
+        created[partitionOf(keyOf(input.value(), true), 0, PARTITIONS)].build->append(input.value());
+    while(auto input = probeInput().next())
+        created[partitionOf(keyOf(input.value(), false), 0, PARTITIONS)].probe->append(input.value());
+
+    for(Partition& p : created) {
+        p.build->flush();
+        p.probe->flush();
+        if(p.build->size() > 0 && p.probe->size() > 0)
+            partitions.push_back(move(p));
+    }
+}
+
+void HashJoin::split(Partition& partition) {
+    size_t depth = partition.depth + 1;
+    vector<Partition> created(PARTITIONS);
+    for(Partition& p : created) {
+        p.build = make_unique<SpillFile>(rowSize(buildInput().columns()), "minidbms-join");
+        p.probe = make_unique<SpillFile>(rowSize(probeInput().columns()), "minidbms-join");
+        p.depth = depth;
+    }
+
+    RecordBatch batch;
+    size_t cursor = 0;
+    while(partition.build->nextBatch(cursor, batch)) {
+        for(size_t i = 0; i < batch.count; i++)
+            created[partitionOf(keyOf(batch[i], true), depth, PARTITIONS)].build->append(batch[i]);
+    }
+    cursor = 0;
+    while(partition.probe->nextBatch(cursor, batch)) {
+        for(size_t i = 0; i < batch.count; i++)
+            created[partitionOf(keyOf(batch[i], false), depth, PARTITIONS)].probe->append(batch[i]);
+    }
+
+    for(Partition& p : created) {
+        p.build->flush();
+        p.probe->flush();
+        if(p.build->size() > 0 && p.probe->size() > 0)
+            partitions.push_back(move(p));
+    }
+}
+
+bool HashJoin::nextPartition() {
+    probeFile.reset();
+
+    while(!partitions.empty()) {
+        Partition partition = move(partitions.back());
+        partitions.pop_back();
+
+        // una partizione con molte righe della stessa chiave non si riduce: dopo MAX_DEPTH si carica comunque
+        if(table->memory(partition.build->size()) > memoryBudget && partition.depth < MAX_DEPTH) {
+            split(partition);
+            continue;
+        }
+
+        table->clear();
+        RecordBatch batch;
+        size_t cursor = 0;
+        while(partition.build->nextBatch(cursor, batch)) {
+            for(size_t i = 0; i < batch.count; i++)
+                table->insert(keyOf(batch[i], true), batch[i]);
+        }
+
+        probeFile = move(partition.probe);
+        probeCursor = 0;
+        probePosition = 0;
+        probeBatch.count = 0;
+        return true;
+    }
+
+    return false;
+}
+
+optional<string_view> HashJoin::nextProbeRow() {
+    if(!spilled)
+        return probeInput().next();
+    if(probeFile == nullptr)
+        return nullopt;
+
+    if(probePosition >= probeBatch.count) {
+        if(!probeFile->nextBatch(probeCursor, probeBatch))
+            return nullopt;
+        probePosition = 0;
+    }
+    return probeBatch[probePosition++];
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "KeyFilter.hpp"
+
+namespace {
+
+constexpr uint32_t KEYFILTER_MAGIC = 0x3159454B; // "KEY1"
+
+// un blocco è una linea di cache: 8 parole da 64 bit
+constexpr size_t BLOCK_WORDS = 8;
+constexpr size_t BLOCK_BITS = BLOCK_WORDS * 64;
+
+// FNV-1a seguito dal finalizzatore di splitmix64: lo stesso valore in ogni esecuzione, il filtro è salvato
+uint64_t hashKey(string_view key) {
+    uint64_t h = 14695981039346656037ull;
+    for(char c : key) {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+}
+
+KeyFilter::KeyFilter(string fileName)
+: fileName(move(fileName)), capacity(0), count(0), removed(0), saved(false) {
+    reset(0);
+}
+
+KeyFilter::~KeyFilter() { save(); }
+
+bool KeyFilter::load(size_t keyCount) {
+    ifstream input(fileName, ios::binary);
+    if(!input)
+        return false;
+
+    uint32_t magic = 0;
+    uint64_t header[3];
+    input.read((char*)&magic, sizeof(uint32_t));
+    input.read((char*)header, sizeof(header));
+    if(!input || magic != KEYFILTER_MAGIC || header[1] != keyCount || header[0] < MIN_CAPACITY)
+        return false;
+
+    vector<uint64_t> loaded((header[0] * BITS_PER_KEY + BLOCK_BITS - 1) / BLOCK_BITS * BLOCK_WORDS);
+    input.read((char*)loaded.data(), loaded.size() * sizeof(uint64_t));
+    if(!input)
+        return false;
+
+    bits.swap(loaded);
+    capacity = header[0];
+    count = header[1];
+    removed = header[2];
+    saved = true;
+    return true;
+}
+
+void KeyFilter::save() {
+    if(saved)
+        return;
+
+    string tempName = fileName + ".tmp";
+    {
+        ofstream output(tempName, ios::binary | ios::trunc);
+        uint64_t header[] = {capacity, count, removed};
+        output.write((const char*)&KEYFILTER_MAGIC, sizeof(uint32_t));
+        output.write((const char*)header, sizeof(header));
+        output.write((const char*)bits.data(), bits.size() * sizeof(uint64_t));
+        if(!output) {
+            std::remove(tempName.c_str());
+            return;
+        }
+    }
+    saved = rename(tempName.c_str(), fileName.c_str()) == 0;
+}
+
+void KeyFilter::reset(size_t keyCount) {
+    invalidate();
+    // il doppio delle chiavi: il filtro cresce ancora prima di doverlo ricostruire
+    capacity = max<uint64_t>(MIN_CAPACITY, 2 * keyCount);
+    bits.assign((capacity * BITS_PER_KEY + BLOCK_BITS - 1) / BLOCK_BITS * BLOCK_WORDS, 0);
+    count = 0;
+    removed = 0;
+}
+
+void KeyFilter::add(string_view key) {
+    invalidate();
+
+    uint64_t h = hashKey(key);
+    uint64_t* block = bits.data() + (h % (bits.size() / BLOCK_WORDS)) * BLOCK_WORDS;
+    for(size_t i = 0; i < BITS_PER_KEY_SET; i++) {
+        h = h * 0x9E3779B97F4A7C15ull + i;
+        size_t bit = h >> 55;
+        block[bit / 64] |= 1ull << (bit % 64);
+    }
+    count++;
+}
+
+void KeyFilter::remove(size_t keys) {
+    invalidate();
+    count -= min<uint64_t>(count, keys);
+    removed += keys;
+}
+
+bool KeyFilter::mayContain(string_view key) const {
+    uint64_t h = hashKey(key);
+    const uint64_t* block = bits.data() + (h % (bits.size() / BLOCK_WORDS)) * BLOCK_WORDS;
+    for(size_t i = 0; i < BITS_PER_KEY_SET; i++) {
+        h = h * 0x9E3779B97F4A7C15ull + i;
+        size_t bit = h >> 55;
+        if((block[bit / 64] & (1ull << (bit % 64))) == 0)
+            return false;
+    }
+    return true;
+}
+
+bool KeyFilter::stale() const {
+    // le chiavi rimosse hanno ancora i loro bit: contano come quelle presenti
+    return count + removed > capacity;
+}
+
+void KeyFilter::invalidate() {
+    if(saved) {
+        std::remove(fileName.c_str());
+        saved = false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MappedHeapFile.hpp"
+
+using namespace std;
+
+MappedHeapFile::MappedHeapFile(string fileName, size_t keySize, size_t recordSize)
+: File(fileName), keySize(keySize), recordSize(recordSize), mapping(nullptr), capacity(0) {
+    fd = open(filename().c_str(), O_RDWR);
+    if (fd == -1)
+        throw runtime_error("Failed to open file descriptor: " + filename());
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw runtime_error("Failed to stat file: " + filename());
+    }
+
+    endFilePosition = info.st_size;
+    try {
+        remap(endFilePosition);
+    } catch(...) {
+        close(fd);
+        throw;
+    }
+}
+
+MappedHeapFile::~MappedHeapFile() {
+    // un distruttore non può lanciare: se il file non si accorcia resta lungo quanto la mappatura
+    try {
+        truncateFile();
+    } catch(const runtime_error&) {}
+    if(mapping != nullptr)
+        munmap(mapping, capacity);
+    close(fd);
+}
+
+class MappedRecordIterator : public iterator<input_iterator_tag, string> {
+    const MappedHeapFile& mappedFile;
+    size_t i;
+public:
+    MappedRecordIterator(const MappedHeapFile& file, size_t i = 0)
+        : mappedFile(file), i(i) {}
+
+    iterator& operator++() {
+        i++;
+        return *this;
+    }
+
+    string_view operator*() const {
+        return mappedFile.recordAt(i);
+    }
+
+    bool operator==(const MappedRecordIterator& other) const {
+        return i == other.i;
+    }
+
+    bool operator!=(const MappedRecordIterator& other) const {
+        return i != other.i;
+    }
+};
+
+iterator<input_iterator_tag,string> MappedHeapFile::begin() {
+    return MappedRecordIterator(*this);
+}
+
+iterator<input_iterator_tag,string> MappedHeapFile::end() {
+    return MappedRecordIterator(*this, size());
+}
+
+void MappedHeapFile::pushData(string_view data) {
+    if(data.length() % recordSize != 0 || data.length() == 0)
+        throw runtime_error("Data length is not a multiple of record size");
+
+    size_t required = endFilePosition + data.length();
+    if(required > capacity) {
+        // il file cresce con degli zeri: la fine vera deve essere nel log prima, per tagliarli dopo un crash
+        logEnd(endFilePosition);
+        commit();
+        size_t chunks = (required + GROWTH_CHUNK - 1) / GROWTH_CHUNK;
+        remap(max(chunks * GROWTH_CHUNK, capacity * 2));
+    }
+
+    memcpy(mapping + endFilePosition, data.data(), data.length());
+    endFilePosition += data.length();
+    logEnd(endFilePosition);
+    commit();
+}
+
+optional<string> MappedHeapFile::deleteData(string_view key) {
+    long pos = searchPosition(key);
+    if(pos == -1)
+        return nullopt;
+
+    string deleted(mapping + pos, recordSize);
+    long lastPosition = endFilePosition - recordSize;
+    if(pos != lastPosition)
+        memcpy(mapping + pos, mapping + lastPosition, recordSize);
+    endFilePosition = lastPosition;
+    logEnd(endFilePosition);
+    commit();
+
+    // si restituisce memoria quando la mappatura è quasi vuota
+    if(capacity > GROWTH_CHUNK && (size_t)endFilePosition < capacity / 4)
+        remap(capacity / 2);
+
+    return deleted;
+}
+
+optional<string> MappedHeapFile::getData(string_view key) {
+    auto view = viewData(key);
+    if(!view.has_value())
+        return nullopt;
+    return string(view.value());
+}
+
+optional<RecordId> MappedHeapFile::findRecord(string_view key) {
+    long pos = searchPosition(key);
+    if(pos == -1)
+        return nullopt;
+    return pos;
+}
+
+string MappedHeapFile::getByRid(RecordId rid) {
+    if(rid % recordSize != 0 || rid + recordSize > (size_t)endFilePosition)
+        throw out_of_range("The record does not exist");
+    return string(mapping + rid, recordSize);
+}
+
+void MappedHeapFile::updateInPlace(RecordId rid, string_view data, size_t offset) {
+    if(rid % recordSize != 0 || rid + recordSize > (size_t)endFilePosition)
+        throw out_of_range("The record does not exist");
+    checkUpdate(data, offset, keySize, recordSize);
+    memcpy(mapping + rid + offset, data.data(), data.length());
+}
+
+size_t MappedHeapFile::deleteWhere(const function<bool(string_view)>& predicate) {
+    long position = 0;
+    size_t deleted = 0;
+
+    for(long pos = 0; pos + (long)recordSize <= endFilePosition; pos += recordSize) {
+        if(predicate(string_view(mapping + pos, recordSize))) {
+            deleted++;
+            continue;
+        }
+        if(position != pos)
+            memcpy(mapping + position, mapping + pos, recordSize);
+        position += recordSize;
+    }
+
+    if(deleted > 0) {
+        endFilePosition = position;
+        logEnd(endFilePosition);
+        commit();
+        truncateFile();
+    }
+    return deleted;
+}
+
+size_t MappedHeapFile::updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) {
+    size_t updated = 0;
+    string record;
+
+    for(long pos = 0; pos + (long)recordSize <= endFilePosition; pos += recordSize) {
+        if(!predicate(string_view(mapping + pos, recordSize)))
+            continue;
+        applyUpdate(update, string_view(mapping + pos, recordSize), record, keySize);
+        memcpy(mapping + pos, record.data(), recordSize);
+        updated++;
+    }
+    return updated;
+}
+
+bool MappedHeapFile::nextBatch(size_t& cursor, RecordBatch& batch) {
+    size_t remaining = cursor < (size_t)endFilePosition ? (endFilePosition - cursor) / recordSize : 0;
+    if(remaining == 0) {
+        batch.count = 0;
+        return false;
+    }
+
+    // nessuna copia: il batch punta direttamente alla mappatura
+    batch.recordSize = recordSize;
+    batch.count = min(remaining, RecordBatch::CAPACITY);
+    batch.data = mapping + cursor;
+    cursor += batch.count * recordSize;
+    return true;
+}
+
+vector<Morsel> MappedHeapFile::morsels() { return splitRecords(endFilePosition, recordSize); }
+
+bool MappedHeapFile::readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) {
+    cursor = max(cursor, morsel.begin);
+    size_t end = min(morsel.end, (size_t)endFilePosition);
+    size_t remaining = cursor < end ? (end - cursor) / recordSize : 0;
+    if(remaining == 0) {
+        batch.count = 0;
+        return false;
+    }
+
+    batch.recordSize = recordSize;
+    batch.count = min(remaining, RecordBatch::CAPACITY);
+    batch.data = mapping + cursor;
+    cursor += batch.count * recordSize;
+    return true;
+}
+
+void MappedHeapFile::sync() {
+    if(mapping != nullptr && msync(mapping, capacity, MS_SYNC) != 0)
+        throw runtime_error("Failed to sync file: " + filename());
+}
+
+optional<string_view> MappedHeapFile::viewData(string_view key) const {
+    long pos = searchPosition(key);
+    if(pos == -1)
+        return nullopt;
+    return string_view(mapping + pos, recordSize);
+}
+
+string_view MappedHeapFile::recordAt(size_t i) const {
+    return string_view(mapping + i * recordSize, recordSize);
+}
+
+size_t MappedHeapFile::size() const {
+    return endFilePosition / recordSize;
+}
+
+long MappedHeapFile::searchPosition(string_view key) const {
+    if(key.length() != keySize)
+        throw invalid_argument("The key is not valid");
+
+    for(long pos = 0; pos + (long)recordSize <= endFilePosition; pos += recordSize) {
+        if(memcmp(mapping + pos, key.data(), keySize) == 0)
+            return pos;
+    }
+
+    return -1;
+}
+
+void MappedHeapFile::remap(size_t newCapacity) {
+    if(newCapacity > capacity && ftruncate(fd, newCapacity) != 0)
+        throw runtime_error("Failed to resize file: " + filename());
+
+    if(newCapacity == 0) {
+        if(mapping != nullptr)
+            munmap(mapping, capacity);
+        mapping = nullptr;
+    } else if(mapping == nullptr) {
+        void* result = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(result == MAP_FAILED)
+            throw runtime_error("Failed to map file: " + filename());
+        mapping = (char*)result;
+    } else if(newCapacity != capacity) {
+        void* result = mremap(mapping, capacity, newCapacity, MREMAP_MAYMOVE);
+        if(result == MAP_FAILED)
+            throw runtime_error("Failed to remap file: " + filename());
+        mapping = (char*)result;
+    }
+
+    // la mappatura è già cambiata: la capacità si aggiorna anche se il file non si accorcia, munmap deve usarla
+    bool shrinking = newCapacity < capacity;
+    capacity = newCapacity;
+
+    // il file si accorcia solo dopo la mappatura, per non lasciare pagine mappate oltre la fine
+    if(shrinking && ftruncate(fd, newCapacity) != 0)
+        throw runtime_error("Failed to resize file: " + filename());
+}
+
+void MappedHeapFile::truncateFile() {
+    remap(endFilePosition);
+}
\ No newline at end of file
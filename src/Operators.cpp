@@ -0,0 +1,366 @@
+#include <climits>
+#include <cstring>
+#include <typeinfo>
+
+#include "Operators.hpp"
+#include "ColumnEncoding.hpp"
+
+vector<Column> columnsOf(const Relation& rel, const string& table) {
+    vector<Column> result;
+    const CompiledSchema& schema = rel.compiled();
+    vector<Field> fields = rel.getFields();
+
+    for(size_t i = 0; i < fields.size(); i++)
+        result.push_back(Column{table, fields[i], schema.handleAt(i).offset});
+
+    return result;
+}
+
+size_t columnIndex(const vector<Column>& columns, string_view table, string_view name) {
+    optional<size_t> result;
+
+    for(size_t i = 0; i < columns.size(); i++) {
+        if(columns[i].field.getName() != name || (!table.empty() && columns[i].table != table))
+            continue;
+        if(result.has_value())
+            throw invalid_argument("Column " + string(name) + " is ambiguous");
+        result = i;
+    }
+
+    if(!result.has_value())
+        throw invalid_argument("Column " + string(name) + " does not exist");
+    return result.value();
+}
+
+size_t rowSize(const vector<Column>& columns) {
+    size_t result = 0;
+    for(const Column& c : columns)
+        result = max(result, c.offset + c.field.size());
+    return result;
+}
+
+bool Condition::matches(string_view row) const {
+    int cmp = column.field.getDomain()->compare(row.substr(column.offset, column.field.size()), value);
+
+    switch (op) {
+        case CompareOp::Equal:        return cmp == 0;
+        case CompareOp::NotEqual:     return cmp != 0;
+        case CompareOp::Less:         return cmp < 0;
+        case CompareOp::LessEqual:    return cmp <= 0;
+        case CompareOp::Greater:      return cmp > 0;
+        case CompareOp::GreaterEqual: return cmp >= 0;
+    }
+    return false;
+}
+
+void Condition::bind() {
+    if(parameter != nullptr)
+        value = column.field.getDomain()->parse(*parameter);
+}
+
+// MorselQueue
+
+MorselQueue::MorselQueue(Table& table): morsels(table.morsels()), position(0) {}
+
+optional<Morsel> MorselQueue::take() {
+    size_t i = position++;
+    if(i >= morsels.size())
+        return nullopt;
+    return morsels[i];
+}
+
+size_t MorselQueue::size() const { return morsels.size(); }
+
+// TableScan
+
+TableScan::TableScan(Table& table, const string& alias, vector<Condition> conditions, shared_ptr<MorselQueue> morsels, ColumnRanges needed)
+: table(table), cols(columnsOf(*table.getRelation(), alias)), conditions(move(conditions)), needed(move(needed)), morsels(move(morsels)), cursor(0), position(0) {}
+
+void TableScan::open() {
+    for(Condition& condition : conditions)
+        condition.bind();
+    buildFilters();
+
+    morsel.reset();
+    cursor = 0;
+    position = 0;
+    batch.count = 0;
+    selection.clear();
+}
+
+optional<string_view> TableScan::next() {
+    if(position >= selection.size() && !nextBatch())
+        return nullopt;
+
+    return batch[selection[position++]];
+}
+
+void TableScan::close() {
+    selection.clear();
+    batch.count = 0;
+}
+
+const vector<Column>& TableScan::columns() const { return cols; }
+
+optional<size_t> TableScan::estimatedRows() const { return table.size(); }
+
+void TableScan::buildFilters() {
+    filters.clear();
+    for(const Condition& condition : conditions) {
+        IntegerKind kind = orderKind(*condition.column.field.getDomain());
+        if(kind == IntegerKind::None || condition.op == CompareOp::NotEqual)
+            continue;
+
+        int64_t value = orderKey(kind, condition.value);
+        // con i prefissi un valore minore può avere lo stesso intero: gli estremi restano inclusi
+        bool exclusive = kind != IntegerKind::Prefix;
+        IntegerFilter filter{condition.column.offset, INT64_MIN, INT64_MAX};
+        switch (condition.op) {
+            case CompareOp::Equal:        filter.low = filter.high = value; break;
+            case CompareOp::Less:         filter.high = value == INT64_MIN || !exclusive ? value : value - 1; break;
+            case CompareOp::LessEqual:    filter.high = value; break;
+            case CompareOp::Greater:      filter.low = value == INT64_MAX || !exclusive ? value : value + 1; break;
+            case CompareOp::GreaterEqual: filter.low = value; break;
+            default: break;
+        }
+        // gli estremi esclusi restano nel filtro: sono le condizioni a scartarli
+        filters.push_back(filter);
+    }
+}
+
+bool TableScan::readBatch() {
+    bool whole = needed.empty() && filters.empty();
+    if(morsels == nullptr)
+        return whole ? table.nextBatch(cursor, batch) : table.nextColumns(cursor, batch, needed, filters);
+
+    while(!morsel.has_value() || !(whole ? table.readMorsel(morsel.value(), cursor, batch)
+                                         : table.readMorselColumns(morsel.value(), cursor, batch, needed, filters))) {
+        morsel = morsels->take();
+        cursor = 0;
+        if(!morsel.has_value())
+            return false;
+    }
+    return true;
+}
+
+bool TableScan::nextBatch() {
+    while(readBatch()) {
+        position = 0;
+
+        if(conditions.empty()) {
+            selection.resize(batch.count);
+            for(size_t i = 0; i < batch.count; i++)
+                selection[i] = i;
+        } else {
+            filter(conditions[0], nullptr, selection);
+            for(size_t i = 1; i < conditions.size() && !selection.empty(); i++) {
+                filter(conditions[i], &selection, scratch);
+                selection.swap(scratch);
+            }
+        }
+
+        if(!selection.empty())
+            return true;
+    }
+
+    selection.clear();
+    return false;
+}
+
+void TableScan::filter(const Condition& condition, const SelectionVector* input, SelectionVector& output) const {
+    const Domain& domain = *condition.column.field.getDomain();
+    size_t offset = condition.column.offset;
+    CompareOp op = condition.op;
+
+    if(typeid(domain) == typeid(IntegerDomain) && op != CompareOp::NotEqual) {
+        int value;
+        memcpy(&value, condition.value.data(), sizeof(int));
+
+        int low = INT_MIN, high = INT_MAX;
+        switch (op) {
+            case CompareOp::Equal:        low = high = value; break;
+            case CompareOp::Less:         high = value - 1; break;
+            case CompareOp::LessEqual:    high = value; break;
+            case CompareOp::Greater:      low = value + 1; break;
+            case CompareOp::GreaterEqual: low = value; break;
+            default: break;
+        }
+
+        // x < INT_MIN e x > INT_MAX non sono mai veri
+        if((op == CompareOp::Less && value == INT_MIN) || (op == CompareOp::Greater && value == INT_MAX)) {
+            output.clear();
+            return;
+        }
+
+        selectIntRange(batch, offset, low, high, input, output);
+        return;
+    }
+
+    // per questi domini l'ordine è quello di memcmp
+    bool bytesComparable = typeid(domain) == typeid(StringDomain) || typeid(domain) == typeid(EnumDomain)
+        || typeid(domain) == typeid(BigIntDomain) || typeid(domain) == typeid(DoubleDomain) || typeid(domain) == typeid(DateDomain)
+        || typeid(domain) == typeid(TimestampDomain) || typeid(domain) == typeid(DecimalDomain);
+
+    if(bytesComparable && (op == CompareOp::Equal || op == CompareOp::LessEqual || op == CompareOp::GreaterEqual)) {
+        string lowest(condition.value.length(), '\0'), highest(condition.value.length(), '\xFF');
+
+        if(op == CompareOp::Equal)
+            selectBytesEqual(batch, offset, condition.value, input, output);
+        else if(op == CompareOp::LessEqual)
+            selectBytesRange(batch, offset, lowest, condition.value, input, output);
+        else
+            selectBytesRange(batch, offset, condition.value, highest, input, output);
+        return;
+    }
+
+    output.clear();
+    size_t n = input != nullptr ? input->size() : batch.count;
+    for(size_t i = 0; i < n; i++) {
+        uint32_t record = input != nullptr ? (*input)[i] : i;
+        if(condition.matches(batch[record]))
+            output.push_back(record);
+    }
+}
+
+// KeyLookup
+
+KeyLookup::KeyLookup(Table& table, const string& alias, string key)
+: table(table), key(move(key)), cols(columnsOf(*table.getRelation(), alias)), done(false) {}
+
+KeyLookup::KeyLookup(Table& table, const string& alias, vector<Condition> keyConditions)
+: table(table), keyConditions(move(keyConditions)), cols(columnsOf(*table.getRelation(), alias)), done(false) {}
+
+void KeyLookup::open() {
+    if(!keyConditions.empty()) {
+        key.clear();
+        for(Condition& condition : keyConditions) {
+            condition.bind();
+            key += condition.value;
+        }
+    }
+    done = false;
+}
+
+optional<string_view> KeyLookup::next() {
+    if(done)
+        return nullopt;
+    done = true;
+
+    auto record = table.getRecord(key);
+    if(!record.has_value())
+        return nullopt;
+
+    row = record.value().get().getData();
+    return row;
+}
+
+void KeyLookup::close() { done = true; }
+
+const vector<Column>& KeyLookup::columns() const { return cols; }
+
+optional<size_t> KeyLookup::estimatedRows() const { return 1; }
+
+// Filter
+
+Filter::Filter(OperatorPtr child, vector<Condition> conditions)
+: child(move(child)), conditions(move(conditions)) {}
+
+void Filter::open() {
+    for(Condition& condition : conditions)
+        condition.bind();
+    child->open();
+}
+
+optional<string_view> Filter::next() {
+    while(auto row = child->next()) {
+        bool ok = true;
+        for(const Condition& condition : conditions) {
+            if(!condition.matches(row.value())) {
+                ok = false;
+                break;
+            }
+        }
+        if(ok)
+            return row;
+    }
+    return nullopt;
+}
+
+void Filter::close() { child->close(); }
+
+const vector<Column>& Filter::columns() const { return child->columns(); }
+
+optional<size_t> Filter::estimatedRows() const { return child->estimatedRows(); }
+
+// Projection
+
+Projection::Projection(OperatorPtr child, vector<size_t> indexes)
+: child(move(child)), indexes(move(indexes)) {
+    const auto& childColumns = this->child->columns();
+    size_t offset = 0;
+
+    for(size_t i : this->indexes) {
+        const Column& c = childColumns.at(i);
+        cols.push_back(Column{c.table, c.field, offset});
+        offset += c.field.size();
+    }
+}
+
+void Projection::open() { child->open(); }
+
+optional<string_view> Projection::next() {
+    auto input = child->next();
+    if(!input.has_value())
+        return nullopt;
+
+    const auto& childColumns = child->columns();
+    row.clear();
+    for(size_t i : indexes) {
+        const Column& c = childColumns[i];
+        row.append(input.value().substr(c.offset, c.field.size()));
+    }
+    return row;
+}
+
+void Projection::close() { child->close(); }
+
+const vector<Column>& Projection::columns() const { return cols; }
+
+optional<size_t> Projection::estimatedRows() const { return child->estimatedRows(); }
+
+// Limit
+
+Limit::Limit(OperatorPtr child, size_t limit, size_t offset)
+: child(move(child)), limit(limit), offset(offset), skipped(0), produced(0) {}
+
+void Limit::open() {
+    skipped = 0;
+    produced = 0;
+    child->open();
+}
+
+optional<string_view> Limit::next() {
+    if(produced >= limit)
+        return nullopt;
+
+    for(; skipped < offset; skipped++) {
+        if(!child->next().has_value())
+            return nullopt;
+    }
+
+    auto row = child->next();
+    if(row.has_value())
+        produced++;
+    return row;
+}
+
+void Limit::close() { child->close(); }
+
+const vector<Column>& Limit::columns() const { return child->columns(); }
+
+optional<size_t> Limit::estimatedRows() const {
+    auto rows = child->estimatedRows();
+    if(!rows.has_value())
+        return limit;
+    return rows.value() > offset ? min(rows.value() - offset, limit) : 0;
+}
\ No newline at end of file
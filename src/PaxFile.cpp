@@ -0,0 +1,550 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "PaxFile.hpp"
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t PAX_MAGIC = 0x31584150; // "PAX1"
+
+// magic, dimensione della chiave, dimensione del record, numero di campi e numero di record
+constexpr size_t HEADER_SIZE = 4 * sizeof(uint32_t) + sizeof(uint64_t);
+// dopo l'intestazione, per ogni campo la dimensione (uint32_t) e il tipo di intero (uint8_t)
+constexpr size_t FIELD_HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t);
+
+}
+
+PaxFile::PaxFile(string fileName, size_t keySize, vector<size_t> fieldSizes, vector<IntegerKind> fieldKinds, BufferPool& pool)
+: File(fileName, pool), keySize(keySize), recordSize(0), fieldSizes(move(fieldSizes)), fieldKinds(move(fieldKinds)), blockHeaderSize(0), recordCount(0) {
+    for(size_t size : this->fieldSizes) {
+        fieldOffsets.push_back(recordSize);
+        recordSize += size;
+    }
+    if(keySize == 0 || keySize > recordSize)
+        throw invalid_argument("The key must be a non empty prefix of the record");
+    if(HEADER_SIZE + this->fieldSizes.size() * FIELD_HEADER_SIZE > BufferPool::PAGE_SIZE)
+        throw invalid_argument("Too many fields for a PAX file");
+
+    if(this->fieldKinds.empty())
+        this->fieldKinds.assign(this->fieldSizes.size(), IntegerKind::None);
+    if(this->fieldKinds.size() != this->fieldSizes.size())
+        throw invalid_argument("Every field of a PAX file needs its kind");
+    for(size_t f = 0; f < this->fieldSizes.size(); f++) {
+        if(this->fieldKinds[f] == IntegerKind::None)
+            continue;
+        if(integerSize(this->fieldKinds[f]) != this->fieldSizes[f])
+            throw invalid_argument("The size of an integer field of a PAX file does not match its kind");
+        // i blocchi hanno un'intestazione solo se c'è qualcosa da codificare
+        blockHeaderSize = this->fieldSizes.size() * sizeof(uint32_t);
+    }
+
+    blockCapacity = (BLOCK_SIZE - blockHeaderSize) / recordSize;
+    if(blockCapacity == 0)
+        throw invalid_argument("Records are too big to be stored in a PAX block");
+
+    file.seekg(0, ios::end);
+    if(file.tellg() <= 0)
+        saveHeader();
+    else loadHeader();
+}
+
+PaxFile::~PaxFile() {
+    saveHeader();
+    flush();
+    file.close();
+    truncateFile();
+}
+
+class PaxIterator : public iterator<input_iterator_tag, string> {
+    PaxFile& paxFile;
+    size_t pos;
+public:
+    PaxIterator(PaxFile& file, size_t pos = 0)
+        : paxFile(file), pos(pos) {}
+
+    iterator& operator++() {
+        pos++;
+        return *this;
+    }
+
+    string operator*() const {
+        return paxFile.getByRid(pos);
+    }
+
+    bool operator==(const PaxIterator& other) const {
+        return pos == other.pos;
+    }
+
+    bool operator!=(const PaxIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+iterator<input_iterator_tag,string> PaxFile::begin() {
+    return PaxIterator(*this);
+}
+
+iterator<input_iterator_tag,string> PaxFile::end() {
+    return PaxIterator(*this, recordCount);
+}
+
+void PaxFile::pushData(string_view data) {
+    if(data.length() % recordSize != 0 || data.length() == 0)
+        throw runtime_error("Data length is not a multiple of record size");
+
+    size_t first = recordCount;
+    writeRecords(recordCount, data);
+    recordCount += data.length() / recordSize;
+    sealBlocks(first, recordCount);
+    saveHeader();
+    commit();
+}
+
+optional<string> PaxFile::deleteData(string_view key) {
+    auto pos = searchRecord(key);
+    if(!pos.has_value())
+        return nullopt;
+
+    string deleted = getByRid(pos.value());
+    size_t last = recordCount - 1;
+    if(pos.value() != last)
+        writeRecords(pos.value(), getByRid(last));
+
+    recordCount--;
+    // il blocco dell'ultimo record resta codificato anche se non è più pieno
+    sealBlocks(pos.value(), pos.value() + 1);
+    saveHeader();
+    commit();
+    return deleted;
+}
+
+optional<string> PaxFile::getData(string_view key) {
+    auto pos = searchRecord(key);
+    if(!pos.has_value())
+        return nullopt;
+    return getByRid(pos.value());
+}
+
+optional<RecordId> PaxFile::findRecord(string_view key) {
+    auto pos = searchRecord(key);
+    if(!pos.has_value())
+        return nullopt;
+    return pos.value();
+}
+
+string PaxFile::getByRid(RecordId rid) {
+    if(rid >= recordCount)
+        throw out_of_range("The record does not exist");
+
+    RecordBatch batch;
+    readRecords(rid, rid + 1, batch, {});
+    return string(batch[0]);
+}
+
+void PaxFile::updateInPlace(RecordId rid, string_view data, size_t offset) {
+    if(rid >= recordCount)
+        throw out_of_range("The record does not exist");
+    checkUpdate(data, offset, keySize, recordSize);
+
+    unsealBlocks(rid, rid + 1);
+    // i byte possono toccare più campi: ognuno si scrive nella sua minipagina
+    for(size_t f = 0; f < fieldSizes.size(); f++) {
+        size_t begin = max(offset, fieldOffsets[f]);
+        size_t end = min(offset + data.length(), fieldOffsets[f] + fieldSizes[f]);
+        if(begin < end)
+            writeAt(fieldPosition(f, rid) + begin - fieldOffsets[f], data.data() + begin - offset, end - begin);
+    }
+    sealBlocks(rid, rid + 1);
+    commit();
+}
+
+size_t PaxFile::deleteWhere(const function<bool(string_view)>& predicate) {
+    RecordBatch batch;
+    size_t cursor = 0;
+    size_t position = 0;
+    size_t deleted = 0;
+    string kept;
+
+    // come in HeapFile i record tenuti si spostano indietro, prima del punto in cui si legge
+    while(nextBatch(cursor, batch)) {
+        size_t read = cursor - batch.count;
+        kept.clear();
+        for(size_t i = 0; i < batch.count; i++) {
+            if(predicate(batch[i]))
+                deleted++;
+            else kept.append(batch[i]);
+        }
+
+        if(!kept.empty() && (position != read || kept.size() != batch.count * recordSize))
+            writeRecords(position, kept);
+        position += kept.size() / recordSize;
+    }
+
+    if(deleted > 0) {
+        recordCount = position;
+        sealBlocks(0, recordCount);
+        saveHeader();
+        logEnd(fileEnd());
+        commit();
+        flush();
+        truncateFile();
+    }
+    return deleted;
+}
+
+size_t PaxFile::updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) {
+    RecordBatch batch;
+    size_t cursor = 0;
+    size_t updated = 0;
+    string record;
+
+    while(nextBatch(cursor, batch)) {
+        size_t read = cursor - batch.count;
+        for(size_t i = 0; i < batch.count; i++) {
+            if(!predicate(batch[i]))
+                continue;
+            applyUpdate(update, batch[i], record, keySize);
+            writeRecords(read + i, record);
+            updated++;
+        }
+    }
+
+    if(updated > 0)
+        sealBlocks(0, recordCount);
+    commit();
+    return updated;
+}
+
+bool PaxFile::nextBatch(size_t& cursor, RecordBatch& batch) {
+    return nextColumns(cursor, batch, {}, {});
+}
+
+bool PaxFile::nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) {
+    // il cursore è la posizione del prossimo record
+    if(cursor >= recordCount) {
+        batch.count = 0;
+        return false;
+    }
+
+    size_t blockEnd = (cursor / blockCapacity + 1) * blockCapacity;
+    size_t end = min({(size_t)recordCount, blockEnd, cursor + RecordBatch::CAPACITY});
+    readRecords(cursor, end, batch, columns, filters);
+    cursor = end;
+    return true;
+}
+
+size_t PaxFile::size() const { return recordCount; }
+
+vector<Morsel> PaxFile::morsels() {
+    size_t blocks = max<size_t>(1, MORSEL_SIZE / BLOCK_SIZE);
+    vector<Morsel> result;
+    for(size_t begin = 0; begin < recordCount; begin += blocks * blockCapacity)
+        result.push_back(Morsel{begin, min<size_t>(recordCount, begin + blocks * blockCapacity)});
+    return result;
+}
+
+bool PaxFile::readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) {
+    return readMorselColumns(morsel, cursor, batch, {}, {});
+}
+
+bool PaxFile::readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) {
+    size_t first = morsel.begin + cursor;
+    size_t last = min<size_t>(morsel.end, recordCount);
+    if(first >= last) {
+        batch.count = 0;
+        return false;
+    }
+
+    size_t blockEnd = (first / blockCapacity + 1) * blockCapacity;
+    size_t end = min({last, blockEnd, first + RecordBatch::CAPACITY});
+    readRecords(first, end, batch, columns, filters);
+    cursor = end - morsel.begin;
+    return true;
+}
+
+size_t PaxFile::fieldPosition(size_t field, size_t record) const {
+    return minipagePosition(field, record / blockCapacity) + (record % blockCapacity) * fieldSizes[field];
+}
+
+size_t PaxFile::minipagePosition(size_t field, size_t block) const {
+    return BufferPool::PAGE_SIZE + block * BLOCK_SIZE + blockHeaderSize + blockCapacity * fieldOffsets[field];
+}
+
+void PaxFile::readRecords(size_t first, size_t end, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) {
+    size_t block = first / blockCapacity;
+    size_t slot = first % blockCapacity;
+    size_t count = end - first;
+    vector<uint32_t> lengths = readBlockHeader(block);
+
+    // prima si applicano i filtri, così dei record esclusi non si copia niente
+    SelectionVector selection, matched, common;
+    bool filtered = false;
+    for(const IntegerFilter& filter : filters) {
+        size_t f = 0;
+        while(f < fieldSizes.size() && (fieldOffsets[f] != filter.offset || fieldKinds[f] == IntegerKind::None))
+            f++;
+        if(f == fieldSizes.size())
+            continue;
+
+        matched.clear();
+        selectField(f, block, slot, count, lengths[f], filter, matched);
+        if(filtered) {
+            common.clear();
+            set_intersection(selection.begin(), selection.end(), matched.begin(), matched.end(), back_inserter(common));
+            selection.swap(common);
+        } else selection.swap(matched);
+        filtered = true;
+        if(selection.empty())
+            break;
+    }
+
+    size_t produced = filtered ? selection.size() : count;
+    char* out = batch.prepare(recordSize, produced);
+    if(produced == 0)
+        return;
+    string values;
+
+    for(size_t f = 0; f < fieldSizes.size(); f++) {
+        size_t size = fieldSizes[f];
+        bool needed = columns.empty();
+        for(size_t c = 0; c < columns.size() && !needed; c++)
+            needed = columns[c].first < fieldOffsets[f] + size && fieldOffsets[f] < columns[c].first + columns[c].second;
+        if(!needed)
+            continue;
+
+        // la minipagina è contigua: una lettura per campo e poi i valori vanno nelle righe
+        readField(f, block, slot, count, lengths[f], values);
+        for(size_t i = 0; i < produced; i++) {
+            size_t value = filtered ? selection[i] : i;
+            memcpy(out + i * recordSize + fieldOffsets[f], values.data() + value * size, size);
+        }
+    }
+}
+
+void PaxFile::readField(size_t field, size_t block, size_t first, size_t count, uint32_t length, string& values) {
+    size_t size = fieldSizes[field];
+    values.resize(count * size);
+    if(length == 0) {
+        readAt(minipagePosition(field, block) + first * size, values.data(), values.size());
+        return;
+    }
+
+    vector<int64_t> decoded(count);
+    forEachFrame(field, block, first, count, [&decoded](string_view frame, size_t from, size_t n, size_t done) {
+        decodeIntegers(frame, from, n, decoded.data() + done);
+    });
+    for(size_t i = 0; i < count; i++)
+        storeInteger(fieldKinds[field], decoded[i], values.data() + i * size);
+}
+
+void PaxFile::selectField(size_t field, size_t block, size_t first, size_t count, uint32_t length, const IntegerFilter& filter, SelectionVector& output) {
+    if(length > 0) {
+        // sui frame codificati il confronto non ricostruisce i valori
+        forEachFrame(field, block, first, count, [&filter, &output](string_view frame, size_t from, size_t n, size_t done) {
+            selectIntegers(frame, from, n, filter.low, filter.high, done, output);
+        });
+        return;
+    }
+
+    string values;
+    readField(field, block, first, count, 0, values);
+    for(size_t i = 0; i < count; i++) {
+        int64_t value = loadInteger(fieldKinds[field], values.data() + i * fieldSizes[field]);
+        if(value >= filter.low && value <= filter.high)
+            output.push_back(i);
+    }
+}
+
+void PaxFile::forEachFrame(size_t field, size_t block, size_t first, size_t count, const function<void(string_view, size_t, size_t, size_t)>& visit) {
+    // la minipagina codificata inizia con la fine di ogni frame, poi ci sono i frame
+    size_t frames = (blockCapacity + FRAME_VALUES - 1) / FRAME_VALUES;
+    vector<uint32_t> ends(frames);
+    size_t start = minipagePosition(field, block);
+    readAt(start, (char*)ends.data(), frames * sizeof(uint32_t));
+    start += frames * sizeof(uint32_t);
+
+    string frame;
+    for(size_t done = 0; done < count;) {
+        size_t i = (first + done) / FRAME_VALUES;
+        size_t from = (first + done) % FRAME_VALUES;
+        size_t n = min(count - done, FRAME_VALUES - from);
+        size_t begin = i == 0 ? 0 : ends[i - 1];
+
+        frame.resize(ends[i] - begin);
+        readAt(start + begin, frame.data(), frame.size());
+        visit(frame, from, n, done);
+        done += n;
+    }
+}
+
+void PaxFile::writeRecords(size_t first, string_view data) {
+    size_t count = data.length() / recordSize;
+    string values;
+    unsealBlocks(first, first + count);
+
+    for(size_t i = 0; i < count;) {
+        size_t record = first + i;
+        size_t taken = min(count - i, blockCapacity - record % blockCapacity);
+
+        for(size_t f = 0; f < fieldSizes.size(); f++) {
+            size_t size = fieldSizes[f];
+            values.resize(taken * size);
+            for(size_t j = 0; j < taken; j++)
+                memcpy(values.data() + j * size, data.data() + (i + j) * recordSize + fieldOffsets[f], size);
+            writeAt(fieldPosition(f, record), values.data(), values.size());
+        }
+        i += taken;
+    }
+}
+
+vector<uint32_t> PaxFile::readBlockHeader(size_t block) {
+    vector<uint32_t> lengths(fieldSizes.size(), 0);
+    if(blockHeaderSize > 0)
+        readAt(BufferPool::PAGE_SIZE + block * BLOCK_SIZE, (char*)lengths.data(), blockHeaderSize);
+    return lengths;
+}
+
+void PaxFile::writeBlockHeader(size_t block, const vector<uint32_t>& lengths) {
+    writeAt(BufferPool::PAGE_SIZE + block * BLOCK_SIZE, (const char*)lengths.data(), blockHeaderSize);
+}
+
+void PaxFile::sealBlocks(size_t first, size_t end) {
+    if(blockHeaderSize == 0)
+        return;
+
+    vector<int64_t> decoded(blockCapacity);
+    string values, encoded;
+    for(size_t block = first / blockCapacity; block * blockCapacity < end; block++) {
+        // solo i blocchi pieni: quelli che crescono ancora si dovrebbero decodificare a ogni inserimento
+        if((block + 1) * blockCapacity > recordCount)
+            break;
+
+        vector<uint32_t> lengths = readBlockHeader(block);
+        bool changed = false;
+        for(size_t f = 0; f < fieldSizes.size(); f++) {
+            if(fieldKinds[f] == IntegerKind::None || lengths[f] > 0)
+                continue;
+
+            readField(f, block, 0, blockCapacity, 0, values);
+            for(size_t i = 0; i < blockCapacity; i++)
+                decoded[i] = loadInteger(fieldKinds[f], values.data() + i * fieldSizes[f]);
+
+            // ogni frame sceglie la sua codifica
+            size_t frames = (blockCapacity + FRAME_VALUES - 1) / FRAME_VALUES;
+            vector<uint32_t> ends;
+            encoded.assign(frames * sizeof(uint32_t), '\0');
+            for(size_t i = 0; i < blockCapacity; i += FRAME_VALUES) {
+                encoded.append(encodeIntegers(decoded.data() + i, min(FRAME_VALUES, blockCapacity - i)));
+                ends.push_back(encoded.size() - frames * sizeof(uint32_t));
+            }
+            if(encoded.size() >= values.size())
+                continue;
+
+            memcpy(encoded.data(), ends.data(), frames * sizeof(uint32_t));
+            writeAt(minipagePosition(f, block), encoded.data(), encoded.size());
+            lengths[f] = encoded.size();
+            changed = true;
+        }
+        if(changed)
+            writeBlockHeader(block, lengths);
+    }
+}
+
+void PaxFile::unsealBlocks(size_t first, size_t end) {
+    if(blockHeaderSize == 0)
+        return;
+
+    string values;
+    for(size_t block = first / blockCapacity; block * blockCapacity < end; block++) {
+        // anche un blocco oltre l'ultimo record può essere rimasto codificato dopo le cancellazioni
+        vector<uint32_t> lengths = readBlockHeader(block);
+        bool changed = false;
+        for(size_t f = 0; f < fieldSizes.size(); f++) {
+            if(lengths[f] == 0)
+                continue;
+            readField(f, block, 0, blockCapacity, lengths[f], values);
+            writeAt(minipagePosition(f, block), values.data(), values.size());
+            lengths[f] = 0;
+            changed = true;
+        }
+        if(changed)
+            writeBlockHeader(block, lengths);
+    }
+}
+
+optional<size_t> PaxFile::searchRecord(string_view key) {
+    if(key.length() != keySize)
+        throw invalid_argument("The key is not valid");
+
+    // si leggono solo le minipagine dei campi della chiave
+    ColumnRanges columns{{0, keySize}};
+    RecordBatch batch;
+    size_t cursor = 0;
+    while(nextColumns(cursor, batch, columns, {})) {
+        for(size_t i = 0; i < batch.count; i++) {
+            if(memcmp(batch[i].data(), key.data(), keySize) == 0)
+                return cursor - batch.count + i;
+        }
+    }
+    return nullopt;
+}
+
+void PaxFile::loadHeader() {
+    char header[BufferPool::PAGE_SIZE];
+    readAt(0, header, BufferPool::PAGE_SIZE);
+
+    uint32_t magic, storedKeySize, storedRecordSize, fieldCount;
+    memcpy(&magic, header, sizeof(uint32_t));
+    memcpy(&storedKeySize, header + 4, sizeof(uint32_t));
+    memcpy(&storedRecordSize, header + 8, sizeof(uint32_t));
+    memcpy(&fieldCount, header + 12, sizeof(uint32_t));
+    memcpy(&recordCount, header + 16, sizeof(uint64_t));
+
+    if(magic != PAX_MAGIC)
+        throw runtime_error("Not a PAX file: " + filename());
+    bool sameLayout = storedKeySize == keySize && storedRecordSize == recordSize && fieldCount == fieldSizes.size();
+    for(size_t f = 0; f < fieldSizes.size() && sameLayout; f++) {
+        uint32_t size;
+        memcpy(&size, header + HEADER_SIZE + f * FIELD_HEADER_SIZE, sizeof(uint32_t));
+        sameLayout = size == fieldSizes[f] && header[HEADER_SIZE + f * FIELD_HEADER_SIZE + sizeof(uint32_t)] == (char)fieldKinds[f];
+    }
+    if(!sameLayout)
+        throw runtime_error("The PAX file has a different record layout: " + filename());
+}
+
+void PaxFile::saveHeader() {
+    string header(HEADER_SIZE + fieldSizes.size() * FIELD_HEADER_SIZE, '\0');
+    uint32_t values[] = {PAX_MAGIC, (uint32_t)keySize, (uint32_t)recordSize, (uint32_t)fieldSizes.size()};
+    memcpy(header.data(), values, sizeof(values));
+    memcpy(header.data() + 16, &recordCount, sizeof(uint64_t));
+    for(size_t f = 0; f < fieldSizes.size(); f++) {
+        uint32_t size = fieldSizes[f];
+        memcpy(header.data() + HEADER_SIZE + f * FIELD_HEADER_SIZE, &size, sizeof(uint32_t));
+        header[HEADER_SIZE + f * FIELD_HEADER_SIZE + sizeof(uint32_t)] = (char)fieldKinds[f];
+    }
+    writeAt(0, header.data(), header.size());
+}
+
+size_t PaxFile::fileEnd() const {
+    size_t blocks = (recordCount + blockCapacity - 1) / blockCapacity;
+    return BufferPool::PAGE_SIZE + blocks * BLOCK_SIZE;
+}
+
+void PaxFile::truncateFile() {
+    int fd = open(filename().c_str(), O_RDWR);
+    if(fd == -1)
+        throw runtime_error("Failed to open file descriptor: " + filename());
+
+    // l'ultimo blocco resta intero: le minipagine dei campi sono distribuite su tutto il blocco
+    if(ftruncate(fd, fileEnd()) != 0) {
+        close(fd);
+        throw runtime_error("Failed to truncate file: " + filename());
+    }
+
+    close(fd);
+}
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PREDICATES_X86
+#endif
+
+#include "Predicates.hpp"
+
+using namespace std;
+
+namespace {
+
+inline int loadInt(const RecordBatch& batch, size_t i, size_t offset) {
+    int value;
+    memcpy(&value, batch.data + i * batch.recordSize + offset, sizeof(int));
+    return value;
+}
+
+inline size_t inputSize(const RecordBatch& batch, const SelectionVector* input) {
+    return input != nullptr ? input->size() : batch.count;
+}
+
+inline uint32_t inputAt(const SelectionVector* input, size_t i) {
+    return input != nullptr ? (*input)[i] : i;
+}
+
+void intRangeScalar(const RecordBatch& batch, size_t offset, int low, int high, const SelectionVector* input, SelectionVector& output, size_t from) {
+    size_t n = inputSize(batch, input);
+    for(size_t i = from; i < n; i++) {
+        uint32_t record = inputAt(input, i);
+        int value = loadInt(batch, record, offset);
+        if(value >= low && value <= high)
+            output.push_back(record);
+    }
+}
+
+#ifdef PREDICATES_X86
+
+bool hasAvx2() {
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+
+// vero se i record dall'i-esimo in poi sono count record consecutivi del batch, con campi contigui
+inline bool contiguous(const RecordBatch& batch, const SelectionVector* input, size_t i, size_t count) {
+    return batch.recordSize == sizeof(int) && (input == nullptr || (*input)[i + count - 1] - (*input)[i] == count - 1);
+}
+
+// aggiunge all'output i record corrispondenti ai bit a 1 della maschera
+inline void appendMask(unsigned mask, size_t base, const SelectionVector* input, SelectionVector& output) {
+    while(mask != 0) {
+        unsigned bit = __builtin_ctz(mask);
+        output.push_back(inputAt(input, base + bit));
+        mask &= mask - 1;
+    }
+}
+
+__attribute__((target("avx2")))
+void intRangeAvx2(const RecordBatch& batch, size_t offset, int low, int high, const SelectionVector* input, SelectionVector& output) {
+    size_t n = inputSize(batch, input);
+    const __m256i lowVec = _mm256_set1_epi32(low);
+    const __m256i highVec = _mm256_set1_epi32(high);
+    const __m256i stride = _mm256_set1_epi32(batch.recordSize);
+    const __m256i offsetVec = _mm256_set1_epi32(offset);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i values;
+        if(contiguous(batch, input, i, 8)) {
+            // una colonna di interi, come quelle di un file PAX: un solo caricamento
+            values = _mm256_loadu_si256((const __m256i*)(batch.data + inputAt(input, i) * sizeof(int)));
+        } else {
+            __m256i records = input != nullptr
+                ? _mm256_loadu_si256((const __m256i*)(input->data() + i))
+                : _mm256_add_epi32(_mm256_set1_epi32(i), lanes);
+            // i campi non sono contigui: si caricano con un gather all'offset di ogni record
+            __m256i positions = _mm256_add_epi32(_mm256_mullo_epi32(records, stride), offsetVec);
+            values = _mm256_i32gather_epi32((const int*)batch.data, positions, 1);
+        }
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(lowVec, values), _mm256_cmpgt_epi32(values, highVec));
+        unsigned mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF;
+        appendMask(mask, i, input, output);
+    }
+
+    intRangeScalar(batch, offset, low, high, input, output, i);
+}
+
+void intRangeSse2(const RecordBatch& batch, size_t offset, int low, int high, const SelectionVector* input, SelectionVector& output) {
+    size_t n = inputSize(batch, input);
+    const __m128i lowVec = _mm_set1_epi32(low);
+    const __m128i highVec = _mm_set1_epi32(high);
+
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128i values = contiguous(batch, input, i, 4)
+            ? _mm_loadu_si128((const __m128i*)(batch.data + inputAt(input, i) * sizeof(int)))
+            : _mm_setr_epi32(
+                loadInt(batch, inputAt(input, i), offset),
+                loadInt(batch, inputAt(input, i + 1), offset),
+                loadInt(batch, inputAt(input, i + 2), offset),
+                loadInt(batch, inputAt(input, i + 3), offset));
+        __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(lowVec, values), _mm_cmpgt_epi32(values, highVec));
+        unsigned mask = ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF;
+        appendMask(mask, i, input, output);
+    }
+
+    intRangeScalar(batch, offset, low, high, input, output, i);
+}
+
+// confronta due parole lette in big endian, così l'ordine dei numeri è quello dei byte
+template<typename T>
+inline int compareWords(const char* a, const char* b) {
+    T x, y;
+    memcpy(&x, a, sizeof(T));
+    memcpy(&y, b, sizeof(T));
+    if(x == y)
+        return 0;
+    if constexpr(sizeof(T) == sizeof(uint64_t))
+        return __builtin_bswap64(x) < __builtin_bswap64(y) ? -1 : 1;
+    else
+        return __builtin_bswap32(x) < __builtin_bswap32(y) ? -1 : 1;
+}
+
+/**
+ * @brief compare at most 16 bytes with two word loads, the chars of a short key do not fill a vector
+ *
+ * The two words overlap when len is not a multiple of their size, so no byte outside of the fields is read.
+ */
+inline int compareShort(const char* a, const char* b, size_t len) {
+    if(len >= sizeof(uint64_t)) {
+        int result = compareWords<uint64_t>(a, b);
+        return result != 0 ? result : compareWords<uint64_t>(a + len - sizeof(uint64_t), b + len - sizeof(uint64_t));
+    }
+    if(len >= sizeof(uint32_t)) {
+        int result = compareWords<uint32_t>(a, b);
+        return result != 0 ? result : compareWords<uint32_t>(a + len - sizeof(uint32_t), b + len - sizeof(uint32_t));
+    }
+    for(size_t i = 0; i < len; i++) {
+        if(a[i] != b[i])
+            return (int)(unsigned char)a[i] - (int)(unsigned char)b[i];
+    }
+    return 0;
+}
+
+inline int compare16(const char* a, const char* b) {
+    __m128i x = _mm_loadu_si128((const __m128i*)a);
+    __m128i y = _mm_loadu_si128((const __m128i*)b);
+    unsigned diff = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xFFFF;
+    if(diff == 0)
+        return 0;
+    size_t j = __builtin_ctz(diff);
+    return (int)(unsigned char)a[j] - (int)(unsigned char)b[j];
+}
+
+__attribute__((target("avx2")))
+int compareBytesAvx2(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        unsigned diff = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if(diff != 0) {
+            size_t j = i + __builtin_ctz(diff);
+            return (int)(unsigned char)a[j] - (int)(unsigned char)b[j];
+        }
+    }
+    if(i + 16 <= len) {
+        int result = compare16(a + i, b + i);
+        if(result != 0)
+            return result;
+        i += 16;
+    }
+    return compareShort(a + i, b + i, len - i);
+}
+
+int compareBytesSse2(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16) {
+        int result = compare16(a + i, b + i);
+        if(result != 0)
+            return result;
+    }
+    return compareShort(a + i, b + i, len - i);
+}
+
+#else
+
+int compareBytesScalar(const char* a, const char* b, size_t len) {
+    return memcmp(a, b, len);
+}
+
+#endif
+
+using CompareBytes = int (*)(const char*, const char*, size_t);
+
+CompareBytes compareBytes() {
+#ifdef PREDICATES_X86
+    return hasAvx2() ? compareBytesAvx2 : compareBytesSse2;
+#else
+    return compareBytesScalar;
+#endif
+}
+
+}
+
+void selectIntEqual(const RecordBatch& batch, size_t offset, int value, const SelectionVector* input, SelectionVector& output) {
+    selectIntRange(batch, offset, value, value, input, output);
+}
+
+void selectIntRange(const RecordBatch& batch, size_t offset, int low, int high, const SelectionVector* input, SelectionVector& output) {
+    if(offset + sizeof(int) > batch.recordSize)
+        throw invalid_argument("The field is outside of the record");
+
+    output.clear();
+    output.reserve(inputSize(batch, input));
+
+#ifdef PREDICATES_X86
+    if(hasAvx2())
+        intRangeAvx2(batch, offset, low, high, input, output);
+    else
+        intRangeSse2(batch, offset, low, high, input, output);
+#else
+    intRangeScalar(batch, offset, low, high, input, output, 0);
+#endif
+}
+
+void selectBytesEqual(const RecordBatch& batch, size_t offset, string_view value, const SelectionVector* input, SelectionVector& output) {
+    selectBytesRange(batch, offset, value, value, input, output);
+}
+
+void selectBytesRange(const RecordBatch& batch, size_t offset, string_view low, string_view high, const SelectionVector* input, SelectionVector& output) {
+    if(low.length() != high.length() || offset + low.length() > batch.recordSize)
+        throw invalid_argument("The field is outside of the record");
+
+    output.clear();
+    output.reserve(inputSize(batch, input));
+
+    CompareBytes compare = compareBytes();
+    size_t len = low.length();
+    bool equality = low == high;
+    size_t n = inputSize(batch, input);
+
+    for(size_t i = 0; i < n; i++) {
+        uint32_t record = inputAt(input, i);
+        const char* field = batch.data + record * batch.recordSize + offset;
+
+        if(equality) {
+            if(compare(field, low.data(), len) == 0)
+                output.push_back(record);
+        } else if(compare(field, low.data(), len) >= 0 && compare(field, high.data(), len) <= 0)
+            output.push_back(record);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "StorageEngine.hpp"
+#include "RecordCache.hpp"
+
+// RecordCache
+
+RecordCache::RecordCache(size_t memoryBudget): shardBudget(memoryBudget / SHARDS) {
+    for(Shard& shard : shards)
+        shard.clockHand = shard.entries.end();
+}
+
+RecordCache& RecordCache::shared() {
+    static RecordCache cache;
+    return cache;
+}
+
+optional<RecordHandle> RecordCache::get(const void* owner, string_view key) {
+    Shard& shard = shardOf(owner, key);
+    lock_guard<mutex> lock(shard.latch);
+
+    auto it = shard.index.find(EntryId{owner, key});
+    if(it == shard.index.end())
+        return nullopt;
+
+    Entry& entry = *it->second;
+    entry.pinCount++;
+    entry.referenced = true;
+    return RecordHandle(*this, shard, it->second);
+}
+
+RecordHandle RecordCache::put(const void* owner, string_view key, Record record) {
+    Shard& shard = shardOf(owner, key);
+    lock_guard<mutex> lock(shard.latch);
+
+    auto it = shard.index.find(EntryId{owner, key});
+    if(it != shard.index.end())
+        drop(shard, it->second);
+
+    size_t bytes = sizeof(Entry) + key.size() + record.getData().size();
+    evict(shard, bytes);
+
+    auto entry = shard.entries.insert(shard.clockHand, Entry{owner, string(key), move(record), bytes, 1, true, true});
+    shard.index.emplace(EntryId{owner, entry->key}, entry);
+    shard.bytes += bytes;
+    return RecordHandle(*this, shard, entry);
+}
+
+void RecordCache::invalidate(const void* owner, string_view key) {
+    Shard& shard = shardOf(owner, key);
+    lock_guard<mutex> lock(shard.latch);
+
+    auto it = shard.index.find(EntryId{owner, key});
+    if(it != shard.index.end())
+        drop(shard, it->second);
+}
+
+void RecordCache::discard(const void* owner) {
+    for(Shard& shard : shards) {
+        lock_guard<mutex> lock(shard.latch);
+
+        for(auto entry = shard.entries.begin(); entry != shard.entries.end();) {
+            auto current = entry++;
+            if(current->owner == owner && current->cached)
+                drop(shard, current);
+        }
+    }
+}
+
+size_t RecordCache::usedBytes() {
+    size_t total = 0;
+    for(Shard& shard : shards) {
+        lock_guard<mutex> lock(shard.latch);
+        total += shard.bytes;
+    }
+    return total;
+}
+
+RecordCache::Shard& RecordCache::shardOf(const void* owner, string_view key) {
+    return shards[EntryIdHash()(EntryId{owner, key}) % SHARDS];
+}
+
+void RecordCache::evict(Shard& shard, size_t needed) {
+    // due giri completi bastano: nel primo si azzerano i bit di riferimento
+    size_t steps = 2 * shard.entries.size();
+    while(shard.bytes + needed > shardBudget && steps-- > 0) {
+        if(shard.clockHand == shard.entries.end())
+            shard.clockHand = shard.entries.begin();
+
+        Entry& entry = *shard.clockHand;
+        if(entry.pinCount > 0) {
+            ++shard.clockHand;
+            continue;
+        }
+        if(entry.referenced) {
+            entry.referenced = false;
+            ++shard.clockHand;
+            continue;
+        }
+        drop(shard, shard.clockHand);
+    }
+}
+
+void RecordCache::drop(Shard& shard, list<Entry>::iterator entry) {
+    if(entry->cached) {
+        shard.index.erase(EntryId{entry->owner, entry->key});
+        entry->cached = false;
+    }
+    if(entry->pinCount == 0)
+        erase(shard, entry);
+}
+
+void RecordCache::erase(Shard& shard, list<Entry>::iterator entry) {
+    shard.bytes -= entry->bytes;
+    if(shard.clockHand == entry)
+        shard.clockHand = shard.entries.erase(entry);
+    else
+        shard.entries.erase(entry);
+}
+
+void RecordCache::unpin(Shard& shard, list<Entry>::iterator entry) {
+    lock_guard<mutex> lock(shard.latch);
+
+    entry->pinCount--;
+    if(entry->pinCount == 0 && !entry->cached)
+        erase(shard, entry);
+}
+
+// RecordHandle
+
+RecordHandle::RecordHandle(RecordCache& cache, RecordCache::Shard& shard, list<RecordCache::Entry>::iterator entry)
+: cache(&cache), shard(&shard), entry(entry), record(&entry->record) {}
+
+RecordHandle::RecordHandle(const Record& record)
+: cache(nullptr), shard(nullptr), record(&record) {}
+
+RecordHandle::~RecordHandle() { release(); }
+
+RecordHandle::RecordHandle(RecordHandle&& other) noexcept
+: cache(other.cache), shard(other.shard), entry(other.entry), record(other.record) {
+    other.cache = nullptr;
+}
+
+RecordHandle& RecordHandle::operator=(RecordHandle&& other) noexcept {
+    if(this != &other) {
+        release();
+        cache = other.cache;
+        shard = other.shard;
+        entry = other.entry;
+        record = other.record;
+        other.cache = nullptr;
+    }
+    return *this;
+}
+
+void RecordHandle::release() {
+    if(cache != nullptr) {
+        cache->unpin(*shard, entry);
+        cache = nullptr;
+    }
+}
\ No newline at end of file
@@ -1,26 +1,199 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
 #include "SQLInterpreter.hpp"
+#include "SQLParser.h"
 #include "sql/SQLStatement.h"
 #include "sql/Table.h"
 
-SQLInterpreter::SQLInterpreter(): db(nullopt) {}
+namespace {
 
-SQLInterpreter::SQLInterpreter(Database& db): db(db) {}
+/**
+ * @brief the text of a constant with a decimal point, without exponent and with all the digits needed to read it back equal
+ */
+string floatText(double value) {
+    // la forma più corta in notazione fissa occupa al massimo 327 caratteri, segno compreso (i subnormali più piccoli)
+    char text[400];
+    auto result = to_chars(text, text + sizeof(text), value, chars_format::fixed);
+    return string(text, result.ptr);
+}
+
+/**
+ * @brief split a line of a text file in its values, a value between double quotes can contain the separator
+ */
+vector<string> splitLine(const string& line, char separator) {
+    vector<string> values(1);
+    bool quoted = false;
 
-void SQLInterpreter::setDatabase(Database& db) { this->db = db; }
+    for(size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if(c == '"' && quoted && i + 1 < line.size() && line[i + 1] == '"') {
+            values.back().push_back('"');
+            i++;
+        } else if(c == '"')
+            quoted = !quoted;
+        else if(c == separator && !quoted)
+            values.emplace_back();
+        else
+            values.back().push_back(c);
+    }
+    return values;
+}
+
+/**
+ * @brief the key of a text in the cache of the statements: every run of spaces, new lines and -- comments
+ * outside the quotes becomes a single space, and the spaces and semicolons at the ends are removed
+ *
+ * The parser accepts only -- comments: a block comment is left as it is, and fails to parse like in the original text.
+ */
+string normalizeSql(const string& sql) {
+    string result;
+    result.reserve(sql.size());
+    char quote = 0;
+    bool space = false;
+
+    for(size_t i = 0; i < sql.size(); i++) {
+        char c = sql[i];
+        if(quote != 0) {
+            result.push_back(c);
+            if(c == quote)
+                quote = 0;
+            continue;
+        }
+        if(c == '-' && i + 1 < sql.size() && sql[i + 1] == '-') {
+            while(i + 1 < sql.size() && sql[i + 1] != '\n')
+                i++;
+            space = true;
+            continue;
+        }
+        if(isspace((unsigned char)c)) {
+            space = true;
+            continue;
+        }
+        if(space && !result.empty())
+            result.push_back(' ');
+        space = false;
+        if(c == '\'' || c == '"')
+            quote = c;
+        result.push_back(c);
+    }
+
+    while(!result.empty() && (result.back() == ';' || result.back() == ' '))
+        result.pop_back();
+    return result;
+}
+
+/**
+ * @brief append to refs the references to columns in an expression, also inside functions
+ */
+void collectColumnRefs(hsql::Expr *expr, vector<hsql::Expr*>& refs) {
+    if(expr == NULL)
+        return;
+    // l'asterisco di COUNT(*) non usa nessuna colonna
+    if(expr->type == hsql::kExprColumnRef)
+        refs.push_back(expr);
+    collectColumnRefs(expr->expr, refs);
+    collectColumnRefs(expr->expr2, refs);
+    if(expr->exprList != NULL) {
+        for(hsql::Expr *e : *expr->exprList)
+            collectColumnRefs(e, refs);
+    }
+}
+
+/**
+ * @brief append to refs the references to columns in the ON clauses of the joins of a source
+ */
+void collectColumnRefs(hsql::TableRef *table, vector<hsql::Expr*>& refs) {
+    if(table == NULL || table->type != hsql::TableRefType::kTableJoin)
+        return;
+    collectColumnRefs(table->join->condition, refs);
+    collectColumnRefs(table->join->left, refs);
+    collectColumnRefs(table->join->right, refs);
+}
+
+}
+
+SQLInterpreter::SQLInterpreter(): db(nullopt), running(nullptr), reusablePlan(false) {}
+
+SQLInterpreter::SQLInterpreter(Database& db): db(db), running(nullptr), reusablePlan(false) {}
+
+void SQLInterpreter::setDatabase(Database& db) {
+    this->db = db;
+    // i piani usano le tabelle dell'altro database
+    for(auto& [text, statement] : statements)
+        statement->plan.reset();
+    for(auto& [name, statement] : prepared)
+        statement->plan.reset();
+}
 
 void SQLInterpreter::execute(const string& sql) {
-    hsql::SQLParserResult result;
+    shared_ptr<Statement> statement = parse(normalizeSql(sql));
+    if(statement == nullptr)
+        return;
+    if(!statement->values.empty())
+        throw runtime_error("SQL: a statement with parameters has to be prepared with PREPARE and run with EXECUTE");
+    run(*statement);
+}
+
+void SQLInterpreter::executePrepared(const string& name, const vector<string>& values) {
+    auto it = prepared.find(name);
+    if(it == prepared.end())
+        throw invalid_argument("SQL: the statement " + name + " has not been prepared");
 
-    hsql::SQLParser::parse(sql,&result);
+    // la copia tiene vivo lo statement anche se viene preparato di nuovo con lo stesso nome
+    shared_ptr<Statement> statement = it->second;
+    if(values.size() != statement->values.size())
+        throw invalid_argument("SQL: the statement " + name + " has " + to_string(statement->values.size()) + " parameters, "
+            + to_string(values.size()) + " values given");
 
-    if(result.isValid() && result.size() > 0) {
-        for(auto statement : result.getStatements()) {
-            executeStatement(statement);
-        }        
-    } else cout << "SQL_PARSER_ERROR: " << result.errorMsg() << endl;
+    for(size_t i = 0; i < values.size(); i++)
+        *statement->values[i] = values[i];
+    run(*statement);
+}
+
+shared_ptr<SQLInterpreter::Statement> SQLInterpreter::parse(const string& text) {
+    auto cached = statements.find(text);
+    if(cached != statements.end())
+        return cached->second;
+
+    auto statement = make_shared<Statement>();
+    statement->parsed = make_unique<hsql::SQLParserResult>();
+    hsql::SQLParser::parse(text, statement->parsed.get());
+
+    if(!statement->parsed->isValid() || statement->parsed->size() == 0) {
+        cout << "SQL_PARSER_ERROR: " << statement->parsed->errorMsg() << endl;
+        return nullptr;
+    }
+
+    // i segnaposto sono nell'ordine in cui compaiono nel testo
+    const auto& parameters = statement->parsed->parameters();
+    for(size_t i = 0; i < parameters.size(); i++) {
+        statement->placeholders[parameters[i]] = i;
+        statement->values.push_back(make_shared<string>());
+    }
 
+    if(statements.size() >= MAX_CACHED_STATEMENTS)
+        statements.clear();
+    statements[text] = statement;
+    return statement;
+}
+
+void SQLInterpreter::run(Statement& statement) {
+    // EXECUTE esegue un altro statement dentro a questo: alla fine si torna ai segnaposto di questo
+    Statement* previous = running;
+    running = &statement;
+    try {
+        for(auto parsed : statement.parsed->getStatements())
+            executeStatement(parsed);
+    } catch(...) {
+        running = previous;
+        throw;
+    }
+    running = previous;
 }
 
 void SQLInterpreter::executeStatement(hsql::SQLStatement *statement) {
@@ -28,6 +201,21 @@ void SQLInterpreter::executeStatement(hsql::SQLStatement *statement) {
         case hsql::StatementType::kStmtSelect : 
         executeSelect(dynamic_cast<hsql::SelectStatement*>(statement));
         break;
+        case hsql::StatementType::kStmtImport :
+        executeImport(dynamic_cast<hsql::ImportStatement*>(statement));
+        break;
+        case hsql::StatementType::kStmtDelete :
+        executeDelete(dynamic_cast<hsql::DeleteStatement*>(statement));
+        break;
+        case hsql::StatementType::kStmtUpdate :
+        executeUpdate(dynamic_cast<hsql::UpdateStatement*>(statement));
+        break;
+        case hsql::StatementType::kStmtPrepare :
+        executePrepare(dynamic_cast<hsql::PrepareStatement*>(statement));
+        break;
+        case hsql::StatementType::kStmtExecute :
+        executeExecute(dynamic_cast<hsql::ExecuteStatement*>(statement));
+        break;
         default:
             cout << "SQL: unsupported query" << endl;
             break;
@@ -39,15 +227,644 @@ void SQLInterpreter::executeSelect(hsql::SelectStatement *select) {
         cout << "SQL: from Table void" << endl;
         return;
     }
+    if(!db.has_value()) {
+        cout << "SQL: no database selected" << endl;
+        return;
+    }
+
+    // una SELECT da sola riusa il suo piano finché le tabelle non cambiano: alla open le condizioni leggono i nuovi valori dei parametri
+    Statement& statement = *running;
+    size_t version = db.value().get().getSchemaVersion();
+    bool alone = statement.parsed->size() == 1;
+    if(alone && statement.plan != nullptr && statement.schemaVersion == version) {
+        printRows(*statement.plan.get());
+        return;
+    }
+
+    reusablePlan = true;
+    auto plan = planSelect(select);
+    printRows(*plan.get());
+
+    if(alone && reusablePlan) {
+        statement.plan = move(plan);
+        statement.schemaVersion = version;
+    } else
+        statement.plan.reset();
+}
+
+void SQLInterpreter::executePrepare(hsql::PrepareStatement *statement) {
+    shared_ptr<Statement> parsed = parse(normalizeSql(statement->query));
+    if(parsed == nullptr)
+        return;
+
+    if(parsed->parsed->size() != 1)
+        throw runtime_error("SQL: a prepared statement must contain a single statement");
+    auto type = parsed->parsed->getStatement(0)->type();
+    if(type == hsql::StatementType::kStmtPrepare || type == hsql::StatementType::kStmtExecute)
+        throw runtime_error("SQL: PREPARE and EXECUTE cannot be prepared");
+
+    prepared[statement->name] = parsed;
+    cout << "SQL: statement " << statement->name << " prepared" << endl;
+}
+
+void SQLInterpreter::executeExecute(hsql::ExecuteStatement *statement) {
+    vector<string> values;
+    if(statement->parameters != NULL) {
+        for(hsql::Expr *expr : *statement->parameters) {
+            auto text = literalText(expr);
+            if(!text.has_value())
+                throw runtime_error("SQL: the values of EXECUTE must be constants");
+            values.push_back(text.value());
+        }
+    }
+    executePrepared(statement->name, values);
+}
+
+void SQLInterpreter::executeImport(hsql::ImportStatement *import) {
+    if(!db.has_value()) {
+        cout << "SQL: no database selected" << endl;
+        return;
+    }
+    if(import->whereClause != NULL)
+        throw runtime_error("SQL: WHERE is not supported in COPY");
+
+    PhysicalTable& table = tableNamed(import->tableName);
+    Relation& relation = *table.getRelation();
+    size_t recordSize = relation.getRecordSize();
+    size_t batchRecords = max<size_t>(1, BULK_LOAD_BYTES / recordSize);
+
+    string path = import->filePath;
+    auto type = import->type;
+    if(type == hsql::kImportAuto) {
+        string extension = fs::path(path).extension().string();
+        type = extension == ".bin" ? hsql::kImportBinary : extension == ".tbl" ? hsql::kImportTbl : hsql::kImportCSV;
+    }
+
+    ifstream input(path, ios::binary);
+    if(!input.is_open())
+        throw runtime_error("SQL: cannot open " + path);
+
+    size_t loaded = 0;
+    string batch;
+    batch.reserve(batchRecords * recordSize);
+
+    if(type == hsql::kImportBinary) {
+        while(true) {
+            batch.resize(batchRecords * recordSize);
+            size_t n = input.read(batch.data(), batch.size()).gcount();
+            batch.resize(n);
+            if(n % recordSize != 0)
+                throw invalid_argument("SQL: the size of " + path + " is not a multiple of the record size");
+            if(n == 0)
+                break;
+            table.bulkLoad(batch);
+            loaded += n / recordSize;
+        }
+    } else {
+        char separator = type == hsql::kImportTbl ? '|' : ',';
+        size_t fieldCount = relation.compiled().fieldCount();
+        string line;
+        size_t lineNo = 0;
+
+        while(getline(input, line)) {
+            lineNo++;
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if(line.empty())
+                continue;
+
+            vector<string> values = splitLine(line, separator);
+            // le righe dei file .tbl finiscono con il separatore
+            if(values.size() == fieldCount + 1 && values.back().empty())
+                values.pop_back();
+            try {
+                batch.append(parseRecord(relation, values));
+            } catch(const invalid_argument& e) {
+                throw invalid_argument("SQL: line " + to_string(lineNo) + " of " + path + ": " + e.what());
+            }
+
+            if(batch.size() >= batchRecords * recordSize) {
+                table.bulkLoad(batch);
+                loaded += batch.size() / recordSize;
+                batch.clear();
+            }
+        }
+        if(!batch.empty()) {
+            table.bulkLoad(batch);
+            loaded += batch.size() / recordSize;
+        }
+    }
+
+    cout << "SQL: " << loaded << (loaded == 1 ? " record" : " records") << " loaded" << endl;
+}
+
+void SQLInterpreter::executeDelete(hsql::DeleteStatement *statement) {
+    if(!db.has_value()) {
+        cout << "SQL: no database selected" << endl;
+        return;
+    }
+
+    PhysicalTable& table = tableNamed(statement->tableName);
+    size_t deleted = table.deleteWhere(wherePredicate(statement->expr, table, statement->tableName));
+    cout << "SQL: " << deleted << (deleted == 1 ? " record" : " records") << " deleted" << endl;
+}
+
+void SQLInterpreter::executeUpdate(hsql::UpdateStatement *statement) {
+    if(!db.has_value()) {
+        cout << "SQL: no database selected" << endl;
+        return;
+    }
+    if(statement->table->type != hsql::TableRefType::kTableName)
+        throw runtime_error("SQL: UPDATE supports only a table");
+
+    string name = statement->table->name;
+    PhysicalTable& table = tableNamed(name.c_str());
+    vector<Column> columns = columnsOf(*table.getRelation(), name);
+
+    // i valori restano vivi fino alla fine dell'aggiornamento, i Value ne tengono una vista
+    vector<string> data;
+    vector<size_t> indexes;
+    data.reserve(statement->updates->size());
+    for(hsql::UpdateClause *update : *statement->updates) {
+        size_t i = columnIndex(columns, "", update->column);
+        if(columns[i].field.isKey())
+            throw runtime_error("SQL: the columns of the key cannot be updated");
+        data.push_back(literalValue(update->value, columns[i].field));
+        indexes.push_back(i);
+    }
+
+    vector<Value> values;
+    for(size_t i = 0; i < indexes.size(); i++)
+        values.push_back(Value(columns[indexes[i]].field, data[i]));
+
+    size_t updated = table.updateWhere(wherePredicate(statement->where, table, name), values);
+    cout << "SQL: " << updated << (updated == 1 ? " record" : " records") << " updated" << endl;
+}
+
+function<bool(string_view)> SQLInterpreter::wherePredicate(hsql::Expr *where, PhysicalTable& table, const string& name) {
+    if(where == NULL)
+        return [](string_view) { return true; };
+
+    vector<Condition> conditions;
+    collectConditions(where, columnsOf(*table.getRelation(), name), conditions);
+
+    return [conditions](string_view record) {
+        for(const Condition& condition : conditions) {
+            if(!condition.matches(record))
+                return false;
+        }
+        return true;
+    };
+}
+
+string SQLInterpreter::parseRecord(Relation& relation, const vector<string>& values) {
+    const CompiledSchema& schema = relation.compiled();
+    vector<Field> fields = relation.getFields();
+    if(values.size() != fields.size())
+        throw invalid_argument("expected " + to_string(fields.size()) + " values, found " + to_string(values.size()));
+
+    string record(relation.getRecordSize(), '\0');
+    for(size_t i = 0; i < fields.size(); i++) {
+        string value = fields[i].getDomain()->parse(values[i]);
+        memcpy(record.data() + schema.handleAt(i).offset, value.data(), value.size());
+    }
+    return record;
+}
+
+OperatorPtr SQLInterpreter::planSelect(hsql::SelectStatement *select) {
     auto table = select->fromTable;
 
+    vector<Condition> conditions;
+    if(select->whereClause != NULL)
+        collectConditions(select->whereClause, sourceColumns(table), conditions);
+
+    // le colonne usate dalla query, le scansioni possono non leggere le altre: con * servono tutte
+    optional<vector<hsql::Expr*>> references = vector<hsql::Expr*>();
+    for(hsql::Expr *expr : *select->selectList) {
+        if(expr->type == hsql::kExprStar)
+            references = nullopt;
+        else if(references.has_value())
+            collectColumnRefs(expr, references.value());
+    }
+    if(references.has_value()) {
+        collectColumnRefs(select->whereClause, references.value());
+        collectColumnRefs(table, references.value());
+        if(select->groupBy != NULL) {
+            for(hsql::Expr *expr : *select->groupBy->columns)
+                collectColumnRefs(expr, references.value());
+        }
+        if(select->order != NULL) {
+            for(hsql::OrderDescription *order : *select->order)
+                collectColumnRefs(order->expr, references.value());
+        }
+    }
+
+    OperatorPtr plan = planSource(table, conditions, references);
+
+    bool aggregation = select->groupBy != NULL;
+    for(hsql::Expr *expr : *select->selectList)
+        aggregation = aggregation || expr->type == hsql::kExprFunctionRef;
+
+    vector<size_t> indexes;
+    if(aggregation)
+        plan = planAggregate(select, move(plan), indexes);
+
+    if(select->order != NULL) {
+        vector<SortKey> keys;
+        for(hsql::OrderDescription *order : *select->order) {
+            size_t i;
+            if(order->expr->type == hsql::kExprColumnRef)
+                i = columnIndex(plan->columns(), order->expr->table != NULL ? order->expr->table : "", order->expr->name);
+            else if(order->expr->type == hsql::kExprFunctionRef && aggregation)
+                i = columnIndex(plan->columns(), "", aggregateName(order->expr));
+            else
+                throw runtime_error("SQL: only columns are supported in ORDER BY");
+            keys.push_back(SortKey{i, order->type == hsql::kOrderDesc});
+        }
+        plan = make_unique<Sort>(move(plan), keys);
+    }
+
+    // con l'aggregazione le colonne del SELECT sono già state risolte
+    for(size_t e = 0; e < select->selectList->size() && !aggregation; e++) {
+        hsql::Expr *expr = select->selectList->at(e);
+        switch (expr->type) {
+        case hsql::kExprStar:
+            for(size_t i = 0; i < plan->columns().size(); i++)
+                indexes.push_back(i);
+            break;
+        case hsql::kExprColumnRef:
+            indexes.push_back(columnIndex(plan->columns(), expr->table != NULL ? expr->table : "", expr->name));
+            break;
+        default:
+            throw runtime_error("SQL: unsupported expression in SELECT");
+        }
+    }
+
+    bool identity = indexes.size() == plan->columns().size();
+    for(size_t i = 0; i < indexes.size() && identity; i++)
+        identity = indexes[i] == i;
+    if(!identity)
+        plan = make_unique<Projection>(move(plan), indexes);
+
+    if(select->limit != NULL) {
+        size_t limit = SIZE_MAX, offset = 0;
+        if(select->limit->limit != NULL && select->limit->limit->type == hsql::kExprLiteralInt)
+            limit = max<int64_t>(select->limit->limit->ival, 0);
+        if(select->limit->offset != NULL && select->limit->offset->type == hsql::kExprLiteralInt)
+            offset = max<int64_t>(select->limit->offset->ival, 0);
+        // il valore di un parametro resta nel Limit: il piano vale solo per questa esecuzione
+        if(select->limit->limit != NULL && select->limit->limit->type == hsql::kExprParameter) {
+            limit = max<int64_t>(stoll(literalText(select->limit->limit).value()), 0);
+            reusablePlan = false;
+        }
+        if(select->limit->offset != NULL && select->limit->offset->type == hsql::kExprParameter) {
+            offset = max<int64_t>(stoll(literalText(select->limit->offset).value()), 0);
+            reusablePlan = false;
+        }
+        plan = make_unique<Limit>(move(plan), limit, offset);
+    }
+
+    return plan;
+}
+
+OperatorPtr SQLInterpreter::planAggregate(hsql::SelectStatement *select, OperatorPtr source, vector<size_t>& indexes) {
+    const auto& columns = source->columns();
+
+    vector<size_t> groups;
+    if(select->groupBy != NULL) {
+        if(select->groupBy->having != NULL)
+            throw runtime_error("SQL: HAVING is not supported");
+        for(hsql::Expr *expr : *select->groupBy->columns) {
+            if(expr->type != hsql::kExprColumnRef)
+                throw runtime_error("SQL: only columns are supported in GROUP BY");
+            groups.push_back(columnIndex(columns, expr->table != NULL ? expr->table : "", expr->name));
+        }
+    }
+
+    vector<Aggregate> aggregates;
+    for(hsql::Expr *expr : *select->selectList) {
+        if(expr->type == hsql::kExprColumnRef) {
+            size_t i = columnIndex(columns, expr->table != NULL ? expr->table : "", expr->name);
+            auto group = find(groups.begin(), groups.end(), i);
+            if(group == groups.end())
+                throw invalid_argument("Column " + string(expr->name) + " must appear in GROUP BY");
+            indexes.push_back(group - groups.begin());
+        } else if(expr->type == hsql::kExprFunctionRef) {
+            aggregates.push_back(aggregateOf(expr, columns));
+            indexes.push_back(groups.size() + aggregates.size() - 1);
+        } else
+            throw runtime_error("SQL: unsupported expression in SELECT");
+    }
+
+    Gather *gather = dynamic_cast<Gather*>(source.get());
+    if(gather == nullptr)
+        return make_unique<HashAggregate>(move(source), groups, aggregates);
+
+    // ogni worker aggrega le sue righe, poi gli stati parziali si uniscono: gruppi e stati sono nelle prime colonne
+    gather->transform([&](OperatorPtr pipeline) -> OperatorPtr {
+        return make_unique<HashAggregate>(move(pipeline), groups, aggregates, AggregateMode::Partial);
+    });
+
+    vector<size_t> finalGroups;
+    for(size_t i = 0; i < groups.size(); i++)
+        finalGroups.push_back(i);
+    for(size_t i = 0; i < aggregates.size(); i++)
+        aggregates[i].column = groups.size() + i;
+
+    return make_unique<HashAggregate>(move(source), finalGroups, aggregates, AggregateMode::Final);
+}
+
+Aggregate SQLInterpreter::aggregateOf(hsql::Expr *expr, const vector<Column>& columns) {
+    string function = expr->name;
+    transform(function.begin(), function.end(), function.begin(), ::toupper);
+
+    static const unordered_map<string, AggregateFunction> functions = {
+        {"COUNT", AggregateFunction::Count},
+        {"SUM", AggregateFunction::Sum},
+        {"MIN", AggregateFunction::Min},
+        {"MAX", AggregateFunction::Max},
+        {"AVG", AggregateFunction::Avg}
+    };
+    auto it = functions.find(function);
+    if(it == functions.end() || expr->exprList == NULL || expr->exprList->size() != 1 || expr->distinct)
+        throw runtime_error("SQL: unsupported function " + function);
+
+    hsql::Expr *argument = expr->exprList->at(0);
+    optional<size_t> column;
+    if(argument->type == hsql::kExprColumnRef)
+        column = columnIndex(columns, argument->table != NULL ? argument->table : "", argument->name);
+    else if(argument->type != hsql::kExprStar || it->second != AggregateFunction::Count)
+        throw runtime_error("SQL: unsupported argument of " + function);
+
+    return Aggregate{it->second, column, expr->alias != NULL ? expr->alias : aggregateName(expr)};
+}
+
+string SQLInterpreter::aggregateName(hsql::Expr *expr) {
+    string function = expr->name;
+    transform(function.begin(), function.end(), function.begin(), ::toupper);
+
+    string argument = "*";
+    if(expr->exprList != NULL && expr->exprList->size() == 1 && expr->exprList->at(0)->type == hsql::kExprColumnRef)
+        argument = expr->exprList->at(0)->name;
+    return function + "(" + argument + ")";
+}
+
+vector<Column> SQLInterpreter::sourceColumns(hsql::TableRef *table) {
     switch (table->type) {
-    case hsql::TableRefType::kTableSelect:
-        /* code */
-        break;
-    
+    case hsql::TableRefType::kTableName:
+        return columnsOf(*tableNamed(table->name).getRelation(), table->alias != NULL ? table->alias->name : table->name);
+    case hsql::TableRefType::kTableJoin: {
+        // gli offset non servono per risolvere i nomi delle colonne
+        auto columns = sourceColumns(table->join->left);
+        auto right = sourceColumns(table->join->right);
+        columns.insert(columns.end(), right.begin(), right.end());
+        return columns;
+    }
+    default:
+        throw runtime_error("SQL: unsupported query");
+    }
+}
+
+OperatorPtr SQLInterpreter::planSource(hsql::TableRef *table, const vector<Condition>& conditions, const optional<vector<hsql::Expr*>>& references) {
+    switch (table->type) {
+    case hsql::TableRefType::kTableName:
+        return planTable(table, conditions, references);
+    case hsql::TableRefType::kTableJoin:
+        return planJoin(table, conditions, references);
     default:
-        cout << "SQL: unsupported query" << endl;
+        throw runtime_error("SQL: unsupported query");
+    }
+}
+
+OperatorPtr SQLInterpreter::planTable(hsql::TableRef *table, const vector<Condition>& where, const optional<vector<hsql::Expr*>>& references) {
+    PhysicalTable& physical = tableNamed(table->name);
+    string alias = table->alias != NULL ? table->alias->name : table->name;
+    auto rel = physical.getRelation();
+    auto columns = columnsOf(*rel.get(), alias);
+
+    // solo le condizioni sulle colonne di questa tabella, con l'offset nelle sue righe
+    vector<Condition> conditions;
+    for(const Condition& condition : where) {
+        if(condition.column.table == alias)
+            conditions.push_back(Condition{columns[columnIndex(columns, alias, condition.column.field.getName())], condition.op, condition.value, condition.parameter});
+    }
+
+    // i campi della chiave sono le prime colonne: se sono tutti fissati si cerca per chiave
+    size_t keyFields = rel.get()->getKey().size();
+    vector<optional<size_t>> keyConditions(keyFields);
+    for(size_t i = 0; i < conditions.size(); i++) {
+        if(conditions[i].op != CompareOp::Equal)
+            continue;
+        for(size_t k = 0; k < keyFields; k++) {
+            if(columns[k].field.getName() == conditions[i].column.field.getName() && !keyConditions[k].has_value())
+                keyConditions[k] = i;
+        }
+    }
+
+    bool byKey = true;
+    for(auto& k : keyConditions)
+        byKey = byKey && k.has_value();
+
+    if(!byKey) {
+        ColumnRanges needed = neededColumns(columns, alias, references);
+        ThreadPool& pool = ThreadPool::shared();
+        if(pool.size() < 2 || physical.size() < PARALLEL_SCAN_ROWS)
+            return make_unique<TableScan>(physical, alias, conditions, nullptr, needed);
+
+        // scansione parallela: ogni worker prende i morsel dalla stessa coda, che si consuma una volta sola
+        auto morsels = make_shared<MorselQueue>(physical);
+        if(morsels->size() < 2)
+            return make_unique<TableScan>(physical, alias, conditions, nullptr, needed);
+        reusablePlan = false;
+
+        vector<OperatorPtr> scans;
+        for(size_t i = 0; i < min(pool.size(), morsels->size()); i++)
+            scans.push_back(make_unique<TableScan>(physical, alias, conditions, morsels, needed));
+        return make_unique<Gather>(move(scans), pool);
+    }
+
+    vector<Condition> key;
+    vector<bool> used(conditions.size(), false);
+    for(auto& k : keyConditions) {
+        key.push_back(conditions[k.value()]);
+        used[k.value()] = true;
+    }
+
+    vector<Condition> remaining;
+    for(size_t i = 0; i < conditions.size(); i++) {
+        if(!used[i])
+            remaining.push_back(conditions[i]);
+    }
+
+    OperatorPtr plan = make_unique<KeyLookup>(physical, alias, key);
+    if(!remaining.empty())
+        plan = make_unique<Filter>(move(plan), remaining);
+    return plan;
+}
+
+OperatorPtr SQLInterpreter::planJoin(hsql::TableRef *table, const vector<Condition>& conditions, const optional<vector<hsql::Expr*>>& references) {
+    hsql::JoinDefinition *join = table->join;
+    if(join->type != hsql::kJoinInner || join->condition == NULL)
+        throw runtime_error("SQL: only inner joins with an ON clause are supported");
+
+    OperatorPtr left = planSource(join->left, conditions, references);
+    OperatorPtr right = planSource(join->right, conditions, references);
+
+    vector<size_t> leftKeys, rightKeys;
+    collectJoinKeys(join->condition, left->columns(), right->columns(), leftKeys, rightKeys);
+
+    return make_unique<HashJoin>(move(left), move(right), leftKeys, rightKeys);
+}
+
+ColumnRanges SQLInterpreter::neededColumns(const vector<Column>& columns, const string& alias, const optional<vector<hsql::Expr*>>& references) {
+    if(!references.has_value())
+        return {};
+
+    vector<bool> used(columns.size(), false);
+    for(hsql::Expr *ref : references.value()) {
+        for(size_t i = 0; i < columns.size(); i++) {
+            if((ref->table == NULL || alias == ref->table) && columns[i].field.getName() == ref->name)
+                used[i] = true;
+        }
+    }
+
+    ColumnRanges result;
+    for(size_t i = 0; i < columns.size(); i++) {
+        if(used[i])
+            result.push_back({columns[i].offset, columns[i].field.size()});
+    }
+    if(result.size() == columns.size())
+        return {};
+    // una query come SELECT COUNT(*) non usa nessuna colonna: basta leggere la prima
+    if(result.empty())
+        result.push_back({columns[0].offset, columns[0].field.size()});
+    return result;
+}
+
+void SQLInterpreter::collectJoinKeys(hsql::Expr *expr, const vector<Column>& left, const vector<Column>& right, vector<size_t>& leftKeys, vector<size_t>& rightKeys) {
+    if(expr->type == hsql::kExprOperator && expr->opType == hsql::kOpAnd) {
+        collectJoinKeys(expr->expr, left, right, leftKeys, rightKeys);
+        collectJoinKeys(expr->expr2, left, right, leftKeys, rightKeys);
+        return;
+    }
+
+    if(expr->type != hsql::kExprOperator || expr->opType != hsql::kOpEquals
+        || expr->expr->type != hsql::kExprColumnRef || expr->expr2->type != hsql::kExprColumnRef)
+        throw runtime_error("SQL: only equalities between columns are supported in a join");
+
+    auto contains = [](const vector<Column>& columns, hsql::Expr *column) {
+        for(const Column& c : columns) {
+            if(c.field.getName() == column->name && (column->table == NULL || c.table == column->table))
+                return true;
+        }
+        return false;
+    };
+
+    hsql::Expr *a = expr->expr;
+    hsql::Expr *b = expr->expr2;
+    if(!contains(left, a))
+        swap(a, b);
+
+    leftKeys.push_back(columnIndex(left, a->table != NULL ? a->table : "", a->name));
+    rightKeys.push_back(columnIndex(right, b->table != NULL ? b->table : "", b->name));
+}
+
+void SQLInterpreter::collectConditions(hsql::Expr *expr, const vector<Column>& columns, vector<Condition>& conditions) {
+    if(expr->type != hsql::kExprOperator)
+        throw runtime_error("SQL: unsupported WHERE clause");
+
+    if(expr->opType == hsql::kOpAnd) {
+        collectConditions(expr->expr, columns, conditions);
+        collectConditions(expr->expr2, columns, conditions);
+        return;
+    }
+
+    CompareOp op;
+    CompareOp flipped;
+    switch (expr->opType) {
+        case hsql::kOpEquals:    op = CompareOp::Equal;        flipped = CompareOp::Equal;        break;
+        case hsql::kOpNotEquals: op = CompareOp::NotEqual;     flipped = CompareOp::NotEqual;     break;
+        case hsql::kOpLess:      op = CompareOp::Less;         flipped = CompareOp::Greater;      break;
+        case hsql::kOpLessEq:    op = CompareOp::LessEqual;    flipped = CompareOp::GreaterEqual; break;
+        case hsql::kOpGreater:   op = CompareOp::Greater;      flipped = CompareOp::Less;         break;
+        case hsql::kOpGreaterEq: op = CompareOp::GreaterEqual; flipped = CompareOp::LessEqual;    break;
+        default:
+            throw runtime_error("SQL: unsupported WHERE clause");
+    }
+
+    hsql::Expr *column = expr->expr;
+    hsql::Expr *literal = expr->expr2;
+    if(column->type != hsql::kExprColumnRef) {
+        swap(column, literal);
+        op = flipped;
+    }
+    if(column->type != hsql::kExprColumnRef || literal->type == hsql::kExprColumnRef)
+        throw runtime_error("SQL: only comparisons between a column and a constant are supported");
+
+    size_t i = columnIndex(columns, column->table != NULL ? column->table : "", column->name);
+    // con un parametro la condizione rilegge il suo valore a ogni esecuzione del piano
+    shared_ptr<const string> parameter = nullptr;
+    if(literal->type == hsql::kExprParameter)
+        parameter = running->values[running->placeholders.at(literal)];
+    conditions.push_back(Condition{columns[i], op, literalValue(literal, columns[i].field), parameter});
+}
+
+string SQLInterpreter::literalValue(hsql::Expr *expr, const Field& field) {
+    auto text = literalText(expr);
+    if(!text.has_value())
+        throw runtime_error("SQL: unsupported constant for column " + field.getName());
+    return field.getDomain()->parse(text.value());
+}
+
+optional<string> SQLInterpreter::literalText(hsql::Expr *expr) {
+    switch (expr->type) {
+        case hsql::kExprLiteralInt:
+            return to_string(expr->ival);
+        case hsql::kExprLiteralFloat:
+            return floatText(expr->fval);
+        case hsql::kExprLiteralString:
+            return string(expr->name);
+        case hsql::kExprParameter:
+            if(running != nullptr && running->placeholders.count(expr) > 0)
+                return *running->values[running->placeholders.at(expr)];
+            break;
+        case hsql::kExprOperator:
+            if(expr->opType == hsql::kOpUnaryMinus && expr->expr->type == hsql::kExprLiteralInt)
+                return to_string(-expr->expr->ival);
+            if(expr->opType == hsql::kOpUnaryMinus && expr->expr->type == hsql::kExprLiteralFloat)
+                return floatText(-expr->expr->fval);
+            break;
+        default:
+            break;
+    }
+    return nullopt;
+}
+
+PhysicalTable& SQLInterpreter::tableNamed(const char *name) {
+    auto table = db.value().get().getTable(name);
+    if(!table.has_value())
+        throw invalid_argument("Table " + string(name) + " does not exist");
+    return table.value().get();
+}
+
+void SQLInterpreter::printRows(Operator& plan) {
+    const auto& columns = plan.columns();
+
+    for(size_t i = 0; i < columns.size(); i++)
+        cout << (i > 0 ? " | " : "") << columns[i].field.getName();
+    cout << endl;
+
+    size_t count = 0;
+    plan.open();
+    while(auto row = plan.next()) {
+        for(size_t i = 0; i < columns.size(); i++) {
+            const Column& c = columns[i];
+            cout << (i > 0 ? " | " : "") << c.field.getDomain()->format(row.value().substr(c.offset, c.field.size()));
+        }
+        cout << endl;
+        count++;
     }
+    plan.close();
 
+    cout << "(" << count << (count == 1 ? " row)" : " rows)") << endl;
 }
\ No newline at end of file
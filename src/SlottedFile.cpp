@@ -0,0 +1,703 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "SlottedFile.hpp"
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t SLOTTED_MAGIC = 0x31544c53; // "SLT1"
+
+enum PageType : uint8_t {
+    FREE_PAGE = 0,
+    DATA_PAGE = 1,
+    OVERFLOW_PAGE = 2
+};
+
+/*
+    Una pagina dati inizia con questo header, seguito dalla directory degli slot.
+    I record salvati occupano la fine della pagina, a partire da dataStart.
+*/
+struct DataHeader {
+    uint8_t type;
+    uint8_t unused;
+    uint16_t count;
+    uint16_t dataStart;
+    uint16_t unused2;
+};
+
+/*
+    Le pagine di overflow e le pagine libere hanno il numero della pagina successiva della catena.
+*/
+struct OverflowHeader {
+    uint8_t type;
+    uint8_t unused;
+    uint16_t used;
+    uint32_t next;
+};
+
+struct Slot {
+    uint16_t offset;
+    uint16_t length;
+};
+
+constexpr size_t PAGE_HEADER_SIZE = sizeof(DataHeader);
+constexpr size_t SLOT_SIZE = sizeof(Slot);
+constexpr size_t OVERFLOW_DATA = BufferPool::PAGE_SIZE - sizeof(OverflowHeader);
+
+// il bit alto della lunghezza indica uno slot che punta a una catena di overflow: (prima pagina, lunghezza)
+constexpr uint16_t OVERFLOW_FLAG = 0x8000;
+constexpr size_t STUB_SIZE = 2 * sizeof(uint32_t);
+
+DataHeader readDataHeader(const char* page) {
+    DataHeader header;
+    memcpy(&header, page, PAGE_HEADER_SIZE);
+    return header;
+}
+
+void writeDataHeader(char* page, const DataHeader& header) {
+    memcpy(page, &header, PAGE_HEADER_SIZE);
+}
+
+Slot readSlotEntry(const char* page, size_t i) {
+    Slot slot;
+    memcpy(&slot, page + PAGE_HEADER_SIZE + i * SLOT_SIZE, SLOT_SIZE);
+    return slot;
+}
+
+void writeSlotEntry(char* page, size_t i, const Slot& slot) {
+    memcpy(page + PAGE_HEADER_SIZE + i * SLOT_SIZE, &slot, SLOT_SIZE);
+}
+
+// lo spazio occupato da uno slot: almeno quello del riferimento all'overflow, così un record può sempre diventarlo
+size_t allocation(const Slot& slot) {
+    return max<size_t>(slot.length & ~OVERFLOW_FLAG, STUB_SIZE);
+}
+
+}
+
+SlottedFile::SlottedFile(string fileName, size_t keySize, vector<FieldLayout> fields, BufferPool& pool)
+: File(fileName, pool), keySize(keySize), recordSize(0), fields(move(fields)), variableCount(0) {
+    for(const FieldLayout& field : this->fields) {
+        fieldOffsets.push_back(recordSize);
+        recordSize += field.size;
+        variableCount += field.variable;
+    }
+    if(keySize == 0 || keySize > recordSize)
+        throw invalid_argument("The key must be a non empty prefix of the record");
+    if(recordSize > UINT16_MAX)
+        throw invalid_argument("Records are too big to be stored in a slotted file");
+
+    file.seekg(0, ios::end);
+    if(file.tellg() <= 0) {
+        pageCount = 1;
+        lastPage = 0;
+        freeList = 0;
+        recordCount = 0;
+        saveHeader();
+    } else loadHeader();
+
+    openIndex();
+}
+
+SlottedFile::~SlottedFile() {
+    saveHeader();
+    flush();
+    file.close();
+}
+
+class SlotIterator : public iterator<input_iterator_tag, string> {
+    SlottedFile& slottedFile;
+    uint64_t position;
+public:
+    SlotIterator(SlottedFile& file, uint64_t position)
+        : slottedFile(file), position(file.nextRecord(position)) {}
+
+    iterator& operator++() {
+        position = slottedFile.nextRecord(position + 1);
+        return *this;
+    }
+
+    string operator*() const {
+        return slottedFile.getByRid(position);
+    }
+
+    bool operator==(const SlotIterator& other) const {
+        return position == other.position;
+    }
+
+    bool operator!=(const SlotIterator& other) const {
+        return !(*this == other);
+    }
+};
+
+iterator<input_iterator_tag,string> SlottedFile::begin() {
+    return SlotIterator(*this, (uint64_t)1 << 16);
+}
+
+iterator<input_iterator_tag,string> SlottedFile::end() {
+    return SlotIterator(*this, (uint64_t)pageCount << 16);
+}
+
+void SlottedFile::pushData(string_view data) {
+    if(data.length() % recordSize != 0 || data.length() == 0)
+        throw runtime_error("Data length is not a multiple of record size");
+
+    // un record alla volta, così se una chiave è duplicata i record precedenti restano consistenti con l'indice
+    try {
+        for(size_t i = 0; i < data.length(); i += recordSize) {
+            string_view record = data.substr(i, recordSize);
+            if(index->getData(record.substr(0, keySize)).has_value())
+                throw invalid_argument("Primary Key constraint violated");
+
+            RecordId rid = insertRecord(record);
+            index->pushData(indexEntry(record.substr(0, keySize), rid));
+            recordCount++;
+        }
+    } catch(...) {
+        saveHeader();
+        commit();
+        throw;
+    }
+    saveHeader();
+    commit();
+}
+
+optional<string> SlottedFile::deleteData(string_view key) {
+    auto rid = findRecord(key);
+    if(!rid.has_value())
+        return nullopt;
+
+    string deleted = getByRid(rid.value());
+    uint32_t pageNo = rid.value() >> 16;
+    size_t slotNo = rid.value() & 0xFFFF;
+
+    string page = loadPage(pageNo);
+    Slot slot = readSlotEntry(page.data(), slotNo);
+    if(slot.length & OVERFLOW_FLAG) {
+        uint32_t first;
+        memcpy(&first, page.data() + slot.offset, sizeof(uint32_t));
+        freeOverflow(first);
+    }
+    writeSlotEntry(page.data(), slotNo, Slot{0, 0});
+    savePage(pageNo, page);
+    noteFreeSpace(pageNo, page);
+
+    index->deleteData(key);
+    recordCount--;
+    saveHeader();
+    commit();
+    return deleted;
+}
+
+optional<string> SlottedFile::getData(string_view key) {
+    auto rid = findRecord(key);
+    if(!rid.has_value())
+        return nullopt;
+    return getByRid(rid.value());
+}
+
+optional<RecordId> SlottedFile::findRecord(string_view key) {
+    if(key.length() != keySize)
+        throw invalid_argument("The key is not valid");
+
+    auto entry = index->getData(key);
+    if(!entry.has_value())
+        return nullopt;
+
+    RecordId rid;
+    memcpy(&rid, entry.value().data() + keySize, sizeof(RecordId));
+    return rid;
+}
+
+string SlottedFile::getByRid(RecordId rid) {
+    uint64_t pageNo = rid >> 16;
+    if(pageNo == 0 || pageNo >= pageCount)
+        throw out_of_range("The record does not exist");
+
+    string record(recordSize, '\0');
+    PageGuard page(pool, *this, pageNo);
+    if(readDataHeader(page.data()).type != DATA_PAGE || !readSlot(page.data(), rid & 0xFFFF, record.data()))
+        throw out_of_range("The record does not exist");
+    return record;
+}
+
+void SlottedFile::updateInPlace(RecordId rid, string_view data, size_t offset) {
+    checkUpdate(data, offset, keySize, recordSize);
+
+    string record = getByRid(rid);
+    record.replace(offset, data.length(), data);
+    rewriteRecord(rid, record);
+    saveHeader();
+    commit();
+}
+
+size_t SlottedFile::deleteWhere(const function<bool(string_view)>& predicate) {
+    size_t deleted = 0;
+    string record(recordSize, '\0');
+
+    for(uint32_t pageNo = 1; pageNo < pageCount; pageNo++) {
+        string page = loadPage(pageNo);
+        DataHeader header = readDataHeader(page.data());
+        if(header.type != DATA_PAGE)
+            continue;
+
+        // cancellare non sposta gli altri record: la copia della pagina resta valida fino alla compattazione
+        bool changed = false;
+        for(size_t s = 0; s < header.count; s++) {
+            if(!readSlot(page.data(), s, record.data()) || !predicate(record))
+                continue;
+
+            Slot slot = readSlotEntry(page.data(), s);
+            if(slot.length & OVERFLOW_FLAG) {
+                uint32_t first;
+                memcpy(&first, page.data() + slot.offset, sizeof(uint32_t));
+                freeOverflow(first);
+            }
+            writeSlotEntry(page.data(), s, Slot{0, 0});
+            index->deleteData(string_view(record).substr(0, keySize));
+            changed = true;
+            deleted++;
+        }
+
+        if(changed) {
+            compactPage(page);
+            savePage(pageNo, page);
+            noteFreeSpace(pageNo, page);
+        }
+    }
+
+    if(deleted > 0) {
+        recordCount -= deleted;
+        saveHeader();
+        commit();
+    }
+    return deleted;
+}
+
+size_t SlottedFile::updateWhere(const function<bool(string_view)>& predicate, const function<void(char*)>& update) {
+    size_t updated = 0;
+    string record(recordSize, '\0');
+    string changed;
+
+    for(uint32_t pageNo = 1; pageNo < pageCount; pageNo++) {
+        size_t count;
+        {
+            PageGuard page(pool, *this, pageNo);
+            DataHeader header = readDataHeader(page.data());
+            count = header.type == DATA_PAGE ? header.count : 0;
+        }
+
+        // un record riscritto può spostare gli altri nella pagina: ogni record si rilegge dalla pagina
+        for(size_t s = 0; s < count; s++) {
+            bool live;
+            {
+                PageGuard page(pool, *this, pageNo);
+                live = readSlot(page.data(), s, record.data());
+            }
+            if(!live || !predicate(record))
+                continue;
+
+            applyUpdate(update, record, changed, keySize);
+            rewriteRecord((RecordId)pageNo << 16 | s, changed);
+            updated++;
+        }
+    }
+
+    saveHeader();
+    commit();
+    return updated;
+}
+
+bool SlottedFile::nextBatch(size_t& cursor, RecordBatch& batch) {
+    // il cursore è la posizione (pagina << 16 | slot) del prossimo record, 0 prima della prima pagina
+    return readRecords(1, pageCount, cursor, batch);
+}
+
+size_t SlottedFile::size() const { return recordCount; }
+
+bool SlottedFile::indexedLookup() const { return true; }
+
+vector<Morsel> SlottedFile::morsels() {
+    size_t pages = MORSEL_SIZE / BufferPool::PAGE_SIZE;
+    vector<Morsel> result;
+    for(size_t begin = 1; begin < pageCount; begin += pages)
+        result.push_back(Morsel{begin, min<size_t>(begin + pages, pageCount)});
+    return result;
+}
+
+bool SlottedFile::readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) {
+    return readRecords(morsel.begin, morsel.end, cursor, batch);
+}
+
+string SlottedFile::encode(string_view record) const {
+    string result(variableCount * sizeof(uint16_t), '\0');
+    for(size_t f = 0; f < fields.size(); f++) {
+        if(!fields[f].variable)
+            result.append(record.substr(fieldOffsets[f], fields[f].size));
+    }
+
+    size_t variableStart = result.length();
+    size_t k = 0;
+    for(size_t f = 0; f < fields.size(); f++) {
+        if(!fields[f].variable)
+            continue;
+        // il padding di '\0' in fondo al valore non si salva
+        string_view value = record.substr(fieldOffsets[f], fields[f].size);
+        size_t end = value.find_last_not_of('\0');
+        result.append(value.substr(0, end == string_view::npos ? 0 : end + 1));
+
+        uint16_t valueEnd = result.length() - variableStart;
+        memcpy(result.data() + k++ * sizeof(uint16_t), &valueEnd, sizeof(uint16_t));
+    }
+    return result;
+}
+
+void SlottedFile::decode(string_view stored, char* out) const {
+    memset(out, 0, recordSize);
+    size_t position = variableCount * sizeof(uint16_t);
+    for(size_t f = 0; f < fields.size(); f++) {
+        if(!fields[f].variable) {
+            memcpy(out + fieldOffsets[f], stored.data() + position, fields[f].size);
+            position += fields[f].size;
+        }
+    }
+
+    const char* values = stored.data() + position;
+    size_t start = 0, k = 0;
+    for(size_t f = 0; f < fields.size(); f++) {
+        if(!fields[f].variable)
+            continue;
+        uint16_t end;
+        memcpy(&end, stored.data() + k++ * sizeof(uint16_t), sizeof(uint16_t));
+        memcpy(out + fieldOffsets[f], values + start, end - start);
+        start = end;
+    }
+}
+
+bool SlottedFile::readSlot(const char* page, size_t slotNo, char* out) {
+    if(slotNo >= readDataHeader(page).count)
+        return false;
+    Slot slot = readSlotEntry(page, slotNo);
+    if(slot.offset == 0)
+        return false;
+
+    if(!(slot.length & OVERFLOW_FLAG)) {
+        decode(string_view(page + slot.offset, slot.length), out);
+        return true;
+    }
+
+    uint32_t stub[2];
+    memcpy(stub, page + slot.offset, STUB_SIZE);
+    decode(readOverflow(stub[0], stub[1]), out);
+    return true;
+}
+
+bool SlottedFile::readRecords(size_t first, size_t end, size_t& cursor, RecordBatch& batch) {
+    uint64_t position = max<uint64_t>(cursor, (uint64_t)first << 16);
+    char* out = batch.prepare(recordSize, RecordBatch::CAPACITY);
+    size_t n = 0;
+
+    while(n < RecordBatch::CAPACITY && (position >> 16) < end) {
+        uint32_t pageNo = position >> 16;
+        size_t slotNo = position & 0xFFFF;
+        PageGuard page(pool, *this, pageNo);
+        DataHeader header = readDataHeader(page.data());
+
+        for(; header.type == DATA_PAGE && slotNo < header.count && n < RecordBatch::CAPACITY; slotNo++) {
+            if(readSlot(page.data(), slotNo, out + n * recordSize))
+                n++;
+        }
+        position = header.type == DATA_PAGE && slotNo < header.count ? (uint64_t)pageNo << 16 | slotNo : (uint64_t)(pageNo + 1) << 16;
+    }
+
+    cursor = position;
+    batch.count = n;
+    return n > 0;
+}
+
+uint64_t SlottedFile::nextRecord(uint64_t position) {
+    for(uint32_t pageNo = max<uint64_t>(position >> 16, 1); pageNo < pageCount; pageNo++) {
+        PageGuard page(pool, *this, pageNo);
+        DataHeader header = readDataHeader(page.data());
+        size_t slotNo = pageNo == (position >> 16) ? position & 0xFFFF : 0;
+        for(; header.type == DATA_PAGE && slotNo < header.count; slotNo++) {
+            if(readSlotEntry(page.data(), slotNo).offset != 0)
+                return (uint64_t)pageNo << 16 | slotNo;
+        }
+    }
+    return (uint64_t)pageCount << 16;
+}
+
+RecordId SlottedFile::insertRecord(string_view record) {
+    string stored = encode(record);
+    bool overflow = stored.length() > MAX_INLINE;
+    if(overflow) {
+        uint32_t stub[2] = {writeOverflow(stored), (uint32_t)stored.length()};
+        stored.assign((const char*)stub, STUB_SIZE);
+    }
+
+    // prima l'ultima pagina, poi quelle liberate dalle cancellazioni e infine una pagina nuova
+    if(lastPage != 0) {
+        string page = loadPage(lastPage);
+        if(auto slot = place(page, stored, overflow)) {
+            savePage(lastPage, page);
+            return (RecordId)lastPage << 16 | slot.value();
+        }
+    }
+
+    while(!roomyPages.empty()) {
+        uint32_t pageNo = roomyPages.back();
+        string page = loadPage(pageNo);
+        if(auto slot = place(page, stored, overflow)) {
+            savePage(pageNo, page);
+            return (RecordId)pageNo << 16 | slot.value();
+        }
+        roomyPages.pop_back();
+    }
+
+    uint32_t pageNo = allocatePage();
+    string page(BufferPool::PAGE_SIZE, '\0');
+    writeDataHeader(page.data(), DataHeader{DATA_PAGE, 0, 0, (uint16_t)BufferPool::PAGE_SIZE, 0});
+    size_t slot = place(page, stored, overflow).value();
+    savePage(pageNo, page);
+    lastPage = pageNo;
+    return (RecordId)pageNo << 16 | slot;
+}
+
+optional<size_t> SlottedFile::place(string& page, string_view bytes, bool overflow, optional<size_t> slot) {
+    DataHeader header = readDataHeader(page.data());
+    if(!slot.has_value()) {
+        // si riusa uno slot vuoto, altrimenti se ne aggiunge uno
+        slot = header.count;
+        for(size_t s = 0; s < header.count && slot == header.count; s++) {
+            if(readSlotEntry(page.data(), s).offset == 0)
+                slot = s;
+        }
+    }
+
+    size_t space = max(bytes.length(), STUB_SIZE);
+    size_t needed = space + (slot.value() >= header.count ? SLOT_SIZE : 0);
+    if(slot.value() >= UINT16_MAX || freeSpace(page) < needed)
+        return nullopt;
+
+    size_t count = max<size_t>(header.count, slot.value() + 1);
+    if(header.dataStart < PAGE_HEADER_SIZE + count * SLOT_SIZE + space) {
+        compactPage(page);
+        header = readDataHeader(page.data());
+    }
+
+    header.dataStart -= space;
+    header.count = count;
+    memcpy(page.data() + header.dataStart, bytes.data(), bytes.length());
+    writeSlotEntry(page.data(), slot.value(), Slot{header.dataStart, (uint16_t)(bytes.length() | (overflow ? OVERFLOW_FLAG : 0))});
+    writeDataHeader(page.data(), header);
+    return slot;
+}
+
+void SlottedFile::rewriteRecord(RecordId rid, string_view record) {
+    uint32_t pageNo = rid >> 16;
+    size_t slotNo = rid & 0xFFFF;
+    string page = loadPage(pageNo);
+    Slot old = readSlotEntry(page.data(), slotNo);
+
+    if(old.length & OVERFLOW_FLAG) {
+        uint32_t first;
+        memcpy(&first, page.data() + old.offset, sizeof(uint32_t));
+        freeOverflow(first);
+    }
+
+    string encoded = encode(record);
+    string stored = encoded;
+    bool overflow = encoded.length() > MAX_INLINE;
+    if(overflow) {
+        uint32_t stub[2] = {writeOverflow(encoded), (uint32_t)encoded.length()};
+        stored.assign((const char*)stub, STUB_SIZE);
+    }
+
+    if(max(stored.length(), STUB_SIZE) <= allocation(old)) {
+        // entra nello spazio che aveva: il resto diventa libero alla prossima compattazione
+        memcpy(page.data() + old.offset, stored.data(), stored.length());
+        writeSlotEntry(page.data(), slotNo, Slot{old.offset, (uint16_t)(stored.length() | (overflow ? OVERFLOW_FLAG : 0))});
+        savePage(pageNo, page);
+        return;
+    }
+
+    writeSlotEntry(page.data(), slotNo, Slot{0, 0});
+    if(!place(page, stored, overflow, slotNo).has_value()) {
+        // nella pagina non c'è spazio: il record va in overflow, il riferimento entra sempre nel suo spazio
+        uint32_t stub[2] = {writeOverflow(encoded), (uint32_t)encoded.length()};
+        memcpy(page.data() + old.offset, stub, STUB_SIZE);
+        writeSlotEntry(page.data(), slotNo, Slot{old.offset, (uint16_t)(STUB_SIZE | OVERFLOW_FLAG)});
+    }
+    savePage(pageNo, page);
+}
+
+void SlottedFile::compactPage(string& page) {
+    DataHeader header = readDataHeader(page.data());
+    string compacted = page;
+    size_t dataStart = BufferPool::PAGE_SIZE;
+
+    for(size_t s = 0; s < header.count; s++) {
+        Slot slot = readSlotEntry(page.data(), s);
+        if(slot.offset == 0)
+            continue;
+        dataStart -= allocation(slot);
+        memcpy(compacted.data() + dataStart, page.data() + slot.offset, allocation(slot));
+        writeSlotEntry(compacted.data(), s, Slot{(uint16_t)dataStart, slot.length});
+    }
+
+    // gli slot vuoti in fondo alla directory si tolgono
+    while(header.count > 0 && readSlotEntry(compacted.data(), header.count - 1).offset == 0)
+        header.count--;
+    header.dataStart = dataStart;
+    writeDataHeader(compacted.data(), header);
+    page.swap(compacted);
+}
+
+size_t SlottedFile::freeSpace(const string& page) const {
+    DataHeader header = readDataHeader(page.data());
+    size_t used = PAGE_HEADER_SIZE + header.count * SLOT_SIZE;
+    for(size_t s = 0; s < header.count; s++) {
+        Slot slot = readSlotEntry(page.data(), s);
+        if(slot.offset != 0)
+            used += allocation(slot);
+    }
+    return BufferPool::PAGE_SIZE - used;
+}
+
+uint32_t SlottedFile::writeOverflow(string_view bytes) {
+    // le pagine si scrivono dall'ultima, così ognuna conosce già la successiva
+    uint32_t next = 0;
+    size_t pages = (bytes.length() + OVERFLOW_DATA - 1) / OVERFLOW_DATA;
+    string page(BufferPool::PAGE_SIZE, '\0');
+
+    for(size_t i = pages; i-- > 0;) {
+        size_t length = min(OVERFLOW_DATA, bytes.length() - i * OVERFLOW_DATA);
+        uint32_t pageNo = allocatePage();
+        OverflowHeader header{OVERFLOW_PAGE, 0, (uint16_t)length, next};
+        memcpy(page.data(), &header, sizeof(OverflowHeader));
+        memcpy(page.data() + sizeof(OverflowHeader), bytes.data() + i * OVERFLOW_DATA, length);
+        savePage(pageNo, page);
+        next = pageNo;
+    }
+    return next;
+}
+
+string SlottedFile::readOverflow(uint32_t first, size_t length) {
+    string result;
+    result.reserve(length);
+    for(uint32_t pageNo = first; pageNo != 0 && result.length() < length;) {
+        PageGuard page(pool, *this, pageNo);
+        OverflowHeader header;
+        memcpy(&header, page.data(), sizeof(OverflowHeader));
+        result.append(page.data() + sizeof(OverflowHeader), header.used);
+        pageNo = header.next;
+    }
+    if(result.length() != length)
+        throw runtime_error("Broken overflow chain in file: " + filename());
+    return result;
+}
+
+void SlottedFile::freeOverflow(uint32_t first) {
+    for(uint32_t pageNo = first; pageNo != 0;) {
+        OverflowHeader header;
+        {
+            PageGuard page(pool, *this, pageNo);
+            memcpy(&header, page.data(), sizeof(OverflowHeader));
+        }
+        freePage(pageNo);
+        pageNo = header.next;
+    }
+}
+
+uint32_t SlottedFile::allocatePage() {
+    if(freeList == 0)
+        return pageCount++;
+
+    uint32_t pageNo = freeList;
+    PageGuard page(pool, *this, pageNo);
+    OverflowHeader header;
+    memcpy(&header, page.data(), sizeof(OverflowHeader));
+    freeList = header.next;
+    return pageNo;
+}
+
+void SlottedFile::freePage(uint32_t pageNo) {
+    OverflowHeader header{FREE_PAGE, 0, 0, freeList};
+    writeAt((size_t)pageNo * BufferPool::PAGE_SIZE, (const char*)&header, sizeof(OverflowHeader));
+    freeList = pageNo;
+}
+
+string SlottedFile::loadPage(uint32_t pageNo) {
+    string page(BufferPool::PAGE_SIZE, '\0');
+    readAt((size_t)pageNo * BufferPool::PAGE_SIZE, page.data(), BufferPool::PAGE_SIZE);
+    return page;
+}
+
+void SlottedFile::savePage(uint32_t pageNo, const string& page) {
+    writeAt((size_t)pageNo * BufferPool::PAGE_SIZE, page.data(), BufferPool::PAGE_SIZE);
+}
+
+void SlottedFile::noteFreeSpace(uint32_t pageNo, const string& page) {
+    if(pageNo != lastPage && freeSpace(page) >= BufferPool::PAGE_SIZE / 4 && find(roomyPages.begin(), roomyPages.end(), pageNo) == roomyPages.end())
+        roomyPages.push_back(pageNo);
+}
+
+string SlottedFile::indexEntry(string_view key, RecordId rid) const {
+    string entry(key.data(), keySize);
+    entry.append((const char*)&rid, sizeof(RecordId));
+    return entry;
+}
+
+void SlottedFile::openIndex() {
+    string indexName = filename() + ".hidx";
+    size_t entrySize = keySize + sizeof(RecordId);
+
+    index = make_unique<ExtendibleHashFile>(indexName, keySize, entrySize, pool);
+    if(index->size() == recordCount)
+        return;
+
+    // l'indice manca o non corrisponde al file: viene ricostruito
+    index.reset();
+    remove(indexName.c_str());
+    index = make_unique<ExtendibleHashFile>(indexName, keySize, entrySize, pool);
+
+    string entries;
+    for(uint64_t position = nextRecord(1 << 16); (position >> 16) < pageCount; position = nextRecord(position + 1)) {
+        string record = getByRid(position);
+        entries.append(indexEntry(string_view(record).substr(0, keySize), position));
+    }
+    if(!entries.empty())
+        index->pushData(entries);
+}
+
+void SlottedFile::loadHeader() {
+    char header[BufferPool::PAGE_SIZE];
+    readAt(0, header, BufferPool::PAGE_SIZE);
+
+    uint32_t magic, storedKeySize, storedRecordSize;
+    memcpy(&magic, header, sizeof(uint32_t));
+    memcpy(&storedKeySize, header + 4, sizeof(uint32_t));
+    memcpy(&storedRecordSize, header + 8, sizeof(uint32_t));
+    memcpy(&pageCount, header + 12, sizeof(uint32_t));
+    memcpy(&lastPage, header + 16, sizeof(uint32_t));
+    memcpy(&freeList, header + 20, sizeof(uint32_t));
+    memcpy(&recordCount, header + 24, sizeof(uint64_t));
+
+    if(magic != SLOTTED_MAGIC)
+        throw runtime_error("Not a slotted file: " + filename());
+    if(storedKeySize != keySize || storedRecordSize != recordSize)
+        throw runtime_error("The slotted file has a different record layout: " + filename());
+}
+
+void SlottedFile::saveHeader() {
+    char header[32];
+    uint32_t values[] = {SLOTTED_MAGIC, (uint32_t)keySize, (uint32_t)recordSize, pageCount, lastPage, freeList};
+    memcpy(header, values, sizeof(values));
+    memcpy(header + 24, &recordCount, sizeof(uint64_t));
+    writeAt(0, header, sizeof(header));
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Operators.hpp"
+
+/**
+ * @class Sort::Merger
+ * @brief Merge of sorted runs with a loser tree.
+ *
+ * The leaves of the tree are the first entries of the runs, every internal node keeps the run
+ * that lost the comparison in its subtree and tree[0] keeps the winner, so after producing an entry
+ * only the path from its leaf to the root has to be compared again: log2(k) memcmp for k runs.
+ * A run that is over loses against every other run.
+ */
+class Sort::Merger {
+    struct Run {
+        unique_ptr<SpillFile> file;
+        size_t cursor = 0;
+        RecordBatch batch;
+        size_t position = 0;
+        bool exhausted = false;
+    };
+
+    vector<Run> runs;
+    size_t keySize;
+    vector<size_t> tree;
+    bool started;
+public:
+    Merger(vector<unique_ptr<SpillFile>> files, size_t keySize): runs(files.size()), keySize(keySize), started(false) {
+        for(size_t i = 0; i < runs.size(); i++) {
+            runs[i].file = move(files[i]);
+            load(i);
+        }
+
+        // il valore runs.size() è una foglia fittizia che vince contro tutte: viene espulsa dall'inserimento delle foglie vere
+        tree.assign(runs.size(), runs.size());
+        for(size_t i = runs.size(); i-- > 0;)
+            adjust(i);
+    }
+
+    /**
+     * @return the smallest entry not produced yet, valid until the next call
+     */
+    optional<string_view> next() {
+        if(started)
+            advance(tree[0]);
+        started = true;
+
+        const Run& winner = runs[tree[0]];
+        if(winner.exhausted)
+            return nullopt;
+        return winner.batch[winner.position];
+    }
+
+private:
+    void load(size_t i) {
+        Run& run = runs[i];
+        run.position = 0;
+        if(!run.file->nextBatch(run.cursor, run.batch))
+            run.exhausted = true;
+    }
+
+    void advance(size_t i) {
+        Run& run = runs[i];
+        if(++run.position >= run.batch.count)
+            load(i);
+        adjust(i);
+    }
+
+    /**
+     * @return true if the current entry of run a comes before the current entry of run b
+     */
+    bool beats(size_t a, size_t b) const {
+        if(a == runs.size())
+            return true;
+        if(b == runs.size())
+            return false;
+        if(runs[a].exhausted)
+            return false;
+        if(runs[b].exhausted)
+            return true;
+
+        int cmp = memcmp(runs[a].batch[runs[a].position].data(), runs[b].batch[runs[b].position].data(), keySize);
+        // a parità di chiave vince la run creata prima, così l'ordinamento è stabile
+        return cmp < 0 || (cmp == 0 && a < b);
+    }
+
+    /**
+     * @brief replay the matches from the leaf of a run to the root
+     */
+    void adjust(size_t winner) {
+        for(size_t node = (winner + runs.size()) / 2; node > 0; node /= 2) {
+            if(beats(tree[node], winner))
+                swap(winner, tree[node]);
+        }
+        tree[0] = winner;
+    }
+};
+
+Sort::Sort(OperatorPtr child, vector<SortKey> keys, size_t memoryBudget)
+: child(move(child)), keys(move(keys)), memoryBudget(memoryBudget), keySize(0), position(0) {
+    if(this->keys.empty())
+        throw invalid_argument("The sort has no keys");
+
+    const auto& childColumns = this->child->columns();
+    for(const SortKey& key : this->keys)
+        keySize += childColumns.at(key.column).field.size();
+    rowSize = ::rowSize(childColumns);
+}
+
+Sort::~Sort() = default;
+
+void Sort::open() {
+    close();
+    child->open();
+
+    while(auto row = child->next()) {
+        if(!order.empty() && entries.size() + order.size() * sizeof(uint32_t) + keySize + rowSize > memoryBudget)
+            spillRun();
+        append(row.value());
+    }
+
+    if(runs.empty()) {
+        sortEntries();
+        return;
+    }
+    if(!order.empty())
+        spillRun();
+    string().swap(entries);
+    vector<uint32_t>().swap(order);
+
+    // ogni run in fusione tiene in memoria un RecordBatch
+    size_t stride = keySize + rowSize;
+    size_t fanIn = max<size_t>(2, memoryBudget / (RecordBatch::CAPACITY * stride));
+
+    while(runs.size() > fanIn) {
+        vector<unique_ptr<SpillFile>> merged;
+        for(size_t i = 0; i < runs.size(); i += fanIn) {
+            vector<unique_ptr<SpillFile>> group;
+            for(size_t j = i; j < min(i + fanIn, runs.size()); j++)
+                group.push_back(move(runs[j]));
+
+            if(group.size() == 1) {
+                merged.push_back(move(group[0]));
+                continue;
+            }
+
+            Merger merger(move(group), keySize);
+            auto run = make_unique<SpillFile>(stride, "minidbms-sort");
+            while(auto entry = merger.next())
+                run->append(entry.value());
+            run->flush();
+            merged.push_back(move(run));
+        }
+        runs = move(merged);
+    }
+
+    merger = make_unique<Merger>(move(runs), keySize);
+    runs.clear();
+}
+
+optional<string_view> Sort::next() {
+    if(merger != nullptr) {
+        auto entry = merger->next();
+        if(!entry.has_value())
+            return nullopt;
+        return entry.value().substr(keySize);
+    }
+
+    if(position >= order.size())
+        return nullopt;
+    return string_view(entries.data() + (size_t)order[position++] * (keySize + rowSize) + keySize, rowSize);
+}
+
+void Sort::close() {
+    child->close();
+    string().swap(entries);
+    vector<uint32_t>().swap(order);
+    position = 0;
+    runs.clear();
+    merger.reset();
+}
+
+const vector<Column>& Sort::columns() const { return child->columns(); }
+
+optional<size_t> Sort::estimatedRows() const { return child->estimatedRows(); }
+
+void Sort::append(string_view row) {
+    const auto& childColumns = child->columns();
+    size_t start = entries.size();
+    entries.resize(start + keySize + rowSize);
+    char* out = entries.data() + start;
+
+    for(const SortKey& key : keys) {
+        const Column& c = childColumns[key.column];
+        c.field.getDomain()->normalize(row.substr(c.offset, c.field.size()), out);
+        if(key.descending) {
+            for(size_t i = 0; i < c.field.size(); i++)
+                out[i] = ~out[i];
+        }
+        out += c.field.size();
+    }
+    memcpy(out, row.data(), rowSize);
+
+    order.push_back(order.size());
+}
+
+void Sort::sortEntries() {
+    const char* data = entries.data();
+    size_t stride = keySize + rowSize;
+    size_t len = keySize;
+
+    stable_sort(order.begin(), order.end(), [data, stride, len](uint32_t a, uint32_t b) {
+        return memcmp(data + (size_t)a * stride, data + (size_t)b * stride, len) < 0;
+    });
+    position = 0;
+}
+
+void Sort::spillRun() {
+    sortEntries();
+
+    size_t stride = keySize + rowSize;
+    auto run = make_unique<SpillFile>(stride, "minidbms-sort");
+    for(uint32_t i : order)
+        run->append(string_view(entries.data() + (size_t)i * stride, stride));
+    run->flush();
+    runs.push_back(move(run));
+
+    entries.clear();
+    order.clear();
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include <atomic>
+#include <filesystem>
+#include <unistd.h>
+
+#include "SpillFile.hpp"
+
+namespace fs = std::filesystem;
+
+SpillFile::SpillFile(size_t rowSize, const string& prefix): rows(0) {
+    static atomic<size_t> counter(0);
+    path = (fs::temp_directory_path() / (prefix + "-" + to_string(getpid()) + "-" + to_string(counter++) + ".tmp")).string();
+    file = make_unique<HeapFile>(path, rowSize, rowSize);
+}
+
+SpillFile::~SpillFile() {
+    file.reset();
+    error_code ec;
+    fs::remove(path, ec);
+}
+
+void SpillFile::append(string_view row) {
+    pending.append(row);
+    rows++;
+    if(pending.size() >= WRITE_SIZE)
+        flush();
+}
+
+void SpillFile::flush() {
+    if(pending.empty())
+        return;
+    file->pushData(pending);
+    pending.clear();
+}
+
+size_t SpillFile::size() const { return rows; }
+
+bool SpillFile::nextBatch(size_t& cursor, RecordBatch& batch) { return file->nextBatch(cursor, batch); }
+
+size_t partitionOf(string_view key, size_t level, size_t partitions) {
+    uint64_t h = hash<string_view>{}(key) + (level + 1) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h % partitions;
+}
\ No newline at end of file
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cstring>
+#include <typeinfo>
+
 #include "StorageEngine.hpp"
 #include "Tables.hpp"
 #include "File.hpp"
@@ -26,6 +30,97 @@ bool Field::operator==(const Field& other) const {
     return *domain.get() == *other.domain.get() && name == name;
 }
 
+CompiledSchema::CompiledSchema(): recordSize(0) {}
+
+CompiledSchema::CompiledSchema(const vector<Field>& keyFields, const vector<Field>& fields): recordSize(0) {
+    auto add = [this](const Field& f) {
+        size_t ordinal = handles.size();
+        SharedDomain domain = f.getDomain();
+
+        handles.push_back(FieldHandle{ordinal, recordSize, f.size()});
+        ordinals[f.getName()] = ordinal;
+        domains.push_back(domain);
+        enums.push_back(nullptr);
+
+        bool anyBytes = typeid(*domain) == typeid(IntegerDomain) || typeid(*domain) == typeid(StringDomain)
+            || typeid(*domain) == typeid(BigIntDomain) || typeid(*domain) == typeid(DateDomain)
+            || typeid(*domain) == typeid(TimestampDomain) || typeid(*domain) == typeid(DecimalDomain);
+        if(anyBytes) {
+            validators.push_back(Validator::None);
+        } else if(typeid(*domain) == typeid(EnumDomain)) {
+            validators.push_back(Validator::Enum);
+            // il dominio resta vivo grazie a domains
+            enums.back() = static_cast<const EnumDomain*>(domain.get());
+            checkedFields.push_back(ordinal);
+        } else {
+            validators.push_back(Validator::Generic);
+            checkedFields.push_back(ordinal);
+        }
+
+        recordSize += f.size();
+    };
+
+    for(const Field& f : keyFields)
+        add(f);
+    for(const Field& f : fields)
+        add(f);
+}
+
+optional<FieldHandle> CompiledSchema::handleOf(const string& name) const {
+    auto it = ordinals.find(name);
+    if(it == ordinals.end())
+        return nullopt;
+    return handles[it->second];
+}
+
+const FieldHandle& CompiledSchema::handleAt(size_t ordinal) const { return handles[ordinal]; }
+
+size_t CompiledSchema::fieldCount() const { return handles.size(); }
+
+bool CompiledSchema::isValid(string_view data) const {
+    if(data.length() < recordSize)
+        return false;
+
+    for(size_t ordinal : checkedFields) {
+        const FieldHandle& h = handles[ordinal];
+        if(!isValidField(ordinal, data.substr(h.offset, h.size)))
+            return false;
+    }
+
+    return true;
+}
+
+size_t CompiledSchema::validate(const RecordBatch& batch) const {
+    if(batch.count > 0 && batch.recordSize != recordSize)
+        return 0;
+
+    // i campi sempre validi non vengono nemmeno visitati
+    for(size_t ordinal : checkedFields) {
+        const FieldHandle& h = handles[ordinal];
+        for(size_t i = 0; i < batch.count; i++) {
+            if(!isValidField(ordinal, string_view(batch.data + i * recordSize + h.offset, h.size)))
+                return i;
+        }
+    }
+
+    return batch.count;
+}
+
+bool CompiledSchema::isValidField(size_t ordinal, string_view value) const {
+    switch (validators[ordinal]) {
+        case Validator::None:
+            return true;
+        case Validator::Enum: {
+            // basta controllare che il codice sia nell'intervallo del dizionario
+            unsigned code = enums[ordinal]->code(value);
+            return code >= 1 && code <= enums[ordinal]->count();
+        }
+        case Validator::Generic:
+            return domains[ordinal]->isValid(value);
+    }
+    return false;
+}
+
 Relation::Relation(vector<Field> fields) {
     this->fields    = vector<Field>();
     this->keyFields = vector<Field>();
@@ -35,11 +130,11 @@ Relation::Relation(vector<Field> fields) {
     recordTotalSize = 0;
     keySize = 0;
     
-    for(Field f: fields) {
+    for(const Field& f: fields) {
         if(f.isKey()) {
             keyFields.push_back(f);
             keySize += f.size();
-        } else fields.push_back(f);
+        } else this->fields.push_back(f);
 
         if(names.find(f.getName()) == names.end()) {
             names.insert(f.getName());
@@ -53,49 +148,28 @@ Relation::Relation(vector<Field> fields) {
 
     if(this->keyFields.empty())
         throw invalid_argument("Ci deve essere almeno una chiave");
+
+    schema = CompiledSchema(keyFields, this->fields);
 }
 
 
 size_t Relation::startPointOf(const Field& field) const {
-    size_t result = 0;
-
-    for(auto f : keyFields) {
-        if(f.getName() == field.getName()) {
-            return result;
-        }
-        result += f.size();
-    }
-
-    for(auto f : fields) {
-        if(f.getName() == field.getName()) {
-            return result;
-        }
-        result += f.size();
-    }
-
-    return result;
+    auto handle = schema.handleOf(field.getName());
+    if(!handle.has_value())
+        return recordTotalSize;
+    return handle.value().offset;
 }
 
-bool Relation::isValid(const string& data) const {
-
-    size_t i = 0;
-    bool result = true;
+const CompiledSchema& Relation::compiled() const { return schema; }
 
-    for(auto f : keyFields) {
-        if(!f.isValid(string_view(data.c_str() + i,f.size()))) {
-            return false;
-        }
-        i += f.size();
-    }
-
-    for(auto f : fields) {
-        if(!f.isValid(string_view(data.c_str() + i,f.size()))) {
-            return false;
-        }
-        i += f.size();
-    }
+bool Relation::isValid(string_view data) const {
+    return schema.isValid(data);
+}
 
-    return true;
+vector<Field> Relation::getFields() const {
+    vector<Field> result = keyFields;
+    result.insert(result.end(), fields.begin(), fields.end());
+    return result;
 }
 
 const vector<Field>& Relation::getKey() const {
@@ -111,58 +185,214 @@ size_t Relation::getRecordSize() const { return recordTotalSize; }
 size_t Relation::getKeySize() const { return keySize; }
 
 
-Record::Record(shared_ptr<Relation> rel, string data): rel(rel), data(data) {
-    if(!rel.get()->isValid(data)) {
+Record::Record(shared_ptr<Relation> rel, string data): rel(move(rel)), data(move(data)) {
+    if(!this->rel.get()->isValid(this->data)) {
         throw invalid_argument("I dati non sono validi");
     }
 }
 
-const string& Record::getData() { return data; }
+const string& Record::getData() const { return data; }
 
     // Ritorna una vista sulla parte di record di cui fa parte il campo
-const string_view Record::valueAt(const Field& field) const {
-    return string_view(data.c_str() + rel.get()->startPointOf(field), field.size());
+const string_view Record::valueAt(const Field& field) const { return RecordView(*this).valueAt(field); }
+
+bool Record::valuesInside(const vector<Value>& values) const { return RecordView(*this).valuesInside(values); }
+
+bool Record::isValid() const { return RecordView(*this).isValid(); }
+
+const string_view Record::valueAt(const FieldHandle& handle) const { return RecordView(*this).valueAt(handle); }
+
+vector<Value> Record::getKey() const { return RecordView(*this).getKey(); }
+
+string_view Record::getKeyData() const { return RecordView(*this).getKeyData(); }
+
+void Record::setValue(const Value& val) {
+    auto [field,newData] = val;
+    memcpy(data.data() + rel.get()->startPointOf(field),newData.data(), field.size());
+}
+
+RecordView::RecordView(const Relation& rel, string_view data): rel(&rel), data(data) {}
+
+RecordView::RecordView(const Record& record): rel(record.rel.get()), data(record.data) {}
+
+const Relation& RecordView::getRelation() const { return *rel; }
+
+string_view RecordView::getData() const { return data; }
+
+string_view RecordView::valueAt(const Field& field) const {
+    return data.substr(rel->startPointOf(field), field.size());
 }
 
-bool Record::valuesInside(const vector<Value>& values) const {
-    for(auto [field,data] : values) {
-        if(valueAt(field) != data)
+string_view RecordView::valueAt(const FieldHandle& handle) const {
+    return data.substr(handle.offset, handle.size);
+}
+
+bool RecordView::valuesInside(const vector<Value>& values) const {
+    for(auto [field,value] : values) {
+        if(valueAt(field) != value)
             return false;
     }
 
     return true;
 }
 
-bool Record::isValid() const {
-    return rel.get()->isValid(data);
-}
+bool RecordView::isValid() const { return rel->isValid(data); }
 
-vector<Value> Record::getKey() const {
+vector<Value> RecordView::getKey() const {
 
     auto result = vector<Value>();
+    const auto& keyFields = rel->getKey();
+    const auto& schema = rel->compiled();
 
-    for(auto key : rel.get()->getKey()) {
-        result.push_back(tuple(key,valueAt(key))); //TODO: fare in modo che l'interno del for sia O(1)
+    // i campi della chiave sono i primi del record: l'ordinale è la posizione nella chiave
+    for(size_t i = 0; i < keyFields.size(); i++) {
+        result.push_back(Value(keyFields[i], valueAt(schema.handleAt(i))));
     }
 
     return result;
 }
 
-string_view Record::getKeyData() const {
-    return string_view(data.c_str(), rel.get()->getKeySize());
-}
-
-void Record::setValue(const Value& val) {
-    auto [field,newData] = val;
-    memcpy(data.data() + rel.get()->startPointOf(field),newData.data(), field.size());
-}
+string_view RecordView::getKeyData() const { return data.substr(0, rel->getKeySize()); }
 
-Database::Database(string name,string dirPath): name(name), dirPath(dirPath) {
+Database::Database(string name,string dirPath, size_t bufferPoolSize, size_t recordCacheSize)
+: name(name), dirPath(dirPath), pool(bufferPoolSize), records(recordCacheSize), schemaVersion(0) {
     domains.push_back(make_shared<IntegerDomain>());
     domains.push_back(make_shared<StringDomain>(25));
+    domains.push_back(make_shared<BigIntDomain>());
+    domains.push_back(make_shared<DoubleDomain>());
+    domains.push_back(make_shared<DateDomain>());
+    domains.push_back(make_shared<TimestampDomain>());
 
     if (!fs::exists(dirPath)) {
         fs::create_directory(dirPath);
     }
+
+    // la recovery avviene prima di aprire le tabelle, che leggono la lunghezza dei file
+    log = make_unique<WriteAheadLog>((fs::path(dirPath) / "wal.log").string());
+    for(const string& changed : log->recover()) {
+        // gli indici, le zone map e i filtri delle chiavi non sono nel log: se il file è cambiato vengono ricostruiti all'apertura
+        fs::remove(changed + ".hidx");
+        fs::remove(changed + ".zmap");
+        fs::remove(changed + ".keys");
+    }
+}
+
+Database::~Database() {
+    tables.clear();
+    try {
+        log->checkpoint();
+    } catch(const runtime_error&) {
+        // il log resta sul disco e viene applicato alla prossima apertura
+    }
+}
+
+namespace {
+
+/**
+ * @return the fields of a relation sorted by their offset in the records, the order of the layout of the files
+ */
+vector<Field> fieldsByOffset(const Relation& relation) {
+    vector<Field> fields = relation.getFields();
+    stable_sort(fields.begin(), fields.end(), [&relation](const Field& a, const Field& b) {
+        return relation.startPointOf(a) < relation.startPointOf(b);
+    });
+    return fields;
 }
 
+}
+
+void Database::addDomain(SharedDomain domain) { domains.push_back(domain); }
+
+void Database::addTable(string name, shared_ptr<Relation> relation, FileType type) {
+    if(getTable(name).has_value())
+        throw invalid_argument("Table " + name + " already exists");
+
+    auto path = fs::path(dirPath) / name;
+    auto keySize = relation.get()->getKeySize();
+    auto recordSize = relation.get()->getRecordSize();
+
+    // la zone map dei file heap riassume tutti i campi che hanno un ordine
+    vector<ZoneField> zoneFields;
+    for(const Field& field : relation.get()->getFields()) {
+        IntegerKind kind = orderKind(*field.getDomain());
+        if(kind != IntegerKind::None)
+            zoneFields.push_back(ZoneField{relation.get()->startPointOf(field), field.size(), kind});
+    }
+
+    FilePtr file;
+    switch (type) {
+        case FileType::Heap:
+            file = make_unique<HeapFile>(path.string() + ".heap", keySize, recordSize, pool, false, zoneFields);
+            file->attachLog(*log);
+            break;
+        case FileType::HashedHeap:
+            file = make_unique<HeapFile>(path.string() + ".heap", keySize, recordSize, pool, true, zoneFields);
+            file->attachLog(*log);
+            break;
+        case FileType::MappedHeap:
+            file = make_unique<MappedHeapFile>(path.string() + ".heap", keySize, recordSize);
+            file->attachLog(*log);
+            break;
+        case FileType::BPlusTree:
+            file = make_unique<BPlusTreeFile>(path.string() + ".bpt", keySize, recordSize, pool);
+            break;
+        case FileType::Pax: {
+            // i campi si ordinano per posizione nel record
+            vector<size_t> fieldSizes;
+            vector<IntegerKind> fieldKinds;
+            for(const Field& field : fieldsByOffset(*relation)) {
+                fieldSizes.push_back(field.size());
+                fieldKinds.push_back(integerKind(*field.getDomain()));
+            }
+            file = make_unique<PaxFile>(path.string() + ".pax", keySize, fieldSizes, fieldKinds, pool);
+            file->attachLog(*log);
+            break;
+        }
+        case FileType::Slotted: {
+            // delle stringhe si salvano solo i caratteri, senza il padding
+            vector<SlottedFile::FieldLayout> layout;
+            for(const Field& field : fieldsByOffset(*relation))
+                layout.push_back({field.size(), typeid(*field.getDomain()) == typeid(StringDomain)});
+            file = make_unique<SlottedFile>(path.string() + ".slt", keySize, layout, pool);
+            file->attachLog(*log);
+            break;
+        }
+    }
+
+    tables.push_back(PhysicalTable(relation, name, move(file), records));
+    schemaVersion++;
+}
+
+optional<PhysicalTableRef> Database::getTable(string_view name) {
+    for(PhysicalTable& table : tables) {
+        if(table.getName() == name)
+            return table;
+    }
+    return nullopt;
+}
+
+bool Database::deleteTable(string_view name) {
+    for(auto it = tables.begin(); it != tables.end(); ++it) {
+        if((*it).getName() == name) {
+            fs::path path = (*it).getFile().filename();
+            tables.erase(it);
+            schemaVersion++;
+            fs::remove(path);
+
+            // rimuove anche i file di supporto, come gli indici, che hanno il nome del file come prefisso
+            string prefix = path.filename().string() + ".";
+            vector<fs::path> sidecars;
+            for(auto& entry : fs::directory_iterator(dirPath)) {
+                if(entry.path().filename().string().rfind(prefix, 0) == 0)
+                    sidecars.push_back(entry.path());
+            }
+            for(auto& sidecar : sidecars)
+                fs::remove(sidecar);
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t Database::getSchemaVersion() const { return schemaVersion; }
+
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+#include "StorageEngine.hpp"
 #include "Tables.hpp"
 
 // Table
@@ -7,27 +12,35 @@ Table::Table(shared_ptr<Relation> rel)
 
 shared_ptr<Relation> Table::getRelation() { return rel; }
 
+bool Table::nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges&, const vector<IntegerFilter>&) {
+    return nextBatch(cursor, batch);
+}
+
+bool Table::readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges&, const vector<IntegerFilter>&) {
+    return readMorsel(morsel, cursor, batch);
+}
+
 // virtual Table
 
-void VirtualTable::addRecord(Record record) {
+void VirtualTable::addRecord(RecordView record) {
     if(getRecord(record.getKeyData()).has_value())
         throw invalid_argument("Broken Key Constraint");
-    this->records.push_back(record);
+    this->records.push_back(Record(rel, string(record.getData())));
 }
 
 void VirtualTable::addRecord(string data) {
-    Record newRecord(rel, data);
-
-    addRecord(newRecord);
+    if(getRecord(RecordView(*rel, data).getKeyData()).has_value())
+        throw invalid_argument("Broken Key Constraint");
+    this->records.push_back(Record(rel, move(data)));
 }
 
-optional<ConstRecordRef> VirtualTable::getRecord(string_view key) {
+optional<RecordHandle> VirtualTable::getRecord(string_view key) {
     if(rel.get()->getKeySize() != key.length()) //TODO: this does not check for domain costraint
         throw invalid_argument("The key is not valid");
 
     for(const Record& record : records) {
         if(record.getKeyData() == key)
-            return record;
+            return RecordHandle(record);
     }
     return {};
 }
@@ -38,7 +51,7 @@ optional<Record> VirtualTable::deleteRecord(string_view key) {
 
     for(auto it = records.begin(); it != records.end(); ++it) {
         if((*it).getKeyData() == key) {
-            Record result = *it;
+            Record result = move(*it);
             records.erase(it);
             return result;
         }
@@ -57,58 +70,334 @@ bool VirtualTable::updateRecordByKey(string_view key, const vector<Value>& newVa
     return false;
 }
 
+bool VirtualTable::nextBatch(size_t& cursor, RecordBatch& batch) {
+    if(cursor >= records.size()) {
+        batch.count = 0;
+        return false;
+    }
+
+    size_t recordSize = rel.get()->getRecordSize();
+    size_t n = min(records.size() - cursor, RecordBatch::CAPACITY);
+    char* out = batch.prepare(recordSize, n);
+
+    for(size_t i = 0; i < n; i++)
+        memcpy(out + i * recordSize, records[cursor + i].getData().data(), recordSize);
+
+    cursor += n;
+    return true;
+}
+
+size_t VirtualTable::size() const { return records.size(); }
+
+vector<Morsel> VirtualTable::morsels() {
+    // i morsel sono intervalli di indici dei record
+    vector<Morsel> result;
+    size_t length = RecordBatch::CAPACITY * 16;
+    for(size_t begin = 0; begin < records.size(); begin += length)
+        result.push_back(Morsel{begin, min(begin + length, records.size())});
+    return result;
+}
+
+bool VirtualTable::readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) {
+    cursor = max(cursor, morsel.begin);
+    size_t end = min(morsel.end, records.size());
+    if(cursor >= end) {
+        batch.count = 0;
+        return false;
+    }
+
+    size_t recordSize = rel.get()->getRecordSize();
+    size_t n = min(end - cursor, RecordBatch::CAPACITY);
+    char* out = batch.prepare(recordSize, n);
+
+    for(size_t i = 0; i < n; i++)
+        memcpy(out + i * recordSize, records[cursor + i].getData().data(), recordSize);
+
+    cursor += n;
+    return true;
+}
+
 // PhysicalTable
 
-PhysicalTable::PhysicalTable(shared_ptr<Relation> rel, string name, FilePtr file)
-: Table(rel), name(name), file(move(file)) {}
+PhysicalTable::PhysicalTable(shared_ptr<Relation> rel, string name, FilePtr file, RecordCache& cache)
+: Table(rel), name(name), file(move(file)), keyFilter(make_unique<KeyFilter>(this->file->filename() + ".keys")), cache(&cache) {
+    if(!keyFilter->load(this->file->size()))
+        rebuildKeys();
+}
+
+PhysicalTable::~PhysicalTable() {
+    // una tabella spostata non ha più il file
+    if(file)
+        cache->discard(file.get());
+}
+
+PhysicalTable& PhysicalTable::operator=(PhysicalTable&& other) {
+    if(this != &other) {
+        if(file)
+            cache->discard(file.get());
+        Table::operator=(other);
+        name = move(other.name);
+        file = move(other.file);
+        keyFilter = move(other.keyFilter);
+        cache = other.cache;
+    }
+    return *this;
+}
 
-void PhysicalTable::addRecord(Record record) {
+void PhysicalTable::addRecord(RecordView record) {
     auto f = file.get();
 
-    if(f->getData(record.getKeyData()).has_value())
+    if(!record.isValid())
+        throw invalid_argument("I dati non sono validi");
+
+    // di solito la chiave è nuova e il filtro lo dice senza leggere il file
+    if(keyFilter->mayContain(record.getKeyData()) && f->getData(record.getKeyData()).has_value())
         throw invalid_argument("Primary Key constraint violated");
     f->pushData(record.getData());
-
+    addKey(record.getKeyData());
 }
 
-void PhysicalTable::addRecord(string data) {
-    Record newRecord(rel,data);
+void PhysicalTable::addRecord(string data) { addRecord(RecordView(*rel, data)); }
+
+void PhysicalTable::bulkLoad(string_view data) {
+    size_t recordSize = rel.get()->getRecordSize();
+    size_t keySize = rel.get()->getKeySize();
+    if(data.length() % recordSize != 0)
+        throw invalid_argument("Data length is not a multiple of record size");
+    size_t count = data.length() / recordSize;
+    if(count == 0)
+        return;
+
+    const CompiledSchema& schema = rel.get()->compiled();
+    RecordBatch batch;
+    batch.recordSize = recordSize;
+    for(size_t i = 0; i < count; i += RecordBatch::CAPACITY) {
+        batch.data = data.data() + i * recordSize;
+        batch.count = min(RecordBatch::CAPACITY, count - i);
+        size_t invalid = schema.validate(batch);
+        if(invalid < batch.count)
+            throw invalid_argument("The record " + to_string(i + invalid) + " is not valid");
+    }
+
+    unordered_set<string_view> keys;
+    keys.reserve(count);
+    for(size_t i = 0; i < count; i++) {
+        if(!keys.insert(data.substr(i * recordSize, keySize)).second)
+            throw invalid_argument("Primary Key constraint violated");
+    }
+
+    auto f = file.get();
+    bool known = false;
+    for(string_view key : keys)
+        known = known || keyFilter->mayContain(key);
+
+    if(f->size() > 0 && known) {
+        // con un indice si cercano le chiavi nuove, altrimenti una sola scansione confronta quelle del file
+        if(f->indexedLookup() && count < f->size()) {
+            for(string_view key : keys) {
+                if(f->getData(key).has_value())
+                    throw invalid_argument("Primary Key constraint violated");
+            }
+        } else {
+            size_t cursor = 0;
+            while(f->nextBatch(cursor, batch)) {
+                for(size_t i = 0; i < batch.count; i++) {
+                    if(keys.count(batch[i].substr(0, keySize)) > 0)
+                        throw invalid_argument("Primary Key constraint violated");
+                }
+            }
+        }
+    }
 
-    addRecord(newRecord);
+    f->bulkLoad(data);
+    for(string_view key : keys)
+        keyFilter->add(key);
+    if(keyFilter->stale())
+        rebuildKeys();
 }
 
-optional<ConstRecordRef> PhysicalTable::getRecord(string_view key) {
+optional<RecordHandle> PhysicalTable::getRecord(string_view key) {
     auto f = file.get();
+    auto cached = cache->get(f, key);
+    if(cached.has_value())
+        return cached;
+
+    if(key.length() == rel.get()->getKeySize() && !keyFilter->mayContain(key))
+        return {};
     auto raw_record = f->getData(key);
-    if(raw_record.has_value()) {
-        Record record(rel, raw_record.value());
-        volatileRecords.push_back(record);
-        return volatileRecords.back();
-    }
+    if(raw_record.has_value())
+        return cache->put(f, key, Record(rel, raw_record.value()));
     return {};
 }
 
+optional<RecordId> PhysicalTable::findRecord(string_view key) {
+    if(rel.get()->getKeySize() != key.length())
+        throw invalid_argument("The key is not valid");
+    return file.get()->findRecord(key);
+}
+
+Record PhysicalTable::getByRid(RecordId rid) { return Record(rel, file.get()->getByRid(rid)); }
+
+void PhysicalTable::checkValues(const vector<Value>& newValues) const {
+    auto relation = rel.get();
+
+    for(const auto& [field, data] : newValues) {
+        if(relation->startPointOf(field) + field.size() > relation->getRecordSize())
+            throw invalid_argument("The field " + field.getName() + " is not in the table");
+        if(field.isKey())
+            throw invalid_argument("The key of a record cannot be updated in place");
+        if(data.length() != field.size() || !field.getDomain()->isValid(data))
+            throw invalid_argument("The value of the field " + field.getName() + " is not valid");
+    }
+}
+
+void PhysicalTable::updateInPlace(RecordId rid, const vector<Value>& newValues) {
+    auto relation = rel.get();
+
+    // si controllano tutti i valori prima di scriverne uno
+    checkValues(newValues);
+
+    if(newValues.empty())
+        return;
+
+    // il record in cache non sarebbe più uguale a quello del file
+    string record = file.get()->getByRid(rid);
+    cache->invalidate(file.get(), string_view(record).substr(0, relation->getKeySize()));
+
+    if(newValues.size() == 1) {
+        const auto& [field, data] = newValues[0];
+        file.get()->updateInPlace(rid, data, relation->startPointOf(field));
+        return;
+    }
+
+    // più campi diventano una sola scrittura, dal primo all'ultimo byte modificato
+    size_t begin = record.size(), end = 0;
+    for(const auto& [field, data] : newValues) {
+        size_t offset = relation->startPointOf(field);
+        memcpy(record.data() + offset, data.data(), data.length());
+        begin = min(begin, offset);
+        end = max(end, offset + data.length());
+    }
+    file.get()->updateInPlace(rid, string_view(record).substr(begin, end - begin), begin);
+}
+
+size_t PhysicalTable::deleteWhere(const function<bool(string_view)>& predicate) {
+    size_t deleted = file.get()->deleteWhere(predicate);
+    if(deleted > 0) {
+        keyFilter->remove(deleted);
+        cache->discard(file.get());
+    }
+    return deleted;
+}
+
+size_t PhysicalTable::updateWhere(const function<bool(string_view)>& predicate, const vector<Value>& newValues) {
+    checkValues(newValues);
+
+    vector<pair<size_t, string_view>> writes;
+    for(const auto& [field, data] : newValues)
+        writes.push_back({rel.get()->startPointOf(field), data});
+
+    size_t updated = file.get()->updateWhere(predicate, [&writes](char* record) {
+        for(const auto& [offset, data] : writes)
+            memcpy(record + offset, data.data(), data.length());
+    });
+    // non si sa quali record sono cambiati, si dimenticano tutti quelli della tabella
+    if(updated > 0)
+        cache->discard(file.get());
+    return updated;
+}
+
 optional<Record> PhysicalTable::deleteRecord(string_view key) {
+    if(key.length() == rel.get()->getKeySize() && !keyFilter->mayContain(key))
+        return {};
     auto f = file.get();
     auto data = f->deleteData(key);
-    if(data.has_value())
+    if(data.has_value()) {
+        keyFilter->remove();
+        cache->invalidate(f, key);
         return Record(rel, data.value());
+    }
     return {};
 }
 
 bool PhysicalTable::updateRecordByKey(string_view key, const vector<Value>& newValues) {
-    //TODO: modificare il record del file senza cancellarlo e reinserirlo
+    bool keyChanged = false;
+    for(const auto& [field, data] : newValues)
+        keyChanged = keyChanged || field.isKey();
+
+    if(key.length() == rel.get()->getKeySize() && !keyFilter->mayContain(key))
+        return false;
+
     auto f = file.get();
-    auto raw_record = f->deleteData(key);
+    if(!keyChanged) {
+        auto rid = f->findRecord(key);
+        if(!rid.has_value())
+            return false;
+        updateInPlace(rid.value(), newValues);
+        return true;
+    }
+
+    // con una chiave nuova il record cambia posizione: si cancella e si reinserisce
+    auto raw_record = f->getData(key);
     if(!raw_record.has_value())
         return false;
-    Record newRecord(rel, raw_record.value());
+    Record newRecord(rel, move(raw_record.value()));
     for(const Value& val : newValues)
-        newRecord.setValue(val); //TODO: verificare il record prima di settare il nuovo valore
+        newRecord.setValue(val);
+    if(!newRecord.isValid())
+        throw invalid_argument("I dati non sono validi");
+
+    if(newRecord.getKeyData() != key && keyFilter->mayContain(newRecord.getKeyData()) && f->getData(newRecord.getKeyData()).has_value())
+        throw invalid_argument("Primary Key constraint violated");
+    f->deleteData(key);
+    keyFilter->remove();
+    cache->invalidate(f, key);
     f->pushData(newRecord.getData());
+    addKey(newRecord.getKeyData());
     return true;
 }
 
+bool PhysicalTable::nextBatch(size_t& cursor, RecordBatch& batch) {
+    return file.get()->nextBatch(cursor, batch);
+}
+
+size_t PhysicalTable::size() const { return file.get()->size(); }
+
+vector<Morsel> PhysicalTable::morsels() { return file.get()->morsels(); }
+
+bool PhysicalTable::readMorsel(const Morsel& morsel, size_t& cursor, RecordBatch& batch) {
+    return file.get()->readMorsel(morsel, cursor, batch);
+}
+
+bool PhysicalTable::nextColumns(size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) {
+    return file.get()->nextColumns(cursor, batch, columns, filters);
+}
+
+bool PhysicalTable::readMorselColumns(const Morsel& morsel, size_t& cursor, RecordBatch& batch, const ColumnRanges& columns, const vector<IntegerFilter>& filters) {
+    return file.get()->readMorselColumns(morsel, cursor, batch, columns, filters);
+}
+
 const string& PhysicalTable::getName() const { return name; }
 
-void PhysicalTable::clear() { volatileRecords.clear(); }
\ No newline at end of file
+File& PhysicalTable::getFile() { return *file.get(); }
+
+void PhysicalTable::clear() { cache->discard(file.get()); }
+
+void PhysicalTable::rebuildKeys() {
+    size_t keySize = rel.get()->getKeySize();
+    keyFilter->reset(file.get()->size());
+
+    // servono solo le chiavi, che sono all'inizio dei record
+    RecordBatch batch;
+    size_t cursor = 0;
+    while(file.get()->nextColumns(cursor, batch, {{0, keySize}}, {})) {
+        for(size_t i = 0; i < batch.count; i++)
+            keyFilter->add(batch[i].substr(0, keySize));
+    }
+}
+
+void PhysicalTable::addKey(string_view key) {
+    keyFilter->add(key);
+    if(keyFilter->stale())
+        rebuildKeys();
+}
\ No newline at end of file
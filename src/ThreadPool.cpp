@@ -0,0 +1,150 @@
+#include <exception>
+
+#include "ThreadPool.hpp"
+
+namespace {
+
+// pool e indice del worker del thread corrente
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+
+}
+
+ThreadPool::ThreadPool(size_t threads): queued(0), nextQueue(0), stopping(false) {
+    threads = max<size_t>(threads, 1);
+    for(size_t i = 0; i < threads; i++)
+        queues.push_back(make_unique<Queue>());
+    for(size_t i = 0; i < threads; i++)
+        this->threads.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(sleepLatch);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(thread& t : threads)
+        t.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+size_t ThreadPool::size() const { return queues.size(); }
+
+void ThreadPool::submit(function<void()> task) {
+    size_t worker = currentWorker();
+    if(worker == size())
+        worker = nextQueue++ % size();
+
+    {
+        lock_guard<mutex> lock(queues[worker]->latch);
+        queues[worker]->tasks.push_back(move(task));
+    }
+    {
+        // il contatore si aggiorna sotto sleepLatch per non perdere la notifica a un worker che si sta addormentando
+        lock_guard<mutex> lock(sleepLatch);
+        queued++;
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const function<void(size_t index, size_t worker)>& task) {
+    struct Join {
+        mutex latch;
+        condition_variable done;
+        size_t remaining;
+        exception_ptr error;
+    };
+    auto join = make_shared<Join>();
+    join->remaining = count;
+
+    for(size_t i = 0; i < count; i++) {
+        submit([this, join, &task, i]() {
+            try {
+                task(i, currentWorker());
+            } catch(...) {
+                lock_guard<mutex> lock(join->latch);
+                if(!join->error)
+                    join->error = current_exception();
+            }
+            lock_guard<mutex> lock(join->latch);
+            if(--join->remaining == 0)
+                join->done.notify_all();
+        });
+    }
+
+    size_t worker = currentWorker();
+    if(worker < size()) {
+        // un worker che aspettasse bloccato potrebbe tenere fermi i task che aspetta
+        function<void()> other;
+        while(true) {
+            {
+                lock_guard<mutex> lock(join->latch);
+                if(join->remaining == 0)
+                    break;
+            }
+            if(take(worker, other))
+                other();
+            else
+                this_thread::yield();
+        }
+    } else {
+        unique_lock<mutex> lock(join->latch);
+        join->done.wait(lock, [&]() { return join->remaining == 0; });
+    }
+
+    if(join->error)
+        rethrow_exception(join->error);
+}
+
+size_t ThreadPool::currentWorker() const {
+    return currentPool == this ? currentIndex : size();
+}
+
+void ThreadPool::work(size_t worker) {
+    currentPool = this;
+    currentIndex = worker;
+
+    function<void()> task;
+    while(true) {
+        if(take(worker, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        unique_lock<mutex> lock(sleepLatch);
+        wake.wait(lock, [this]() { return stopping || queued > 0; });
+        if(stopping && queued == 0)
+            return;
+    }
+}
+
+bool ThreadPool::take(size_t worker, function<void()>& task) {
+    {
+        Queue& own = *queues[worker];
+        lock_guard<mutex> lock(own.latch);
+        if(!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+
+    for(size_t i = 1; i < size(); i++) {
+        Queue& victim = *queues[(worker + i) % size()];
+        lock_guard<mutex> lock(victim.latch);
+        if(!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "WriteAheadLog.hpp"
+
+namespace {
+
+// lunghezza e checksum del corpo precedono ogni record
+constexpr size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+
+uint32_t checksum(string_view data) {
+    uint32_t h = 2166136261u;
+    for(char c : data) {
+        h ^= (unsigned char)c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void writeAll(int fd, const char* data, size_t len) {
+    while(len > 0) {
+        ssize_t n = write(fd, data, len);
+        if(n <= 0)
+            throw runtime_error("Failed to write the log");
+        data += n;
+        len -= n;
+    }
+}
+
+}
+
+WriteAheadLog::WriteAheadLog(string path)
+: path(path), appendedLsn(0), requestedLsn(0), durableLsn(0), durableBytes(0), stopping(false), failed(false) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if(fd < 0)
+        throw runtime_error("Failed to open the log: " + path);
+    off_t size = lseek(fd, 0, SEEK_END);
+    durableBytes = size > 0 ? size : 0;
+
+    flusher = thread(&WriteAheadLog::flushLoop, this);
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        lock_guard<mutex> lock(latch);
+        stopping = true;
+        requestedLsn = appendedLsn;
+    }
+    flushRequested.notify_one();
+    flusher.join();
+    close(fd);
+}
+
+uint64_t WriteAheadLog::logWrite(const string& file, size_t offset, string_view data) {
+    return append(Write, file, offset, data);
+}
+
+uint64_t WriteAheadLog::logSetEnd(const string& file, size_t end) {
+    return append(SetEnd, file, end, "");
+}
+
+void WriteAheadLog::commit(uint64_t lsn) {
+    unique_lock<mutex> lock(latch);
+    if(durableLsn >= lsn)
+        return;
+
+    requestedLsn = max(requestedLsn, lsn);
+    flushRequested.notify_one();
+    flushed.wait(lock, [this, lsn]() { return durableLsn >= lsn || failed; });
+
+    if(durableLsn < lsn || failed)
+        throw runtime_error("Failed to write the log: " + path);
+}
+
+vector<string> WriteAheadLog::recover() {
+    lock_guard<mutex> lock(latch);
+
+    string content;
+    char chunk[64 * 1024];
+    ssize_t n;
+    size_t position = 0;
+    while((n = pread(fd, chunk, sizeof(chunk), position)) > 0) {
+        content.append(chunk, n);
+        position += n;
+    }
+
+    unordered_map<string, int> targets;
+    // l'ultima fine registrata di ogni file: le scritture dopo di essa sono di un'operazione interrotta dal crash
+    unordered_map<string, uint64_t> ends;
+    vector<string> changed;
+
+    for(size_t pos = 0; pos + HEADER_SIZE <= content.size();) {
+        uint32_t length, sum;
+        memcpy(&length, content.data() + pos, sizeof(uint32_t));
+        memcpy(&sum, content.data() + pos + sizeof(uint32_t), sizeof(uint32_t));
+        if(pos + HEADER_SIZE + length > content.size())
+            break;
+
+        string_view body(content.data() + pos + HEADER_SIZE, length);
+        if(checksum(body) != sum || length < 1 + sizeof(uint16_t))
+            break;
+        pos += HEADER_SIZE + length;
+
+        uint8_t type = body[0];
+        uint16_t nameLength;
+        memcpy(&nameLength, body.data() + 1, sizeof(uint16_t));
+        if(body.size() < 1 + sizeof(uint16_t) + nameLength + sizeof(uint64_t))
+            break;
+        string name(body.substr(1 + sizeof(uint16_t), nameLength));
+        uint64_t offset;
+        memcpy(&offset, body.data() + 1 + sizeof(uint16_t) + nameLength, sizeof(uint64_t));
+        string_view data = body.substr(1 + sizeof(uint16_t) + nameLength + sizeof(uint64_t));
+
+        auto it = targets.find(name);
+        if(it == targets.end())
+            // senza O_CREAT: i file cancellati dopo il record non vengono ricreati
+            it = targets.emplace(name, open(name.c_str(), O_WRONLY)).first;
+        int target = it->second;
+        if(target < 0)
+            continue;
+
+        if(type == Write) {
+            for(size_t done = 0; done < data.size();) {
+                ssize_t w = pwrite(target, data.data() + done, data.size() - done, offset + done);
+                if(w <= 0)
+                    throw runtime_error("Failed to recover the file: " + name);
+                done += w;
+            }
+        } else if(type == SetEnd) {
+            if(ftruncate(target, offset) != 0)
+                throw runtime_error("Failed to recover the file: " + name);
+            ends[name] = offset;
+        }
+    }
+
+    for(auto& [name, target] : targets) {
+        if(target >= 0) {
+            // toglie anche il riempimento delle pagine scritte dal BufferPool prima del crash
+            auto end = ends.find(name);
+            if(end != ends.end() && ftruncate(target, end->second) != 0)
+                throw runtime_error("Failed to recover the file: " + name);
+            fsync(target);
+            close(target);
+            changed.push_back(name);
+        }
+    }
+
+    if(ftruncate(fd, 0) != 0 || fsync(fd) != 0)
+        throw runtime_error("Failed to truncate the log: " + path);
+    durableBytes = 0;
+    return changed;
+}
+
+void WriteAheadLog::checkpoint() {
+    unique_lock<mutex> lock(latch);
+    uint64_t lsn = appendedLsn;
+    lock.unlock();
+    commit(lsn);
+    lock.lock();
+
+    for(const string& name : files) {
+        int target = open(name.c_str(), O_RDONLY);
+        if(target >= 0) {
+            fsync(target);
+            close(target);
+        }
+    }
+    files.clear();
+
+    // i record aggiunti durante il checkpoint restano nel log
+    if(appendedLsn == lsn && buffer.empty()) {
+        if(ftruncate(fd, 0) != 0 || fsync(fd) != 0)
+            throw runtime_error("Failed to truncate the log: " + path);
+        durableBytes = 0;
+    }
+}
+
+uint64_t WriteAheadLog::append(RecordType type, const string& file, size_t offset, string_view data) {
+    string body;
+    body.reserve(1 + sizeof(uint16_t) + file.size() + sizeof(uint64_t) + data.size());
+    body.push_back(type);
+    uint16_t nameLength = file.size();
+    body.append((const char*)&nameLength, sizeof(uint16_t));
+    body.append(file);
+    uint64_t value = offset;
+    body.append((const char*)&value, sizeof(uint64_t));
+    body.append(data);
+
+    uint32_t length = body.size();
+    uint32_t sum = checksum(body);
+
+    lock_guard<mutex> lock(latch);
+    if(failed)
+        throw runtime_error("Failed to write the log: " + path);
+    buffer.append((const char*)&length, sizeof(uint32_t));
+    buffer.append((const char*)&sum, sizeof(uint32_t));
+    buffer.append(body);
+    appendedLsn += HEADER_SIZE + body.size();
+    files.insert(file);
+    return appendedLsn;
+}
+
+void WriteAheadLog::flushLoop() {
+    unique_lock<mutex> lock(latch);
+
+    while(true) {
+        flushRequested.wait(lock, [this]() { return stopping || requestedLsn > durableLsn; });
+        if(requestedLsn <= durableLsn && buffer.empty())
+            return;
+
+        // i record aggiunti mentre si scrive e si sincronizza vanno nella scrittura successiva
+        string data;
+        data.swap(buffer);
+        uint64_t lsn = appendedLsn;
+        lock.unlock();
+
+        bool ok = true;
+        try {
+            writeAll(fd, data.data(), data.size());
+            ok = fdatasync(fd) == 0;
+        } catch(const runtime_error&) {
+            ok = false;
+        }
+
+        lock.lock();
+        if(!ok) {
+            // i record persi lascerebbero un buco nel log, e un record scritto a metà nasconderebbe i successivi:
+            // si toglie tutto quello che non è durevole e non si scrive più
+            if(ftruncate(fd, durableBytes) == 0)
+                fdatasync(fd);
+            failed = true;
+            flushed.notify_all();
+            return;
+        }
+        durableLsn = lsn;
+        durableBytes += data.size();
+        flushed.notify_all();
+        if(stopping && buffer.empty())
+            return;
+    }
+}
\ No newline at end of file
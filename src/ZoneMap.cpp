@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "ZoneMap.hpp"
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t ZONEMAP_MAGIC = 0x31504D5A; // "ZMP1"
+
+// un blocco vuoto ha il minimo più grande del massimo
+constexpr int64_t EMPTY_MIN = INT64_MAX;
+constexpr int64_t EMPTY_MAX = INT64_MIN;
+
+// offset, dimensione e tipo di ogni campo
+string describe(const vector<ZoneField>& fields) {
+    string result;
+    for(const ZoneField& field : fields) {
+        uint32_t values[] = {(uint32_t)field.offset, (uint32_t)field.size, (uint32_t)field.kind};
+        result.append((const char*)values, sizeof(values));
+    }
+    return result;
+}
+
+}
+
+ZoneMap::ZoneMap(string fileName, vector<ZoneField> fields)
+: fileName(move(fileName)), fields(move(fields)), saved(false) {
+    if(this->fields.empty())
+        throw invalid_argument("A zone map needs at least a field");
+}
+
+bool ZoneMap::load(size_t recordCount) {
+    bounds.clear();
+    ifstream input(fileName, ios::binary);
+    if(!input)
+        return false;
+
+    uint32_t magic = 0, fieldCount = 0;
+    uint64_t storedCount = 0;
+    input.read((char*)&magic, sizeof(uint32_t));
+    input.read((char*)&fieldCount, sizeof(uint32_t));
+    input.read((char*)&storedCount, sizeof(uint64_t));
+    if(!input || magic != ZONEMAP_MAGIC || fieldCount != fields.size() || storedCount != recordCount)
+        return false;
+
+    string expected = describe(fields);
+    string layout(expected.size(), '\0');
+    input.read(layout.data(), layout.size());
+    if(!input || layout != expected)
+        return false;
+
+    size_t blocks = (recordCount + BLOCK_RECORDS - 1) / BLOCK_RECORDS;
+    bounds.resize(blocks * fields.size() * 2);
+    input.read((char*)bounds.data(), bounds.size() * sizeof(int64_t));
+    if(!input) {
+        bounds.clear();
+        return false;
+    }
+
+    saved = true;
+    return true;
+}
+
+void ZoneMap::save(size_t recordCount) {
+    truncate(recordCount);
+    string tempName = fileName + ".tmp";
+    {
+        ofstream output(tempName, ios::binary | ios::trunc);
+        uint32_t header[] = {ZONEMAP_MAGIC, (uint32_t)fields.size()};
+        uint64_t count = recordCount;
+        string layout = describe(fields);
+        output.write((const char*)header, sizeof(header));
+        output.write((const char*)&count, sizeof(uint64_t));
+        output.write(layout.data(), layout.size());
+        output.write((const char*)bounds.data(), bounds.size() * sizeof(int64_t));
+        if(!output)
+            throw runtime_error("Failed to write the zone map: " + fileName);
+    }
+    // il file completo sostituisce il vecchio in un passo solo
+    if(rename(tempName.c_str(), fileName.c_str()) != 0)
+        throw runtime_error("Failed to write the zone map: " + fileName);
+    saved = true;
+}
+
+void ZoneMap::add(size_t position, string_view record) {
+    invalidate();
+
+    size_t block = position / BLOCK_RECORDS;
+    size_t stride = fields.size() * 2;
+    if(bounds.size() < (block + 1) * stride) {
+        size_t start = bounds.size();
+        bounds.resize((block + 1) * stride);
+        for(size_t i = start; i < bounds.size(); i += 2) {
+            bounds[i] = EMPTY_MIN;
+            bounds[i + 1] = EMPTY_MAX;
+        }
+    }
+
+    int64_t* range = bounds.data() + block * stride;
+    for(size_t f = 0; f < fields.size(); f++) {
+        int64_t value = orderKey(fields[f].kind, record.substr(fields[f].offset, fields[f].size));
+        range[2 * f] = min(range[2 * f], value);
+        range[2 * f + 1] = max(range[2 * f + 1], value);
+    }
+}
+
+void ZoneMap::truncate(size_t recordCount) {
+    size_t blocks = (recordCount + BLOCK_RECORDS - 1) / BLOCK_RECORDS;
+    if(bounds.size() > blocks * fields.size() * 2) {
+        invalidate();
+        bounds.resize(blocks * fields.size() * 2);
+    }
+}
+
+bool ZoneMap::mayMatch(size_t position, const vector<IntegerFilter>& filters) const {
+    size_t block = position / BLOCK_RECORDS;
+    size_t stride = fields.size() * 2;
+    // un blocco che la zone map non conosce si legge sempre
+    if(bounds.size() < (block + 1) * stride)
+        return true;
+
+    const int64_t* range = bounds.data() + block * stride;
+    for(const IntegerFilter& filter : filters) {
+        for(size_t f = 0; f < fields.size(); f++) {
+            if(fields[f].offset == filter.offset && (range[2 * f + 1] < filter.low || range[2 * f] > filter.high))
+                return false;
+        }
+    }
+    return true;
+}
+
+void ZoneMap::invalidate() {
+    if(saved) {
+        remove(fileName.c_str());
+        saved = false;
+    }
+}
\ No newline at end of file